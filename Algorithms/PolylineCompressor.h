@@ -22,6 +22,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #define POLYLINECOMPRESSOR_H_
 
 #include "../DataStructures/SegmentInformation.h"
+#include "../Util/ResponseWriter.h"
 #include "../Util/StringUtil.h"
 
 #include <string>
@@ -92,41 +93,37 @@ public:
 	}
 
     inline void printUnencodedString(std::vector<_Coordinate> & polyline, std::string & output) const {
-        output += "[";
-        std::string tmp;
+        ResponseWriter out(output);
+        out.Write("[");
         for(unsigned i = 0; i < polyline.size(); i++) {
-            convertInternalLatLonToString(polyline[i].lat, tmp);
-            output += "[";
-            output += tmp;
-            convertInternalLatLonToString(polyline[i].lon, tmp);
-            output += ", ";
-            output += tmp;
-            output += "]";
+            out.Write("[");
+            out.WriteLatLon(polyline[i].lat);
+            out.Write(", ");
+            out.WriteLatLon(polyline[i].lon);
+            out.Write("]");
             if( i < polyline.size()-1 ) {
-                output += ",";
+                out.Write(",");
             }
         }
-        output += "]";
+        out.Write("]");
     }
 
     inline void printUnencodedString(std::vector<SegmentInformation> & polyline, std::string & output) const {
-        output += "[";
-        std::string tmp;
+        ResponseWriter out(output);
+        out.Write("[");
         for(unsigned i = 0; i < polyline.size(); i++) {
             if(!polyline[i].necessary)
                 continue;
-            convertInternalLatLonToString(polyline[i].location.lat, tmp);
-            output += "[";
-            output += tmp;
-            convertInternalLatLonToString(polyline[i].location.lon, tmp);
-            output += ", ";
-            output += tmp;
-            output += "]";
+            out.Write("[");
+            out.WriteLatLon(polyline[i].location.lat);
+            out.Write(", ");
+            out.WriteLatLon(polyline[i].location.lon);
+            out.Write("]");
             if( i < polyline.size()-1 ) {
-                output += ",";
+                out.Write(",");
             }
         }
-        output += "]";
+        out.Write("]");
     }
 };
 
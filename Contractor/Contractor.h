@@ -23,15 +23,18 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "TemporaryStorage.h"
 #include "../DataStructures/BinaryHeap.h"
+#include "../DataStructures/RadixHeap.h"
 #include "../DataStructures/DeallocatingVector.h"
 #include "../DataStructures/DynamicGraph.h"
 #include "../DataStructures/Percent.h"
+#include "../DataStructures/TimingUtil.h"
 #include "../DataStructures/XORFastHash.h"
 #include "../DataStructures/XORFastHashStorage.h"
 #include "../Util/OpenMPWrapper.h"
 #include "../Util/StringUtil.h"
 
 #include <boost/assert.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 #include <boost/lambda/lambda.hpp>
 #include <boost/make_shared.hpp>
@@ -41,7 +44,9 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <ctime>
 
 #include <algorithm>
+#include <fstream>
 #include <limits>
+#include <string>
 #include <vector>
 
 class Contractor {
@@ -70,16 +75,28 @@ private:
 
     typedef DynamicGraph< _ContractorEdgeData > _DynamicGraph;
     //    typedef BinaryHeap< NodeID, NodeID, int, _HeapData, ArrayStorage<NodeID, NodeID> > _Heap;
-    typedef BinaryHeap< NodeID, NodeID, int, _HeapData, XORFastHashStorage<NodeID, NodeID> > _Heap;
+    //    typedef BinaryHeap< NodeID, NodeID, int, _HeapData, XORFastHashStorage<NodeID, NodeID> > _Heap;
+    //witness searches are monotone and their distances small integers, see Tools/heapBenchmark.cpp
+    typedef RadixHeap< NodeID, NodeID, int, _HeapData, XORFastHashStorage<NodeID, NodeID> > _Heap;
     typedef _DynamicGraph::InputEdge _ContractorEdge;
 
     struct _ThreadData {
         _Heap heap;
         std::vector< _ContractorEdge > insertedEdges;
+        std::vector< _ContractorEdge > relocatedEdges;
         std::vector< NodeID > neighbours;
         _ThreadData( NodeID nodes ): heap( nodes ) { }
     };
 
+    //edge of a contracted node in temporary storage
+    struct _TemporaryEdge {
+        NodeID source;
+        NodeID target;
+        _ContractorEdgeData data;
+    };
+    //number of edges per write to temporary storage
+    static const unsigned temporaryEdgeBufferSize = 1 << 18;
+
     struct _PriorityData {
         int depth;
         _PriorityData() : depth(0) { }
@@ -108,7 +125,15 @@ private:
 public:
 
     template<class ContainerT >
-    Contractor( int nodes, ContainerT& inputEdges) {
+    //memory budget in bytes, 0 flushes contracted nodes once at 65% of the contraction
+    Contractor( int nodes, ContainerT& inputEdges, const uint64_t budgetInBytes = 0 ) :
+        numberOfInputNodes(nodes),
+        memoryBudget(budgetInBytes),
+        numberOfTemporaryEdges(0),
+        checkpointStamp(0),
+        checkpointInterval(0),
+        resumeFromCheckpoint(false)
+    {
         std::vector< _ContractorEdge > edges;
         edges.reserve(inputEdges.size()*2);
 
@@ -216,8 +241,22 @@ public:
         TemporaryStorage::GetInstance().deallocateSlot(temporaryStorageSlotID);
     }
 
-    void Run() {
-        const NodeID numberOfNodes = _graph->GetNumberOfNodes();
+    //Saves the state of Run() to path every interval seconds. If resume is set, Run() continues
+    //from the saved state when it carries the same stamp. Flushed edges are then kept in path.edges.
+    void SetCheckpoint( const std::string & path, const unsigned stamp, const double interval, const bool resume ) {
+        checkpointPath = path;
+        checkpointStamp = stamp;
+        checkpointInterval = interval;
+        resumeFromCheckpoint = resume;
+    }
+
+    //Contracts the graph. Given the contraction rounds of an earlier run on the same topology,
+    //nodes are contracted in that order instead of evaluating their priorities, which
+    //rebuilds the shortcuts for changed edge weights in a fraction of the time.
+    void Run( const std::vector< unsigned > & fixedContractionRounds = std::vector< unsigned >() ) {
+        const NodeID numberOfNodes = numberOfInputNodes;
+        const bool useFixedOrder = !fixedContractionRounds.empty();
+        BOOST_ASSERT_MSG(!useFixedOrder || numberOfNodes == fixedContractionRounds.size(), "contraction rounds do not match the graph");
         Percent p (numberOfNodes);
 
         const unsigned maxThreads = omp_get_max_threads();
@@ -228,31 +267,64 @@ public:
         std::cout << "Contractor is using " << maxThreads << " threads" << std::endl;
 
         NodeID numberOfContractedNodes = 0;
-        std::vector< _RemainingNodeData > remainingNodes( numberOfNodes );
-        std::vector< float > nodePriority( numberOfNodes );
-        std::vector< _PriorityData > nodeData( numberOfNodes );
+        bool flushedContractor = false;
+        unsigned remainingNodesAfterFlush = numberOfNodes;
+        std::vector< _RemainingNodeData > remainingNodes;
+        std::vector< float > nodePriority;
+        std::vector< _PriorityData > nodeData;
+
+        if( resumeFromCheckpoint && _ReadCheckpoint( useFixedOrder, remainingNodes, nodePriority, nodeData, numberOfContractedNodes, flushedContractor, remainingNodesAfterFlush ) ) {
+            std::cout << "resuming after " << numberOfContractedNodes << " contracted nodes ..." << std::flush;
+        } else {
+            if( !checkpointPath.empty() ) {
+                const std::string flushedEdgesPath = checkpointPath + ".edges";
+                flushedEdgesFile.open( flushedEdgesPath.c_str(), std::ios::binary | std::ios::trunc );
+                if( !flushedEdgesFile.good() ) {
+                    ERR("could not open " << flushedEdgesPath);
+                }
+            }
+            remainingNodes.resize( numberOfNodes );
+            nodePriority.resize( numberOfNodes );
+            nodeData.resize( useFixedOrder ? 0 : numberOfNodes );
 
-        //initialize the variables
+            //initialize the variables
 #pragma omp parallel for schedule ( guided )
-        for ( int x = 0; x < ( int ) numberOfNodes; ++x ) {
-            remainingNodes[x].id = x;
-        }
+            for ( int x = 0; x < ( int ) numberOfNodes; ++x ) {
+                remainingNodes[x].id = x;
+            }
 
-        std::cout << "initializing elimination PQ ..." << std::flush;
+            if( useFixedOrder ) {
+                //nodes of the same round are independent unless the new weights gave them other
+                //shortcuts, ties are then broken as usual
+                std::cout << "using fixed contraction order ..." << std::flush;
+                for ( NodeID x = 0; x < numberOfNodes; ++x ) {
+                    nodePriority[x] = fixedContractionRounds[x];
+                }
+            } else {
+                std::cout << "initializing elimination PQ ..." << std::flush;
 #pragma omp parallel
-        {
-            _ThreadData* data = threadData[omp_get_thread_num()];
+                {
+                    _ThreadData* data = threadData[omp_get_thread_num()];
 #pragma omp parallel for schedule ( guided )
-            for ( int x = 0; x < ( int ) numberOfNodes; ++x ) {
-                nodePriority[x] = _Evaluate( data, &nodeData[x], x );
+                    for ( int x = 0; x < ( int ) numberOfNodes; ++x ) {
+                        nodePriority[x] = _Evaluate( data, &nodeData[x], x );
+                    }
+                }
             }
+            std::cout << "ok" << std::endl << "preprocessing " << numberOfNodes << " nodes ..." << std::flush;
         }
-        std::cout << "ok" << std::endl << "preprocessing " << numberOfNodes << " nodes ..." << std::flush;
-
-        bool flushedContractor = false;
+        double lastCheckpoint = get_timestamp();
         while ( numberOfNodes > 2 && numberOfContractedNodes < numberOfNodes ) {
-            if(!flushedContractor && (numberOfContractedNodes > (numberOfNodes*0.65) ) ){
-                DeallocatingVector<_ContractorEdge> newSetOfEdges; //this one is not explicitely cleared since it goes out of scope anywa
+            //a flush copies the remaining graph, so it starts once the graph takes half of the budget.
+            //A tenth of the remaining nodes, and at least 1% of all, has to be contracted in between.
+            const unsigned contractedSinceFlush = remainingNodesAfterFlush - remainingNodes.size();
+            const bool exceedsMemoryBudget = (
+                0 < memoryBudget &&
+                2*_graph->GetSizeInBytes() > memoryBudget &&
+                10*contractedSinceFlush > remainingNodesAfterFlush &&
+                100*contractedSinceFlush > numberOfNodes
+            );
+            if( exceedsMemoryBudget || (!flushedContractor && (numberOfContractedNodes > (numberOfNodes*0.65) ) ) ){
                 std::cout << " [flush " << numberOfContractedNodes << " nodes] " << std::flush;
 
                 //Delete old heap data to free memory that we need for the coming operations
@@ -260,80 +332,8 @@ public:
                 	delete data;
                 threadData.clear();
 
-
-                //Create new priority array
-                std::vector<float> newNodePriority(remainingNodes.size());
-                //this map gives the old IDs from the new ones, necessary to get a consistent graph at the end of contraction
-                oldNodeIDFromNewNodeIDMap.resize(remainingNodes.size());
-                //this map gives the new IDs from the old ones, necessary to remap targets from the remaining graph
-                std::vector<NodeID> newNodeIDFromOldNodeIDMap(numberOfNodes, UINT_MAX);
-
-                //build forward and backward renumbering map and remap ids in remainingNodes and Priorities.
-                for(unsigned newNodeID = 0; newNodeID < remainingNodes.size(); ++newNodeID) {
-                    //create renumbering maps in both directions
-                    oldNodeIDFromNewNodeIDMap[newNodeID] = remainingNodes[newNodeID].id;
-                    newNodeIDFromOldNodeIDMap[remainingNodes[newNodeID].id] = newNodeID;
-                    newNodePriority[newNodeID] = nodePriority[remainingNodes[newNodeID].id];
-                    remainingNodes[newNodeID].id = newNodeID;
-                }
-                TemporaryStorage & tempStorage = TemporaryStorage::GetInstance();
-                //Write dummy number of edges to temporary file
-                //        		std::ofstream temporaryEdgeStorage(temporaryEdgeStorageFilename.c_str(), std::ios::binary);
-                uint64_t initialFilePosition = tempStorage.tell(temporaryStorageSlotID);
-                unsigned numberOfTemporaryEdges = 0;
-                tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&numberOfTemporaryEdges, sizeof(unsigned));
-
-                //walk over all nodes
-                for(unsigned i = 0; i < _graph->GetNumberOfNodes(); ++i) {
-                    const NodeID start = i;
-                    for(_DynamicGraph::EdgeIterator currentEdge = _graph->BeginEdges(start); currentEdge < _graph->EndEdges(start); ++currentEdge) {
-                        _DynamicGraph::EdgeData & data = _graph->GetEdgeData(currentEdge);
-                        const NodeID target = _graph->GetTarget(currentEdge);
-                        if(UINT_MAX == newNodeIDFromOldNodeIDMap[i] ){
-                            //Save edges of this node w/o renumbering.
-                            tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&start,  sizeof(NodeID));
-                            tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&target, sizeof(NodeID));
-                            tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&data,   sizeof(_DynamicGraph::EdgeData));
-                            ++numberOfTemporaryEdges;
-                        }else {
-                            //node is not yet contracted.
-                            //add (renumbered) outgoing edges to new DynamicGraph.
-                            _ContractorEdge newEdge;
-                            newEdge.source = newNodeIDFromOldNodeIDMap[start];
-                            newEdge.target = newNodeIDFromOldNodeIDMap[target];
-                            newEdge.data = data;
-                            newEdge.data.originalViaNodeID = true;
-                            BOOST_ASSERT_MSG(
-                                UINT_MAX != newNodeIDFromOldNodeIDMap[start],
-                                "new start id not resolveable"
-                            );
-                            BOOST_ASSERT_MSG(
-                                UINT_MAX != newNodeIDFromOldNodeIDMap[target],
-                                "new target id not resolveable"
-                            );
-                            newSetOfEdges.push_back(newEdge);
-                        }
-                    }
-                }
-                //Note the number of temporarily stored edges
-                tempStorage.seek(temporaryStorageSlotID, initialFilePosition);
-                tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&numberOfTemporaryEdges, sizeof(unsigned));
-
-                //Delete map from old NodeIDs to new ones.
-                std::vector<NodeID>().swap(newNodeIDFromOldNodeIDMap);
-
-                //Replace old priorities array by new one
-                nodePriority.swap(newNodePriority);
-                //Delete old nodePriority vector
-                std::vector<float>().swap(newNodePriority);
-                //old Graph is removed
-                _graph.reset();
-
-                //create new graph
-                std::sort(newSetOfEdges.begin(), newSetOfEdges.end());
-                _graph = boost::make_shared<_DynamicGraph>(remainingNodes.size(), newSetOfEdges);
-
-                newSetOfEdges.clear();
+                _FlushContractedNodes( remainingNodes, nodePriority, nodeData );
+                remainingNodesAfterFlush = remainingNodes.size();
                 flushedContractor = true;
 
                 //INFO: MAKE SURE THIS IS THE LAST OPERATION OF THE FLUSH!
@@ -379,34 +379,60 @@ public:
                     _DeleteIncomingEdges( data, x );
                 }
             }
-            //insert new edges
+            //insert new edges. Each chunk of source nodes is merged by a single thread, which
+            //appends in place where possible. Nodes that have to move their edges go serially.
+            const int numberOfChunks = 16*maxThreads;
+            const NodeID chunkSize = _graph->GetNumberOfNodes()/numberOfChunks + 1;
+#pragma omp parallel
+            {
+                _ThreadData* data = threadData[omp_get_thread_num()];
+#pragma omp for schedule ( dynamic )
+                for ( int chunk = 0; chunk < numberOfChunks; ++chunk ) {
+                    _ContractorEdge firstEdgeOfChunk;
+                    firstEdgeOfChunk.source = chunk*chunkSize;
+                    firstEdgeOfChunk.target = 0;
+                    const NodeID endOfChunk = firstEdgeOfChunk.source + chunkSize;
+                    for ( unsigned threadNum = 0; threadNum < maxThreads; ++threadNum ) {
+                        const std::vector< _ContractorEdge > & insertedEdges = threadData[threadNum]->insertedEdges;
+                        std::vector< _ContractorEdge >::const_iterator edge = std::lower_bound( insertedEdges.begin(), insertedEdges.end(), firstEdgeOfChunk );
+                        for ( ; edge != insertedEdges.end() && edge->source < endOfChunk; ++edge ) {
+                            if( !_MergeIntoExistingEdge( *edge ) && !_graph->InsertEdgeInPlace( edge->source, edge->target, edge->data ) ) {
+                                data->relocatedEdges.push_back( *edge );
+                            }
+                        }
+                    }
+                }
+            }
+            for ( unsigned threadNum = 0; threadNum < maxThreads; ++threadNum ) {
+                threadData[threadNum]->insertedEdges.clear();
+            }
             for ( unsigned threadNum = 0; threadNum < maxThreads; ++threadNum ) {
                 _ThreadData& data = *threadData[threadNum];
-                BOOST_FOREACH(const _ContractorEdge& edge, data.insertedEdges) {
-                    _DynamicGraph::EdgeIterator currentEdgeID = _graph->FindEdge(edge.source, edge.target);
-                    if(currentEdgeID < _graph->EndEdges(edge.source) ) {
-                        _DynamicGraph::EdgeData & currentEdgeData = _graph->GetEdgeData(currentEdgeID);
-                        if( currentEdgeData.shortcut
-                                && edge.data.forward == currentEdgeData.forward
-                                && edge.data.backward == currentEdgeData.backward ) {
-                            currentEdgeData.distance = std::min(currentEdgeData.distance, edge.data.distance);
-                            continue;
-                        }
+                BOOST_FOREACH(const _ContractorEdge& edge, data.relocatedEdges) {
+                    if( !_MergeIntoExistingEdge( edge ) ) {
+                        _graph->InsertEdge( edge.source, edge.target, edge.data );
                     }
-                    _graph->InsertEdge( edge.source, edge.target, edge.data );
                 }
-                data.insertedEdges.clear();
+                data.relocatedEdges.clear();
             }
-            //update priorities
+            //update priorities, a fixed order needs none
+            if( !useFixedOrder ) {
 #pragma omp parallel
-            {
-                _ThreadData* data = threadData[omp_get_thread_num()];
+                {
+                    _ThreadData* data = threadData[omp_get_thread_num()];
 #pragma omp for schedule ( guided ) nowait
-                for ( int position = firstIndependent ; position < last; ++position ) {
-                    NodeID x = remainingNodes[position].id;
-                    _UpdateNeighbours( nodePriority, nodeData, data, x );
+                    for ( int position = firstIndependent ; position < last; ++position ) {
+                        NodeID x = remainingNodes[position].id;
+                        _UpdateNeighbours( nodePriority, nodeData, data, x );
+                    }
                 }
             }
+            //remember the order of contraction in terms of the original node ids
+            firstNodeOfRound.push_back( contractionOrder.size() );
+            for ( int position = firstIndependent ; position < last; ++position ) {
+                const NodeID x = remainingNodes[position].id;
+                contractionOrder.push_back( flushedContractor ? oldNodeIDFromNewNodeIDMap[x] : x );
+            }
             //remove contracted nodes from the pool
             numberOfContractedNodes += last - firstIndependent;
             remainingNodes.resize( firstIndependent );
@@ -433,12 +459,47 @@ public:
             //            INFO("rest: " << remainingNodes.size() << ", max: " << maxdegree << ", min: " << mindegree << ", avg: " << avgdegree << ", quad: " << quaddegree);
 
             p.printStatus(numberOfContractedNodes);
+
+            if( 0 < checkpointInterval && get_timestamp() - lastCheckpoint > checkpointInterval ) {
+                _WriteCheckpoint( remainingNodes, nodePriority, nodeData, numberOfContractedNodes, flushedContractor, remainingNodesAfterFlush );
+                lastCheckpoint = get_timestamp();
+            }
         }
         BOOST_FOREACH(_ThreadData * data, threadData)
         	delete data;
         threadData.clear();
     }
 
+    //Round in which each node was contracted. Nodes of one round are independent of each other,
+    //which makes this the order to pass to Run() when contracting the graph with new weights.
+    inline void GetContractionRounds( std::vector< unsigned > & contractionRounds ) const {
+        contractionRounds.clear();
+        contractionRounds.resize( numberOfInputNodes, firstNodeOfRound.size() );
+        for ( unsigned round = 0; round < firstNodeOfRound.size(); ++round ) {
+            const unsigned end = ( round+1 < firstNodeOfRound.size() ? firstNodeOfRound[round+1] : contractionOrder.size() );
+            for ( unsigned i = firstNodeOfRound[round]; i < end; ++i ) {
+                contractionRounds[contractionOrder[i]] = round;
+            }
+        }
+    }
+
+    //Rank of each node in the contraction order, i.e. nodes with higher rank were contracted later.
+    //Every edge of the contracted graph is stored at the node of lower rank.
+    inline void GetNodeRanks( std::vector< unsigned > & nodeRanks ) const {
+        nodeRanks.clear();
+        nodeRanks.resize( numberOfInputNodes, UINT_MAX );
+        unsigned rank = 0;
+        BOOST_FOREACH(const NodeID node, contractionOrder) {
+            nodeRanks[node] = rank++;
+        }
+        //nodes left over by Run() are considered to be the most important ones
+        for ( NodeID node = 0; node < numberOfInputNodes; ++node ) {
+            if( UINT_MAX == nodeRanks[node] ) {
+                nodeRanks[node] = rank++;
+            }
+        }
+    }
+
     template< class Edge >
     inline void GetEdges( DeallocatingVector< Edge >& edges ) {
         Percent p (_graph->GetNumberOfNodes());
@@ -486,33 +547,292 @@ public:
         _graph.reset();
         std::vector<NodeID>().swap(oldNodeIDFromNewNodeIDMap);
 
-        TemporaryStorage & tempStorage = TemporaryStorage::GetInstance();
-        //Also get the edges from temporary storage
-        unsigned numberOfTemporaryEdges = 0;
-        tempStorage.readFromSlot(temporaryStorageSlotID, (char*)&numberOfTemporaryEdges, sizeof(unsigned));
-        //loads edges of graph before renumbering, no need for further numbering action.
-        NodeID start;
-        NodeID target;
-        //edges.reserve(edges.size()+numberOfTemporaryEdges);
-        _DynamicGraph::EdgeData data;
-        for(unsigned i = 0; i < numberOfTemporaryEdges; ++i) {
-            tempStorage.readFromSlot(temporaryStorageSlotID, (char*)&start,  sizeof(NodeID));
-            tempStorage.readFromSlot(temporaryStorageSlotID, (char*)&target, sizeof(NodeID));
-            tempStorage.readFromSlot(temporaryStorageSlotID, (char*)&data,   sizeof(_DynamicGraph::EdgeData));
-            Edge newEdge;
-            newEdge.source =  start;
-            newEdge.target = target;
-            newEdge.data.distance = data.distance;
-            newEdge.data.shortcut = data.shortcut;
-            newEdge.data.id = data.id;
-            newEdge.data.forward = data.forward;
-            newEdge.data.backward = data.backward;
-            edges.push_back( newEdge );
+        //Also get the edges from temporary storage, they are stored in the input IDs already
+        std::ifstream flushedEdgesInput;
+        if(flushedEdgesFile.is_open()) {
+            flushedEdgesFile.close();
+            const std::string flushedEdgesPath = checkpointPath + ".edges";
+            flushedEdgesInput.open(flushedEdgesPath.c_str(), std::ios::binary);
+            if(!flushedEdgesInput.good()) {
+                ERR("could not open " << flushedEdgesPath);
+            }
         }
-        tempStorage.deallocateSlot(temporaryStorageSlotID);
+        std::vector< _TemporaryEdge > buffer;
+        for(unsigned edgesRead = 0; edgesRead < numberOfTemporaryEdges; edgesRead += buffer.size()) {
+            unsigned numberOfBufferedEdges = 0;
+            _ReadTemporaryEdges(flushedEdgesInput, (char*)&numberOfBufferedEdges, sizeof(unsigned));
+            //every flush writes at least one edge, a count beyond the flushed edges stems from corrupt data
+            if(0 == numberOfBufferedEdges || numberOfTemporaryEdges - edgesRead < numberOfBufferedEdges) {
+                ERR("flushed edges are corrupt, read " << numberOfBufferedEdges << " edges after " << edgesRead << " of " << numberOfTemporaryEdges);
+            }
+            buffer.resize(numberOfBufferedEdges);
+            _ReadTemporaryEdges(flushedEdgesInput, (char*)&buffer[0], numberOfBufferedEdges*sizeof(_TemporaryEdge));
+            BOOST_FOREACH(const _TemporaryEdge & temporaryEdge, buffer) {
+                Edge newEdge;
+                newEdge.source = temporaryEdge.source;
+                newEdge.target = temporaryEdge.target;
+                newEdge.data.distance = temporaryEdge.data.distance;
+                newEdge.data.shortcut = temporaryEdge.data.shortcut;
+                newEdge.data.id = temporaryEdge.data.id;
+                newEdge.data.forward = temporaryEdge.data.forward;
+                newEdge.data.backward = temporaryEdge.data.backward;
+                edges.push_back( newEdge );
+            }
+        }
+        TemporaryStorage::GetInstance().deallocateSlot(temporaryStorageSlotID);
     }
 
 private:
+    //Moves the edges of contracted nodes to temporary storage and rebuilds the graph of the
+    //remaining nodes with consecutive IDs. oldNodeIDFromNewNodeIDMap maps them to the input IDs.
+    void _FlushContractedNodes( std::vector< _RemainingNodeData > & remainingNodes, std::vector< float > & nodePriority, std::vector< _PriorityData > & nodeData ) {
+        const NodeID numberOfNodes = _graph->GetNumberOfNodes();
+        const bool isRenumbered = !oldNodeIDFromNewNodeIDMap.empty();
+
+        //build forward and backward renumbering map and remap ids in remainingNodes and priorities
+        std::vector<NodeID> inputNodeIDFromNewNodeIDMap(remainingNodes.size());
+        std::vector<NodeID> newNodeIDFromOldNodeIDMap(numberOfNodes, UINT_MAX);
+        std::vector<float> newNodePriority(remainingNodes.size());
+        std::vector<_PriorityData> newNodeData(nodeData.empty() ? 0 : remainingNodes.size());
+        for(unsigned newNodeID = 0; newNodeID < remainingNodes.size(); ++newNodeID) {
+            const NodeID oldNodeID = remainingNodes[newNodeID].id;
+            inputNodeIDFromNewNodeIDMap[newNodeID] = (isRenumbered ? oldNodeIDFromNewNodeIDMap[oldNodeID] : oldNodeID);
+            newNodeIDFromOldNodeIDMap[oldNodeID] = newNodeID;
+            newNodePriority[newNodeID] = nodePriority[oldNodeID];
+            if(!nodeData.empty()) {
+                newNodeData[newNodeID] = nodeData[oldNodeID];
+            }
+            remainingNodes[newNodeID].id = newNodeID;
+        }
+
+        //walk over all nodes, edges of contracted nodes are written in large sequential chunks
+        DeallocatingVector<_ContractorEdge> newSetOfEdges;
+        std::vector<_TemporaryEdge> buffer;
+        buffer.reserve(temporaryEdgeBufferSize);
+        for(NodeID start = 0; start < numberOfNodes; ++start) {
+            for(_DynamicGraph::EdgeIterator currentEdge = _graph->BeginEdges(start); currentEdge < _graph->EndEdges(start); ++currentEdge) {
+                const _DynamicGraph::EdgeData & data = _graph->GetEdgeData(currentEdge);
+                const NodeID target = _graph->GetTarget(currentEdge);
+                //middle nodes of shortcuts added since the last flush are in the current IDs
+                const bool translateMiddleNode = (isRenumbered && !data.originalViaNodeID);
+                if(UINT_MAX == newNodeIDFromOldNodeIDMap[start]) {
+                    _TemporaryEdge temporaryEdge;
+                    temporaryEdge.source = (isRenumbered ? oldNodeIDFromNewNodeIDMap[start] : start);
+                    temporaryEdge.target = (isRenumbered ? oldNodeIDFromNewNodeIDMap[target] : target);
+                    temporaryEdge.data = data;
+                    if(translateMiddleNode) {
+                        temporaryEdge.data.id = oldNodeIDFromNewNodeIDMap[data.id];
+                    }
+                    buffer.push_back(temporaryEdge);
+                    if(temporaryEdgeBufferSize == buffer.size()) {
+                        _WriteTemporaryEdges(buffer);
+                    }
+                } else {
+                    //node is not yet contracted.
+                    //add (renumbered) outgoing edges to new DynamicGraph.
+                    _ContractorEdge newEdge;
+                    newEdge.source = newNodeIDFromOldNodeIDMap[start];
+                    newEdge.target = newNodeIDFromOldNodeIDMap[target];
+                    newEdge.data = data;
+                    if(translateMiddleNode) {
+                        newEdge.data.id = oldNodeIDFromNewNodeIDMap[data.id];
+                    }
+                    newEdge.data.originalViaNodeID = true;
+                    BOOST_ASSERT_MSG(
+                        UINT_MAX != newEdge.target,
+                        "new target id not resolveable"
+                    );
+                    newSetOfEdges.push_back(newEdge);
+                }
+            }
+        }
+        _WriteTemporaryEdges(buffer);
+        std::vector<_TemporaryEdge>().swap(buffer);
+        std::vector<NodeID>().swap(newNodeIDFromOldNodeIDMap);
+
+        oldNodeIDFromNewNodeIDMap.swap(inputNodeIDFromNewNodeIDMap);
+        nodePriority.swap(newNodePriority);
+        nodeData.swap(newNodeData);
+
+        //old Graph is removed before the new one is created
+        _graph.reset();
+        std::sort(newSetOfEdges.begin(), newSetOfEdges.end());
+        _graph = boost::make_shared<_DynamicGraph>(remainingNodes.size(), newSetOfEdges);
+    }
+
+    inline void _WriteTemporaryEdges( std::vector< _TemporaryEdge > & buffer ) {
+        unsigned numberOfBufferedEdges = buffer.size();
+        if(0 == numberOfBufferedEdges) {
+            return;
+        }
+        if(flushedEdgesFile.is_open()) {
+            flushedEdgesFile.write((char*)&numberOfBufferedEdges, sizeof(unsigned));
+            flushedEdgesFile.write((char*)&buffer[0], numberOfBufferedEdges*sizeof(_TemporaryEdge));
+            if(!flushedEdgesFile.good()) {
+                ERR("could not write flushed edges to " << checkpointPath << ".edges");
+            }
+        } else {
+            TemporaryStorage & tempStorage = TemporaryStorage::GetInstance();
+            tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&numberOfBufferedEdges, sizeof(unsigned));
+            tempStorage.writeToSlot(temporaryStorageSlotID, (char*)&buffer[0], numberOfBufferedEdges*sizeof(_TemporaryEdge));
+        }
+        numberOfTemporaryEdges += numberOfBufferedEdges;
+        buffer.clear();
+    }
+
+    inline void _ReadTemporaryEdges( std::ifstream & flushedEdgesInput, char * pointer, const std::streamsize size ) {
+        if(flushedEdgesInput.is_open()) {
+            flushedEdgesInput.read(pointer, size);
+            if(!flushedEdgesInput.good()) {
+                ERR("could not read flushed edges from " << checkpointPath << ".edges");
+            }
+        } else {
+            TemporaryStorage::GetInstance().readFromSlot(temporaryStorageSlotID, pointer, size);
+        }
+    }
+
+    template<class T>
+    static void _WriteVector( std::ostream & out, const std::vector< T > & vector ) {
+        unsigned size = vector.size();
+        out.write((char*)&size, sizeof(unsigned));
+        if(0 < size) {
+            out.write((char*)&vector[0], size*sizeof(T));
+        }
+    }
+
+    template<class T>
+    static void _ReadVector( std::istream & in, std::vector< T > & vector ) {
+        unsigned size = 0;
+        in.read((char*)&size, sizeof(unsigned));
+        if(!in.good()) {
+            return;
+        }
+        vector.resize(size);
+        if(0 < size) {
+            in.read((char*)&vector[0], size*sizeof(T));
+        }
+    }
+
+    //the checkpoint is written next to the old one and replaces it when complete
+    void _WriteCheckpoint( const std::vector< _RemainingNodeData > & remainingNodes, const std::vector< float > & nodePriority, const std::vector< _PriorityData > & nodeData, const NodeID numberOfContractedNodes, const bool flushedContractor, const unsigned remainingNodesAfterFlush ) {
+        std::cout << " [checkpoint] " << std::flush;
+        flushedEdgesFile.flush();
+        uint64_t flushedEdgesBytes = flushedEdgesFile.tellp();
+        const std::string incompletePath = checkpointPath + ".tmp";
+        std::ofstream out(incompletePath.c_str(), std::ios::binary);
+        out.write((char*)&checkpointStamp, sizeof(unsigned));
+        out.write((char*)&numberOfInputNodes, sizeof(NodeID));
+        const char fixedOrder = nodeData.empty();
+        out.write(&fixedOrder, sizeof(char));
+        out.write((char*)&numberOfContractedNodes, sizeof(NodeID));
+        const char flushed = flushedContractor;
+        out.write(&flushed, sizeof(char));
+        out.write((char*)&remainingNodesAfterFlush, sizeof(unsigned));
+        out.write((char*)&numberOfTemporaryEdges, sizeof(unsigned));
+        out.write((char*)&flushedEdgesBytes, sizeof(uint64_t));
+        _WriteVector(out, remainingNodes);
+        _WriteVector(out, nodePriority);
+        _WriteVector(out, nodeData);
+        _WriteVector(out, oldNodeIDFromNewNodeIDMap);
+        _WriteVector(out, contractionOrder);
+        _WriteVector(out, firstNodeOfRound);
+
+        //edges of the current graph, ordered by source
+        const NodeID numberOfGraphNodes = _graph->GetNumberOfNodes();
+        unsigned numberOfGraphEdges = 0;
+        for ( NodeID node = 0; node < numberOfGraphNodes; ++node ) {
+            numberOfGraphEdges += _graph->GetOutDegree( node );
+        }
+        out.write((char*)&numberOfGraphNodes, sizeof(NodeID));
+        out.write((char*)&numberOfGraphEdges, sizeof(unsigned));
+        _ContractorEdge edge;
+        for ( NodeID node = 0; node < numberOfGraphNodes; ++node ) {
+            for ( _DynamicGraph::EdgeIterator e = _graph->BeginEdges( node ), endEdges = _graph->EndEdges( node ); e < endEdges; ++e ) {
+                edge.source = node;
+                edge.target = _graph->GetTarget( e );
+                edge.data = _graph->GetEdgeData( e );
+                out.write((char*)&edge, sizeof(_ContractorEdge));
+            }
+        }
+        out.close();
+        if(out.fail()) {
+            WARN("could not write checkpoint to " << incompletePath);
+            return;
+        }
+        boost::filesystem::rename(incompletePath, checkpointPath);
+    }
+
+    //restores the state of the last checkpoint and truncates the flushed edges written after it
+    bool _ReadCheckpoint( const bool useFixedOrder, std::vector< _RemainingNodeData > & remainingNodes, std::vector< float > & nodePriority, std::vector< _PriorityData > & nodeData, NodeID & numberOfContractedNodes, bool & flushedContractor, unsigned & remainingNodesAfterFlush ) {
+        std::ifstream in(checkpointPath.c_str(), std::ios::binary);
+        unsigned stamp = 0;
+        NodeID numberOfNodes = 0;
+        char fixedOrder = 0;
+        in.read((char*)&stamp, sizeof(unsigned));
+        in.read((char*)&numberOfNodes, sizeof(NodeID));
+        in.read(&fixedOrder, sizeof(char));
+        if(!in.good() || checkpointStamp != stamp || numberOfInputNodes != numberOfNodes || useFixedOrder != bool(fixedOrder)) {
+            WARN("no matching checkpoint at " << checkpointPath << ", contracting from scratch");
+            return false;
+        }
+        NodeID contractedNodes = 0;
+        char flushed = 0;
+        unsigned remainingAfterFlush = 0;
+        unsigned temporaryEdges = 0;
+        uint64_t flushedEdgesBytes = 0;
+        in.read((char*)&contractedNodes, sizeof(NodeID));
+        in.read(&flushed, sizeof(char));
+        in.read((char*)&remainingAfterFlush, sizeof(unsigned));
+        in.read((char*)&temporaryEdges, sizeof(unsigned));
+        in.read((char*)&flushedEdgesBytes, sizeof(uint64_t));
+        std::vector< _RemainingNodeData > savedRemainingNodes;
+        std::vector< float > savedNodePriority;
+        std::vector< _PriorityData > savedNodeData;
+        std::vector< NodeID > savedOldNodeIDFromNewNodeIDMap;
+        std::vector< NodeID > savedContractionOrder;
+        std::vector< unsigned > savedFirstNodeOfRound;
+        _ReadVector(in, savedRemainingNodes);
+        _ReadVector(in, savedNodePriority);
+        _ReadVector(in, savedNodeData);
+        _ReadVector(in, savedOldNodeIDFromNewNodeIDMap);
+        _ReadVector(in, savedContractionOrder);
+        _ReadVector(in, savedFirstNodeOfRound);
+        NodeID numberOfGraphNodes = 0;
+        unsigned numberOfGraphEdges = 0;
+        in.read((char*)&numberOfGraphNodes, sizeof(NodeID));
+        in.read((char*)&numberOfGraphEdges, sizeof(unsigned));
+        std::vector< _ContractorEdge > edges;
+        if(in.good() && 0 < numberOfGraphEdges) {
+            edges.resize(numberOfGraphEdges);
+            in.read((char*)&edges[0], numberOfGraphEdges*sizeof(_ContractorEdge));
+        }
+        const std::string flushedEdgesPath = checkpointPath + ".edges";
+        if(!in.good() || !boost::filesystem::exists(flushedEdgesPath) || boost::filesystem::file_size(flushedEdgesPath) < flushedEdgesBytes) {
+            WARN("checkpoint at " << checkpointPath << " is incomplete, contracting from scratch");
+            return false;
+        }
+        in.close();
+
+        boost::filesystem::resize_file(flushedEdgesPath, flushedEdgesBytes);
+        flushedEdgesFile.open(flushedEdgesPath.c_str(), std::ios::binary | std::ios::app);
+        if(!flushedEdgesFile.good()) {
+            ERR("could not open " << flushedEdgesPath);
+        }
+        numberOfTemporaryEdges = temporaryEdges;
+        numberOfContractedNodes = contractedNodes;
+        flushedContractor = flushed;
+        remainingNodesAfterFlush = remainingAfterFlush;
+        remainingNodes.swap(savedRemainingNodes);
+        nodePriority.swap(savedNodePriority);
+        nodeData.swap(savedNodeData);
+        oldNodeIDFromNewNodeIDMap.swap(savedOldNodeIDFromNewNodeIDMap);
+        contractionOrder.swap(savedContractionOrder);
+        firstNodeOfRound.swap(savedFirstNodeOfRound);
+        _graph.reset();
+        _graph = boost::make_shared<_DynamicGraph>(numberOfGraphNodes, edges);
+        return true;
+    }
+
     inline void _Dijkstra( const int maxDistance, const unsigned numTargets, const int maxNodes, _ThreadData* const data, const NodeID middleNode ){
 
         _Heap& heap = data->heap;
@@ -672,6 +992,21 @@ private:
         return true;
     }
 
+    //shortens an existing shortcut between the same nodes instead of inserting a parallel one
+    inline bool _MergeIntoExistingEdge( const _ContractorEdge & edge ) {
+        _DynamicGraph::EdgeIterator currentEdgeID = _graph->FindEdge(edge.source, edge.target);
+        if(currentEdgeID < _graph->EndEdges(edge.source) ) {
+            _DynamicGraph::EdgeData & currentEdgeData = _graph->GetEdgeData(currentEdgeID);
+            if( currentEdgeData.shortcut
+                    && edge.data.forward == currentEdgeData.forward
+                    && edge.data.backward == currentEdgeData.backward ) {
+                currentEdgeData.distance = std::min(currentEdgeData.distance, edge.data.distance);
+                return true;
+            }
+        }
+        return false;
+    }
+
     inline void _DeleteIncomingEdges( _ThreadData* data, const NodeID node ) {
         std::vector< NodeID >& neighbours = data->neighbours;
         neighbours.clear();
@@ -777,6 +1112,16 @@ private:
     std::vector<_DynamicGraph::InputEdge> contractedEdges;
     unsigned temporaryStorageSlotID;
     std::vector<NodeID> oldNodeIDFromNewNodeIDMap;
+    std::vector<NodeID> contractionOrder;
+    std::vector<unsigned> firstNodeOfRound;
+    NodeID numberOfInputNodes;
+    uint64_t memoryBudget;
+    unsigned numberOfTemporaryEdges;
+    std::string checkpointPath;
+    unsigned checkpointStamp;
+    double checkpointInterval;
+    bool resumeFromCheckpoint;
+    std::ofstream flushedEdgesFile;
     XORFastHash fastHash;
 };
 
@@ -0,0 +1,159 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef NODERENUMBERING_H_
+#define NODERENUMBERING_H_
+
+#include "EdgeBasedGraphFactory.h"
+#include "../DataStructures/Coordinate.h"
+#include "../DataStructures/DeallocatingVector.h"
+#include "../DataStructures/HilbertValue.h"
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <climits>
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+/*
+ * Renumbers the nodes of the contracted edge-based graph s.t. nodes that are
+ * settled by the same queries lie close to each other in the node and edge
+ * arrays of the query graph. Nodes are grouped into classes of exponentially
+ * growing size by their distance to the top of the hierarchy, i.e. the few
+ * most important nodes that nearly every search reaches come first. Within
+ * a class, nodes are ordered along the Hilbert curve of their location.
+ *
+ * The two edge-based nodes of a bidirected segment are moved together and
+ * keep consecutive IDs, as phantom nodes address them as id and id+1.
+ */
+class NodeRenumbering : boost::noncopyable {
+    typedef EdgeBasedGraphFactory::EdgeBasedNode EdgeBasedNode;
+
+    //one node or the two nodes of a bidirected segment
+    struct NodeGroup {
+        NodeGroup(const NodeID f, const unsigned s) : firstID(f), size(s), levelClass(0), hilbertValue(std::numeric_limits<uint64_t>::max()) {}
+        NodeID firstID;
+        unsigned size;
+        unsigned levelClass;
+        uint64_t hilbertValue;
+        inline bool operator<(const NodeGroup & other) const {
+            if(levelClass != other.levelClass) {
+                return levelClass < other.levelClass;
+            }
+            if(hilbertValue != other.hilbertValue) {
+                return hilbertValue < other.hilbertValue;
+            }
+            return firstID < other.firstID;
+        }
+    };
+
+public:
+    NodeRenumbering(
+        const std::vector<EdgeBasedNode> & edgeBasedNodes,
+        const std::vector<unsigned> & nodeRanks
+    ) {
+        const unsigned numberOfNodes = nodeRanks.size();
+        std::vector<unsigned> indexOfNode(numberOfNodes, UINT_MAX);
+        for(unsigned i = 0; i < edgeBasedNodes.size(); ++i) {
+            BOOST_ASSERT_MSG(edgeBasedNodes[i].id < numberOfNodes, "edge-based node id out of range");
+            indexOfNode[edgeBasedNodes[i].id] = i;
+        }
+
+        std::vector<NodeGroup> groups;
+        for(NodeID node = 0; node < numberOfNodes; ) {
+            const bool isPair = (
+                node+1 < numberOfNodes &&
+                UINT_MAX != indexOfNode[node] &&
+                UINT_MAX != indexOfNode[node+1] &&
+                IsReverseSegment(edgeBasedNodes[indexOfNode[node]], edgeBasedNodes[indexOfNode[node+1]])
+            );
+            NodeGroup group(node, (isPair ? 2 : 1));
+            unsigned rank = nodeRanks[node];
+            if(isPair) {
+                rank = std::max(rank, nodeRanks[node+1]);
+            }
+            //class i holds the nodes whose rank is between n-2^(i+1) and n-2^i
+            for(unsigned distanceToTop = numberOfNodes - rank; distanceToTop > 1; distanceToTop >>= 1) {
+                ++group.levelClass;
+            }
+            if(UINT_MAX != indexOfNode[node]) {
+                group.hilbertValue = HilbertCode::GetHilbertNumberForCoordinate(
+                    edgeBasedNodes[indexOfNode[node]].Centroid()
+                );
+            }
+            groups.push_back(group);
+            node += group.size;
+        }
+        std::sort(groups.begin(), groups.end());
+
+        newIDs.resize(numberOfNodes);
+        NodeID nextID = 0;
+        for(unsigned i = 0; i < groups.size(); ++i) {
+            for(unsigned j = 0; j < groups[i].size; ++j) {
+                newIDs[groups[i].firstID + j] = nextID++;
+            }
+        }
+        BOOST_ASSERT_MSG(numberOfNodes == nextID, "renumbering is not a permutation");
+    }
+
+    inline NodeID GetNewID(const NodeID oldID) const {
+        return newIDs[oldID];
+    }
+
+    //source, target and the middle node of shortcuts
+    template<class EdgeT>
+    inline void RenumberEdges(DeallocatingVector<EdgeT> & edges) const {
+        for(unsigned i = 0; i < edges.size(); ++i) {
+            EdgeT & edge = edges[i];
+            edge.source = newIDs[edge.source];
+            edge.target = newIDs[edge.target];
+            if(edge.data.shortcut) {
+                edge.data.id = newIDs[edge.data.id];
+            }
+        }
+    }
+
+    inline void RenumberEdgeBasedNodes(std::vector<EdgeBasedNode> & edgeBasedNodes) const {
+        for(unsigned i = 0; i < edgeBasedNodes.size(); ++i) {
+            edgeBasedNodes[i].id = newIDs[edgeBasedNodes[i].id];
+        }
+    }
+
+    inline void RenumberNodeRanks(std::vector<unsigned> & nodeRanks) const {
+        std::vector<unsigned> renumberedRanks(nodeRanks.size());
+        for(NodeID node = 0; node < nodeRanks.size(); ++node) {
+            renumberedRanks[newIDs[node]] = nodeRanks[node];
+        }
+        nodeRanks.swap(renumberedRanks);
+    }
+
+private:
+    static inline bool IsReverseSegment(const EdgeBasedNode & a, const EdgeBasedNode & b) {
+        return a.lat1 == b.lat2 && a.lon1 == b.lon2 && a.lat2 == b.lat1 && a.lon2 == b.lon1;
+    }
+
+    std::vector<NodeID> newIDs;
+};
+
+#endif /* NODERENUMBERING_H_ */
@@ -26,6 +26,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <boost/unordered_map.hpp>
 
 #include <cassert>
+#include <climits>
 
 #include <algorithm>
 #include <limits>
@@ -54,6 +55,41 @@ private:
     Key* positions;
 };
 
+//Dense per-node array whose entries are invalidated by a generation counter.
+//Clear() is O(1) and a lookup of a stale entry yields an out-of-range index.
+template< typename NodeID, typename Key >
+class TimestampedArrayStorage {
+public:
+
+    TimestampedArrayStorage( size_t size ) : positions( size ), currentTimestamp( 0 ) { }
+
+    Key &operator[]( NodeID node ) {
+        Cell & cell = positions[node];
+        if( cell.timestamp != currentTimestamp ) {
+            cell.timestamp = currentTimestamp;
+            cell.key = (std::numeric_limits< Key >::max)();
+        }
+        return cell.key;
+    }
+
+    void Clear() {
+        ++currentTimestamp;
+        if( UINT_MAX == currentTimestamp ) {
+            std::fill( positions.begin(), positions.end(), Cell() );
+            currentTimestamp = 0;
+        }
+    }
+
+private:
+    struct Cell {
+        Cell() : key( (std::numeric_limits< Key >::max)() ), timestamp( 0 ) { }
+        Key key;
+        unsigned timestamp;
+    };
+    std::vector< Cell > positions;
+    unsigned currentTimestamp;
+};
+
 template< typename NodeID, typename Key >
 class MapStorage {
 public:
@@ -110,10 +146,14 @@ public:
     typedef Data DataType;
 
     BinaryHeap( size_t maxID )
-    : nodeIndex( maxID ) {
+    : nodeIndex( maxID ), maximumID( maxID ) {
         Clear();
     }
 
+    size_t MaxID() const {
+        return maximumID;
+    }
+
     void Clear() {
         heap.resize( 1 );
         insertedNodes.clear();
@@ -218,6 +258,7 @@ private:
     std::vector< HeapNode > insertedNodes;
     std::vector< HeapElement > heap;
     IndexStorage nodeIndex;
+    size_t maximumID;
 
     void Downheap( Key key ) {
         const Key droppingIndex = heap[key].index;
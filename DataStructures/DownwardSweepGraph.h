@@ -0,0 +1,132 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef DOWNWARDSWEEPGRAPH_H_
+#define DOWNWARDSWEEPGRAPH_H_
+
+#include "../typedefs.h"
+
+#include <boost/assert.hpp>
+#include <boost/noncopyable.hpp>
+
+#include <climits>
+
+#include <algorithm>
+#include <vector>
+
+/*
+ * Copy of the downward edges of a contracted graph, i.e. edges that lead from
+ * a node to a node of lower rank, in the order of a PHAST sweep [1]. Nodes are
+ * numbered by decreasing rank ("sweep positions") and the arcs entering a
+ * node are stored consecutively, s.t. a downward sweep is a linear scan over
+ * the arc array that only reads distances of earlier positions.
+ */
+template<class GraphT>
+class DownwardSweepGraph : boost::noncopyable {
+public:
+    struct Arc {
+        Arc(const unsigned s, const int w) : sourcePosition(s), weight(w) {}
+        unsigned sourcePosition;
+        int weight;
+    };
+
+    DownwardSweepGraph(const GraphT & graph, const std::vector<unsigned> & nodeRanks) {
+        const unsigned numberOfNodes = graph.GetNumberOfNodes();
+        nodeAtPosition.resize(numberOfNodes);
+        for(NodeID node = 0; node < numberOfNodes; ++node) {
+            nodeAtPosition[node] = node;
+        }
+        std::sort(nodeAtPosition.begin(), nodeAtPosition.end(), DecreasingRank(nodeRanks));
+
+        positionOfNode.resize(numberOfNodes);
+        for(unsigned position = 0; position < numberOfNodes; ++position) {
+            positionOfNode[nodeAtPosition[position]] = position;
+        }
+
+        //Edges are stored at the lower ranked node. An edge that is usable in
+        //backward direction thus leads downward from its target to the node.
+        firstArc.resize(numberOfNodes+1);
+        for(unsigned position = 0; position < numberOfNodes; ++position) {
+            firstArc[position] = arcs.size();
+            const NodeID node = nodeAtPosition[position];
+            for(typename GraphT::EdgeIterator edge = graph.BeginEdges(node); edge < graph.EndEdges(node); ++edge) {
+                const typename GraphT::EdgeData & data = graph.GetEdgeData(edge);
+                if(data.backward) {
+                    const unsigned sourcePosition = positionOfNode[graph.GetTarget(edge)];
+                    BOOST_ASSERT_MSG(sourcePosition < position, "edge does not lead downward");
+                    arcs.push_back(Arc(sourcePosition, data.distance));
+                }
+            }
+        }
+        firstArc[numberOfNodes] = arcs.size();
+        std::vector<Arc>(arcs).swap(arcs);
+    }
+
+    inline unsigned GetNumberOfNodes() const {
+        return nodeAtPosition.size();
+    }
+
+    inline unsigned GetPosition(const NodeID node) const {
+        return positionOfNode[node];
+    }
+
+    inline NodeID GetNode(const unsigned position) const {
+        return nodeAtPosition[position];
+    }
+
+    inline unsigned BeginArcs(const unsigned position) const {
+        return firstArc[position];
+    }
+
+    inline unsigned EndArcs(const unsigned position) const {
+        return firstArc[position+1];
+    }
+
+    inline const Arc & GetArc(const unsigned arc) const {
+        return arcs[arc];
+    }
+
+private:
+    //nodes without a rank, i.e. without edges, are swept last
+    struct DecreasingRank {
+        DecreasingRank(const std::vector<unsigned> & r) : ranks(r) {}
+        inline bool operator()(const NodeID a, const NodeID b) const {
+            const bool aIsRanked = (a < ranks.size());
+            const bool bIsRanked = (b < ranks.size());
+            if(aIsRanked != bIsRanked) {
+                return aIsRanked;
+            }
+            if(!aIsRanked) {
+                return a < b;
+            }
+            return ranks[a] > ranks[b];
+        }
+        const std::vector<unsigned> & ranks;
+    };
+
+    std::vector<NodeID> nodeAtPosition;
+    std::vector<unsigned> positionOfNode;
+    std::vector<unsigned> firstArc;
+    std::vector<Arc> arcs;
+};
+
+//[1] "PHAST: Hardware-Accelerated Shortest Path Trees"; D. Delling, A. V. Goldberg, A. Nowatzyk, R. F. Werneck; 2011; DOI: 10.1109/IPDPS.2011.41
+
+#endif /* DOWNWARDSWEEPGRAPH_H_ */
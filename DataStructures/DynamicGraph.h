@@ -102,6 +102,11 @@ class DynamicGraph {
             return m_numEdges;
         }
 
+        //memory taken by nodes and edge slots, including free ones
+        uint64_t GetSizeInBytes() const {
+            return uint64_t(m_nodes.capacity())*sizeof(Node) + uint64_t(m_edges.capacity())*sizeof(Edge);
+        }
+
         uint32_t GetOutDegree( const NodeIterator n ) const {
             return m_nodes[n].edges;
         }
@@ -160,6 +165,22 @@ class DynamicGraph {
             return EdgeIterator( node.firstEdge + node.edges );
         }
 
+        //adds an edge only if the slot behind the last edge of the node is free. Threads may call this
+        //concurrently for distinct source nodes. The slot is claimed atomically, since an empty node
+        //can start right at it.
+        bool InsertEdgeInPlace( const NodeIterator from, const NodeIterator to, const EdgeDataT &data ) {
+            Node &node = m_nodes[from];
+            const EdgeIterator newEdge = node.firstEdge + node.edges;
+            if ( newEdge >= m_edges.size() || !__sync_bool_compare_and_swap( &m_edges[newEdge].target, (std::numeric_limits< NodeIterator >::max)(), to ) ) {
+                return false;
+            }
+            m_edges[newEdge].data = data;
+            #pragma omp atomic
+            ++m_numEdges;
+            ++node.edges;
+            return true;
+        }
+
         //removes an edge. Invalidates edge iterators for the source node
         void DeleteEdge( const NodeIterator source, const EdgeIterator e ) {
             Node &node = m_nodes[source];
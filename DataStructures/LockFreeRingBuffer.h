@@ -0,0 +1,119 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef LOCKFREERINGBUFFER_H_
+#define LOCKFREERINGBUFFER_H_
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/scoped_array.hpp>
+
+#include <cstddef>
+
+#include <algorithm>
+
+/*
+ * Bounded queue for many producers and consumers that never blocks.
+ * Every cell carries a sequence number that tells whether it is ready to
+ * be written or read in the current round, so producers and consumers only
+ * contend on the positions they advance (D. Vyukov's bounded MPMC queue).
+ * Elements are swapped in and out of the cells, so the storage of e.g.
+ * strings is reused instead of copied.
+ */
+template<typename T>
+class LockFreeRingBuffer : boost::noncopyable {
+    struct Cell {
+        boost::atomic<std::size_t> sequence;
+        T data;
+    };
+
+public:
+    //the capacity is rounded up to a power of two
+    explicit LockFreeRingBuffer(const std::size_t minimumCapacity) : enqueuePosition(0), dequeuePosition(0) {
+        std::size_t capacity = 2;
+        while(capacity < minimumCapacity) {
+            capacity <<= 1;
+        }
+        mask = capacity-1;
+        cells.reset(new Cell[capacity]);
+        for(std::size_t i = 0; i < capacity; ++i) {
+            cells[i].sequence.store(i, boost::memory_order_relaxed);
+        }
+    }
+
+    //Swaps data into the buffer, false if it is full
+    inline bool TryPush(T & data) {
+        Cell * cell;
+        std::size_t position = enqueuePosition.load(boost::memory_order_relaxed);
+        while(true) {
+            cell = &cells[position & mask];
+            const std::size_t sequence = cell->sequence.load(boost::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position);
+            if(0 == difference) {
+                if(enqueuePosition.compare_exchange_weak(position, position+1, boost::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(difference < 0) {
+                return false;
+            } else {
+                position = enqueuePosition.load(boost::memory_order_relaxed);
+            }
+        }
+        using std::swap;
+        swap(cell->data, data);
+        cell->sequence.store(position+1, boost::memory_order_release);
+        return true;
+    }
+
+    //Swaps the oldest element out of the buffer, false if it is empty
+    inline bool TryPop(T & data) {
+        Cell * cell;
+        std::size_t position = dequeuePosition.load(boost::memory_order_relaxed);
+        while(true) {
+            cell = &cells[position & mask];
+            const std::size_t sequence = cell->sequence.load(boost::memory_order_acquire);
+            const std::ptrdiff_t difference = static_cast<std::ptrdiff_t>(sequence) - static_cast<std::ptrdiff_t>(position+1);
+            if(0 == difference) {
+                if(dequeuePosition.compare_exchange_weak(position, position+1, boost::memory_order_relaxed)) {
+                    break;
+                }
+            } else if(difference < 0) {
+                return false;
+            } else {
+                position = dequeuePosition.load(boost::memory_order_relaxed);
+            }
+        }
+        using std::swap;
+        swap(cell->data, data);
+        cell->sequence.store(position+mask+1, boost::memory_order_release);
+        return true;
+    }
+
+private:
+    std::size_t mask;
+    boost::scoped_array<Cell> cells;
+    //producers and consumers advance their position on separate cache lines
+    char padding0[64];
+    boost::atomic<std::size_t> enqueuePosition;
+    char padding1[64];
+    boost::atomic<std::size_t> dequeuePosition;
+};
+
+#endif /* LOCKFREERINGBUFFER_H_ */
@@ -23,8 +23,10 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "NodeCoords.h"
 #include "PhantomNodes.h"
+#include "SharedDataLayout.h"
 #include "StaticRTree.h"
 #include "../Contractor/EdgeBasedGraphFactory.h"
+#include "../Util/OSRMException.h"
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
@@ -45,42 +47,88 @@ public:
         const std::string & nodes_filename,
         const std::string & edges_filename,
         const unsigned number_of_nodes,
-        const unsigned check_sum
+        const unsigned check_sum,
+        const bool memory_map_file_index = false
         ) : number_of_nodes(number_of_nodes), check_sum(check_sum)
     {
         read_only_rtree = new StaticRTree<RTreeLeaf>(
             ramIndexInput,
-            fileIndexInput
+            fileIndexInput,
+            memory_map_file_index
         );
         BOOST_ASSERT_MSG(
             0 == coordinateVector.size(),
             "Coordinate vector not empty"
         );
 
-        LoadNodesAndEdges(nodes_filename, edges_filename);
+        LoadNodesAndEdges(
+            nodes_filename,
+            edges_filename,
+            coordinateVector,
+            origEdgeData_viaNode,
+            origEdgeData_nameID,
+            origEdgeData_turnInstruction
+        );
+        SetDataPointers();
+    }
+
+    //Uses the node and edge data of a dataset region written by
+    //osrm-datastore in place. The region must outlive the help desk.
+    //Throws OSRMException if the data is inconsistent.
+    NodeInformationHelpDesk(
+        const SharedDataLayout & layout,
+        const char * shared_data,
+        const unsigned number_of_nodes,
+        const unsigned check_sum
+        ) : number_of_nodes(number_of_nodes), check_sum(check_sum)
+    {
+        read_only_rtree = new StaticRTree<RTreeLeaf>(
+            layout.GetBlock<char>(shared_data, SharedDataLayout::RAM_INDEX),
+            layout.blockSize[SharedDataLayout::RAM_INDEX],
+            layout.GetBlock<char>(shared_data, SharedDataLayout::FILE_INDEX),
+            layout.blockSize[SharedDataLayout::FILE_INDEX]
+        );
+        coordinates = layout.GetBlock<_Coordinate>(shared_data, SharedDataLayout::COORDINATES);
+        numberOfCoordinates = layout.GetNumberOfEntries<_Coordinate>(SharedDataLayout::COORDINATES);
+        viaNodes = layout.GetBlock<NodeID>(shared_data, SharedDataLayout::VIA_NODES);
+        nameIDs = layout.GetBlock<unsigned>(shared_data, SharedDataLayout::NAME_IDS);
+        turnInstructions = layout.GetBlock<TurnInstruction>(shared_data, SharedDataLayout::TURN_INSTRUCTIONS);
+        numberOfOrigEdges = layout.GetNumberOfEntries<NodeID>(SharedDataLayout::VIA_NODES);
+        if(
+            numberOfOrigEdges != layout.GetNumberOfEntries<unsigned>(SharedDataLayout::NAME_IDS) ||
+            numberOfOrigEdges != layout.GetNumberOfEntries<TurnInstruction>(SharedDataLayout::TURN_INSTRUCTIONS)
+        ) {
+            delete read_only_rtree;
+            throw OSRMException("edge data in shared memory is inconsistent");
+        }
     }
 
-    //Todo: Shared memory mechanism
 	~NodeInformationHelpDesk() {
 		delete read_only_rtree;
 	}
 
 	inline int getLatitudeOfNode(const unsigned id) const {
-	    const NodeID node = origEdgeData_viaNode.at(id);
-	    return coordinateVector.at(node).lat;
+	    BOOST_ASSERT(id < numberOfOrigEdges);
+	    const NodeID node = viaNodes[id];
+	    BOOST_ASSERT(node < numberOfCoordinates);
+	    return coordinates[node].lat;
 	}
 
 	inline int getLongitudeOfNode(const unsigned id) const {
-        const NodeID node = origEdgeData_viaNode.at(id);
-	    return coordinateVector.at(node).lon;
+	    BOOST_ASSERT(id < numberOfOrigEdges);
+        const NodeID node = viaNodes[id];
+        BOOST_ASSERT(node < numberOfCoordinates);
+	    return coordinates[node].lon;
 	}
 
 	inline unsigned getNameIndexFromEdgeID(const unsigned id) const {
-	    return origEdgeData_nameID.at(id);
+	    BOOST_ASSERT(id < numberOfOrigEdges);
+	    return nameIDs[id];
 	}
 
     inline TurnInstruction getTurnInstructionFromEdgeID(const unsigned id) const {
-        return origEdgeData_turnInstruction.at(id);
+        BOOST_ASSERT(id < numberOfOrigEdges);
+        return turnInstructions[id];
     }
 
     inline NodeID getNumberOfNodes() const {
@@ -88,7 +136,7 @@ public:
     }
 
 	inline NodeID getNumberOfNodes2() const {
-        return coordinateVector.size();
+        return numberOfCoordinates;
     }
 
     inline bool FindNearestNodeCoordForLatLon(
@@ -117,14 +165,44 @@ public:
         );
     }
 
+    inline void FindKNearestPhantomNodesForCoordinate(
+            const _Coordinate & input_coordinate,
+            const unsigned zoom_level,
+            const unsigned number_of_results,
+            std::vector<std::pair<PhantomNode, double> > & resulting_phantom_nodes
+    ) const {
+        read_only_rtree->FindKNearestPhantomNodesForCoordinate(
+                input_coordinate,
+                zoom_level,
+                number_of_results,
+                resulting_phantom_nodes
+        );
+    }
+
+    inline void FindPhantomNodesForCoordinates(
+            const std::vector<_Coordinate> & input_coordinates,
+            std::vector<PhantomNode> & resulting_phantom_nodes,
+            const unsigned zoom_level
+    ) const {
+        read_only_rtree->FindPhantomNodesForCoordinates(
+                input_coordinates,
+                resulting_phantom_nodes,
+                zoom_level
+        );
+    }
+
 	inline unsigned GetCheckSum() const {
 	    return check_sum;
 	}
 
-private:
-    void LoadNodesAndEdges(
+    //Also used by osrm-datastore to fill the shared memory region
+    static void LoadNodesAndEdges(
         const std::string & nodes_file,
-        const std::string & edges_file
+        const std::string & edges_file,
+        std::vector<_Coordinate> & coordinateVector,
+        std::vector<NodeID> & origEdgeData_viaNode,
+        std::vector<unsigned> & origEdgeData_nameID,
+        std::vector<TurnInstruction> & origEdgeData_turnInstruction
     ) {
     std::ifstream nodes_input_stream(nodes_file.c_str(), std::ios::binary);
     if(!nodes_input_stream) { ERR(nodes_file <<  " not found"); }
@@ -162,11 +240,30 @@ private:
         DEBUG("Opening NN indices");
     }
 
+private:
+    inline void SetDataPointers() {
+        coordinates = (coordinateVector.empty() ? NULL : &coordinateVector[0]);
+        numberOfCoordinates = coordinateVector.size();
+        viaNodes = (origEdgeData_viaNode.empty() ? NULL : &origEdgeData_viaNode[0]);
+        nameIDs = (origEdgeData_nameID.empty() ? NULL : &origEdgeData_nameID[0]);
+        turnInstructions = (origEdgeData_turnInstruction.empty() ? NULL : &origEdgeData_turnInstruction[0]);
+        numberOfOrigEdges = origEdgeData_viaNode.size();
+    }
+
+    //only filled if the data is read from files
 	std::vector<_Coordinate> coordinateVector;
 	std::vector<NodeID> origEdgeData_viaNode;
 	std::vector<unsigned> origEdgeData_nameID;
 	std::vector<TurnInstruction> origEdgeData_turnInstruction;
 
+    //point into the vectors above or into shared memory
+    const _Coordinate * coordinates;
+    unsigned numberOfCoordinates;
+    const NodeID * viaNodes;
+    const unsigned * nameIDs;
+    const TurnInstruction * turnInstructions;
+    unsigned numberOfOrigEdges;
+
 	StaticRTree<EdgeBasedGraphFactory::EdgeBasedNode> * read_only_rtree;
 	const unsigned number_of_nodes;
 	const unsigned check_sum;
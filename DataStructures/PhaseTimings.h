@@ -0,0 +1,92 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+*/
+
+#ifndef PHASETIMINGS_H_
+#define PHASETIMINGS_H_
+
+#include "TimingUtil.h"
+
+#include <boost/noncopyable.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <algorithm>
+
+/*
+ * Wall clock time that the current thread spent in the phases of a query.
+ * Timers nest: while an inner phase runs, no time is charged to the phase
+ * that encloses it, e.g. unpacking that happens in the middle of a search.
+ */
+struct PhaseTimings {
+    enum Phase {
+        parsing = 0,
+        phantomLookup,
+        search,
+        unpacking,
+        description,
+        numberOfPhases,
+        noPhase = numberOfPhases
+    };
+
+    PhaseTimings() : activePhase(noPhase), activeSince(0.) {
+        Clear();
+    }
+
+    inline void Clear() {
+        std::fill(seconds, seconds+numberOfPhases, 0.);
+    }
+
+    double seconds[numberOfPhases];
+    Phase activePhase;
+    double activeSince;
+};
+
+inline PhaseTimings & GetPhaseTimingsOfThread() {
+    static boost::thread_specific_ptr<PhaseTimings> phase_timings;
+    if(!phase_timings.get()) {
+        phase_timings.reset(new PhaseTimings());
+    }
+    return *phase_timings;
+}
+
+//Charges the lifetime of the object to a phase of the current query
+class ScopedPhaseTimer : boost::noncopyable {
+public:
+    explicit ScopedPhaseTimer(const PhaseTimings::Phase phase) : timings(GetPhaseTimingsOfThread()), enclosingPhase(timings.activePhase) {
+        const double now = get_timestamp();
+        if(PhaseTimings::noPhase != enclosingPhase) {
+            timings.seconds[enclosingPhase] += now - timings.activeSince;
+        }
+        timings.activePhase = phase;
+        timings.activeSince = now;
+    }
+
+    ~ScopedPhaseTimer() {
+        const double now = get_timestamp();
+        timings.seconds[timings.activePhase] += now - timings.activeSince;
+        timings.activePhase = enclosingPhase;
+        timings.activeSince = now;
+    }
+
+private:
+    PhaseTimings & timings;
+    const PhaseTimings::Phase enclosingPhase;
+};
+
+#endif /* PHASETIMINGS_H_ */
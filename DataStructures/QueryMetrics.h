@@ -0,0 +1,202 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef QUERYMETRICS_H_
+#define QUERYMETRICS_H_
+
+#include "PhaseTimings.h"
+
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/tss.hpp>
+
+#include <climits>
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+static const unsigned METRICS_MAX_PLUGINS = 16;
+static const unsigned METRICS_NUMBER_OF_BUCKETS = 14;
+//upper bounds of the latency buckets in seconds, values above fall into +Inf
+static const double METRICS_BUCKET_BOUNDS[METRICS_NUMBER_OF_BUCKETS] = {
+    0.0005, 0.001, 0.0025, 0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1., 2.5, 5., 10.
+};
+
+struct LatencyHistogram {
+    LatencyHistogram() : sum(0.), count(0) {
+        std::fill(buckets, buckets+METRICS_NUMBER_OF_BUCKETS+1, 0);
+    }
+
+    inline void Add(const double seconds) {
+        const unsigned bucket = std::lower_bound(METRICS_BUCKET_BOUNDS, METRICS_BUCKET_BOUNDS+METRICS_NUMBER_OF_BUCKETS, seconds) - METRICS_BUCKET_BOUNDS;
+        ++buckets[bucket];
+        sum += seconds;
+        ++count;
+    }
+
+    inline void Merge(const LatencyHistogram & other) {
+        for(unsigned i = 0; i <= METRICS_NUMBER_OF_BUCKETS; ++i) {
+            buckets[i] += other.buckets[i];
+        }
+        sum += other.sum;
+        count += other.count;
+    }
+
+    //not cumulative, the last bucket is +Inf
+    uint64_t buckets[METRICS_NUMBER_OF_BUCKETS+1];
+    double sum;
+    uint64_t count;
+};
+
+struct PluginMetrics {
+    inline void Merge(const PluginMetrics & other) {
+        total.Merge(other.total);
+        for(unsigned i = 0; i < PhaseTimings::numberOfPhases; ++i) {
+            phases[i].Merge(other.phases[i]);
+        }
+    }
+
+    LatencyHistogram total;
+    LatencyHistogram phases[PhaseTimings::numberOfPhases];
+};
+
+/*
+ * Number of queries and their latency per plugin, in total and per phase.
+ * Every thread records into counters of its own, so recording a query takes
+ * no lock and touches no cache line of another thread. A scrape sums up the
+ * counters of all threads. It reads them while they are being written and
+ * may miss the queries that are recorded at that moment.
+ */
+class QueryMetrics : boost::noncopyable {
+    struct ThreadMetrics {
+        PluginMetrics plugins[METRICS_MAX_PLUGINS];
+    };
+
+public:
+    static QueryMetrics & GetInstance() {
+        static QueryMetrics instance;
+        return instance;
+    }
+
+    ~QueryMetrics() {
+        for(unsigned i = 0; i < metricsOfThreads.size(); ++i) {
+            delete metricsOfThreads[i];
+        }
+    }
+
+    //Slot under which the queries of a plugin are recorded, UINT_MAX once all slots are taken
+    unsigned GetPluginSlot(const std::string & pluginName) {
+        boost::mutex::scoped_lock lock(mutex);
+        const std::vector<std::string>::iterator it = std::find(pluginNames.begin(), pluginNames.end(), pluginName);
+        if(pluginNames.end() != it) {
+            return it - pluginNames.begin();
+        }
+        if(METRICS_MAX_PLUGINS == pluginNames.size()) {
+            return UINT_MAX;
+        }
+        pluginNames.push_back(pluginName);
+        return pluginNames.size()-1;
+    }
+
+    //Phases the query did not enter are not recorded
+    inline void Record(const unsigned pluginSlot, const double seconds, const PhaseTimings & timings) {
+        if(METRICS_MAX_PLUGINS <= pluginSlot) {
+            return;
+        }
+        PluginMetrics & metrics = GetMetricsOfThread().plugins[pluginSlot];
+        metrics.total.Add(seconds);
+        for(unsigned i = 0; i < PhaseTimings::numberOfPhases; ++i) {
+            if(0. < timings.seconds[i]) {
+                metrics.phases[i].Add(timings.seconds[i]);
+            }
+        }
+    }
+
+    //Prometheus text exposition format
+    void WritePrometheusText(std::string & output) {
+        const char * phaseNames[] = { "parse", "phantom_lookup", "search", "unpack", "descriptor" };
+
+        boost::mutex::scoped_lock lock(mutex);
+        std::vector<PluginMetrics> metrics(pluginNames.size());
+        for(unsigned i = 0; i < metricsOfThreads.size(); ++i) {
+            for(unsigned slot = 0; slot < metrics.size(); ++slot) {
+                metrics[slot].Merge(metricsOfThreads[i]->plugins[slot]);
+            }
+        }
+
+        std::ostringstream out;
+        out.precision(9);
+        out << "# HELP osrm_request_duration_seconds Latency of the queries of a plugin.\n";
+        out << "# TYPE osrm_request_duration_seconds histogram\n";
+        for(unsigned slot = 0; slot < metrics.size(); ++slot) {
+            WriteHistogram("osrm_request_duration_seconds", "plugin=\"" + pluginNames[slot] + "\"", metrics[slot].total, out);
+        }
+        out << "# HELP osrm_phase_duration_seconds Time that the queries of a plugin spent in a phase.\n";
+        out << "# TYPE osrm_phase_duration_seconds histogram\n";
+        for(unsigned slot = 0; slot < metrics.size(); ++slot) {
+            for(unsigned i = 0; i < PhaseTimings::numberOfPhases; ++i) {
+                WriteHistogram(
+                    "osrm_phase_duration_seconds",
+                    "plugin=\"" + pluginNames[slot] + "\",phase=\"" + phaseNames[i] + "\"",
+                    metrics[slot].phases[i],
+                    out
+                );
+            }
+        }
+        output += out.str();
+    }
+
+private:
+    QueryMetrics() : threadMetrics(&KeepThreadMetrics) { }
+
+    //the counters outlive their thread, they are freed with the registry
+    static void KeepThreadMetrics(ThreadMetrics *) { }
+
+    inline ThreadMetrics & GetMetricsOfThread() {
+        if(!threadMetrics.get()) {
+            ThreadMetrics * metrics = new ThreadMetrics();
+            boost::mutex::scoped_lock lock(mutex);
+            metricsOfThreads.push_back(metrics);
+            threadMetrics.reset(metrics);
+        }
+        return *threadMetrics;
+    }
+
+    static void WriteHistogram(const std::string & name, const std::string & labels, const LatencyHistogram & histogram, std::ostringstream & out) {
+        uint64_t cumulativeCount = 0;
+        for(unsigned i = 0; i < METRICS_NUMBER_OF_BUCKETS; ++i) {
+            cumulativeCount += histogram.buckets[i];
+            out << name << "_bucket{" << labels << ",le=\"" << METRICS_BUCKET_BOUNDS[i] << "\"} " << cumulativeCount << "\n";
+        }
+        out << name << "_bucket{" << labels << ",le=\"+Inf\"} " << histogram.count << "\n";
+        out << name << "_sum{" << labels << "} " << histogram.sum << "\n";
+        out << name << "_count{" << labels << "} " << histogram.count << "\n";
+    }
+
+    boost::mutex mutex;
+    std::vector<std::string> pluginNames;
+    std::vector<ThreadMetrics *> metricsOfThreads;
+    boost::thread_specific_ptr<ThreadMetrics> threadMetrics;
+};
+
+#endif /* QUERYMETRICS_H_ */
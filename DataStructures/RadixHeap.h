@@ -0,0 +1,222 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef RADIXHEAP_H_INCLUDED
+#define RADIXHEAP_H_INCLUDED
+
+#include "BinaryHeap.h"
+
+#include <cassert>
+#include <climits>
+
+#include <limits>
+#include <vector>
+
+//Monotone radix heap with the interface of BinaryHeap. Weights are non-negative integers
+//of at most 32 bits and no weight below the last extracted minimum may be inserted, which
+//holds for Dijkstra searches. An element sits in the bucket of the highest bit in which
+//its weight differs from the last minimum, so it moves at most 32 times in total. Both
+//insertion and DecreaseKey only append to a bucket, a decreased element leaves a stale
+//entry behind that DeleteMin skips.
+template < typename NodeID, typename Key, typename Weight, typename Data, typename IndexStorage = ArrayStorage<NodeID, NodeID> >
+class RadixHeap {
+private:
+    RadixHeap( const RadixHeap& right );
+    void operator=( const RadixHeap& right );
+public:
+    typedef Weight WeightType;
+    typedef Data DataType;
+
+    RadixHeap( size_t maxID )
+    : nodeIndex( maxID ), maximumID( maxID ) {
+        Clear();
+    }
+
+    size_t MaxID() const {
+        return maximumID;
+    }
+
+    void Clear() {
+        for( unsigned i = 0; i < numberOfBuckets; ++i ) {
+            buckets[i].clear();
+        }
+        insertedNodes.clear();
+        numberOfElements = 0;
+        lastMinimum = 0;
+        nodeIndex.Clear();
+    }
+
+    Key Size() const {
+        return static_cast<Key>( numberOfElements );
+    }
+
+    void Insert( NodeID node, Weight weight, const Data &data ) {
+        assert( lastMinimum <= static_cast<unsigned>( weight ) );
+        const Key index = static_cast<Key>( insertedNodes.size() );
+        insertedNodes.push_back( HeapNode( node, weight, data ) );
+        nodeIndex[node] = index;
+        Push( index, weight );
+        ++numberOfElements;
+    }
+
+    Data& GetData( NodeID node ) {
+        const Key index = nodeIndex[node];
+        return insertedNodes[index].data;
+    }
+
+    Weight& GetKey( NodeID node ) {
+        const Key index = nodeIndex[node];
+        return insertedNodes[index].weight;
+    }
+
+    bool WasRemoved( NodeID node ) {
+        assert( WasInserted( node ) );
+        const Key index = nodeIndex[node];
+        return insertedNodes[index].removed;
+    }
+
+    bool WasInserted( NodeID node ) {
+        const Key index = nodeIndex[node];
+        if ( index >= static_cast<Key> (insertedNodes.size()) )
+            return false;
+        return insertedNodes[index].node == node;
+    }
+
+    NodeID Min() {
+        assert( numberOfElements > 0 );
+        RefillFirstBucket();
+        return insertedNodes[buckets[0].back().index].node;
+    }
+
+    NodeID DeleteMin() {
+        assert( numberOfElements > 0 );
+        RefillFirstBucket();
+        const Key removedIndex = buckets[0].back().index;
+        buckets[0].pop_back();
+        insertedNodes[removedIndex].removed = true;
+        --numberOfElements;
+        return insertedNodes[removedIndex].node;
+    }
+
+    void DeleteAll() {
+        for( unsigned i = 0; i < numberOfBuckets; ++i ) {
+            for( typename std::vector< BucketEntry >::iterator it = buckets[i].begin(), end = buckets[i].end(); it != end; ++it ) {
+                insertedNodes[it->index].removed = true;
+            }
+            buckets[i].clear();
+        }
+        numberOfElements = 0;
+    }
+
+    void DecreaseKey( NodeID node, Weight weight ) {
+        assert( UINT_MAX != node );
+        assert( lastMinimum <= static_cast<unsigned>( weight ) );
+        const Key index = nodeIndex[node];
+        assert( !insertedNodes[index].removed );
+        insertedNodes[index].weight = weight;
+        Push( index, weight );
+    }
+
+private:
+    //bucket 0 holds the weights equal to the last minimum, bucket i those that first differ in bit i-1
+    static const unsigned numberOfBuckets = 33;
+
+    class HeapNode {
+    public:
+        HeapNode() {
+        }
+        HeapNode( NodeID n, Weight w, Data d )
+        : node( n ), weight( w ), data( d ), removed( false ) {
+        }
+
+        NodeID node;
+        Weight weight;
+        Data data;
+        bool removed;
+    };
+    struct BucketEntry {
+        BucketEntry( Key i, unsigned w ) : index( i ), weight( w ) { }
+        Key index;
+        unsigned weight;
+    };
+
+    std::vector< HeapNode > insertedNodes;
+    std::vector< BucketEntry > buckets[numberOfBuckets];
+    IndexStorage nodeIndex;
+    size_t maximumID;
+    size_t numberOfElements;
+    unsigned lastMinimum;
+
+    inline unsigned BucketOf( const unsigned weight ) const {
+        const unsigned differingBits = weight ^ lastMinimum;
+        return ( 0 == differingBits ) ? 0 : 32 - __builtin_clz( differingBits );
+    }
+
+    inline void Push( const Key index, const Weight weight ) {
+        const unsigned radixWeight = static_cast<unsigned>( weight );
+        buckets[BucketOf( radixWeight )].push_back( BucketEntry( index, radixWeight ) );
+    }
+
+    //an entry is stale if its element was removed or has been decreased since
+    inline bool IsStale( const BucketEntry & entry ) const {
+        const HeapNode & heapNode = insertedNodes[entry.index];
+        return heapNode.removed || static_cast<unsigned>( heapNode.weight ) != entry.weight;
+    }
+
+    //makes the back of bucket 0 a live element with the minimum weight
+    void RefillFirstBucket() {
+        while( true ) {
+            while( !buckets[0].empty() ) {
+                if( !IsStale( buckets[0].back() ) ) {
+                    return;
+                }
+                buckets[0].pop_back();
+            }
+
+            unsigned bucket = 1;
+            while( buckets[bucket].empty() ) {
+                ++bucket;
+                assert( bucket < numberOfBuckets );
+            }
+
+            std::vector< BucketEntry > & redistributed = buckets[bucket];
+            unsigned newMinimum = UINT_MAX;
+            bool foundLiveEntry = false;
+            for( typename std::vector< BucketEntry >::iterator it = redistributed.begin(), end = redistributed.end(); it != end; ++it ) {
+                if( !IsStale( *it ) && it->weight <= newMinimum ) {
+                    newMinimum = it->weight;
+                    foundLiveEntry = true;
+                }
+            }
+            if( foundLiveEntry ) {
+                lastMinimum = newMinimum;
+                //all live entries land in lower buckets, since they share the bits above the differing one
+                for( typename std::vector< BucketEntry >::iterator it = redistributed.begin(), end = redistributed.end(); it != end; ++it ) {
+                    if( !IsStale( *it ) ) {
+                        buckets[BucketOf( it->weight )].push_back( *it );
+                    }
+                }
+            }
+            redistributed.clear();
+        }
+    }
+};
+
+#endif //#ifndef RADIXHEAP_H_INCLUDED
@@ -27,7 +27,10 @@ SearchEngine::SearchEngine(
     ) :
         _queryData(g, nh, n),
         shortestPath(_queryData),
-        alternativePaths(_queryData)
+        alternativePaths(_queryData),
+        distanceTable(_queryData),
+        batchRoutes(_queryData),
+        oneToAll(_queryData)
     {}
     SearchEngine::~SearchEngine() {}
 
@@ -50,6 +53,18 @@ void SearchEngine::FindPhantomNodeForCoordinate(
     );
 }
 
+void SearchEngine::FindPhantomNodesForCoordinates(
+    const std::vector<_Coordinate> & locations,
+    std::vector<PhantomNode> & results,
+    const unsigned zoomLevel
+    ) const {
+    _queryData.nodeHelpDesk->FindPhantomNodesForCoordinates(
+        locations,
+        results,
+        zoomLevel
+    );
+}
+
 NodeID SearchEngine::GetNameIDForOriginDestinationNodeID(
     const NodeID s,
     const NodeID t
@@ -87,3 +102,7 @@ SearchEngineHeapPtr SearchEngineData::backwardHeap2;
 SearchEngineHeapPtr SearchEngineData::forwardHeap3;
 SearchEngineHeapPtr SearchEngineData::backwardHeap3;
 
+SearchEngineStallQueuePtr SearchEngineData::stallQueue;
+
+SearchEngineDistancesPtr SearchEngineData::distances;
+
@@ -27,6 +27,9 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "QueryEdge.h"
 #include "SearchEngineData.h"
 #include "../RoutingAlgorithms/AlternativePathRouting.h"
+#include "../RoutingAlgorithms/BatchRouting.h"
+#include "../RoutingAlgorithms/ManyToManyRouting.h"
+#include "../RoutingAlgorithms/OneToAllRouting.h"
 #include "../RoutingAlgorithms/ShortestPathRouting.h"
 
 #include "../Util/StringUtil.h"
@@ -43,6 +46,9 @@ private:
 public:
     ShortestPathRouting<SearchEngineData> shortestPath;
     AlternativeRouting<SearchEngineData> alternativePaths;
+    ManyToManyRouting<SearchEngineData> distanceTable;
+    BatchRouting<SearchEngineData> batchRoutes;
+    OneToAllRouting<SearchEngineData> oneToAll;
 
     SearchEngine(
         QueryGraph * g, 
@@ -59,6 +65,12 @@ public:
         unsigned zoomLevel
     ) const;
 
+    void FindPhantomNodesForCoordinates(
+        const std::vector<_Coordinate> & locations,
+        std::vector<PhantomNode> & results,
+        unsigned zoomLevel
+    ) const;
+
     NodeID GetNameIDForOriginDestinationNodeID(
         const NodeID s, const NodeID t) const;
 
@@ -20,41 +20,46 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "SearchEngineData.h"
 
-void SearchEngineData::InitializeOrClearFirstThreadLocalStorage() {
-    if(!forwardHeap.get()) {
-        forwardHeap.reset(new QueryHeap(nodeHelpDesk->getNumberOfNodes()));
-    } else {
-        forwardHeap->Clear();
-    }
-    if(!backwardHeap.get()) {
-        backwardHeap.reset(new QueryHeap(nodeHelpDesk->getNumberOfNodes()));
+//Heaps are shared by all engines of a thread. They are reallocated if they
+//were sized for a smaller graph, e.g. before a dataset was swapped.
+void SearchEngineData::InitializeOrClearHeap(SearchEngineHeapPtr & heap) {
+    const unsigned numberOfNodes = nodeHelpDesk->getNumberOfNodes();
+    if(!heap.get() || heap->MaxID() < numberOfNodes) {
+        heap.reset(new QueryHeap(numberOfNodes));
     } else {
-        backwardHeap->Clear();
+        heap->Clear();
     }
 }
 
+void SearchEngineData::InitializeOrClearFirstThreadLocalStorage() {
+    InitializeOrClearHeap(forwardHeap);
+    InitializeOrClearHeap(backwardHeap);
+}
+
 void SearchEngineData::InitializeOrClearSecondThreadLocalStorage() {
-    if(!forwardHeap2.get()) {
-        forwardHeap2.reset(new QueryHeap(nodeHelpDesk->getNumberOfNodes()));
-    } else {
-        forwardHeap2->Clear();
-    }
-    if(!backwardHeap2.get()) {
-        backwardHeap2.reset(new QueryHeap(nodeHelpDesk->getNumberOfNodes()));
-     } else {
-        backwardHeap2->Clear();
-    }
+    InitializeOrClearHeap(forwardHeap2);
+    InitializeOrClearHeap(backwardHeap2);
 }
 
 void SearchEngineData::InitializeOrClearThirdThreadLocalStorage() {
-    if(!forwardHeap3.get()) {
-        forwardHeap3.reset(new QueryHeap(nodeHelpDesk->getNumberOfNodes()));
-    } else {
-        forwardHeap3->Clear();
+    InitializeOrClearHeap(forwardHeap3);
+    InitializeOrClearHeap(backwardHeap3);
+}
+
+//the queue keeps its capacity, so propagating a stall does not allocate
+StallQueueType & SearchEngineData::GetClearedStallQueue() {
+    if(!stallQueue.get()) {
+        stallQueue.reset(new StallQueueType());
     }
-    if(!backwardHeap3.get()) {
-        backwardHeap3.reset(new QueryHeap(nodeHelpDesk->getNumberOfNodes()));
-    } else {
-        backwardHeap3->Clear();
+    stallQueue->clear();
+    return *stallQueue;
+}
+
+//the distances of a one-to-all search are kept between queries, s.t. a query
+//does not allocate a vector of the size of the graph
+std::vector<int> & SearchEngineData::GetThreadLocalDistances() {
+    if(!distances.get()) {
+        distances.reset(new std::vector<int>());
     }
+    return *distances;
 }
@@ -28,15 +28,20 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <boost/thread.hpp>
 
 #include <string>
+#include <utility>
 #include <vector>
 
 struct _HeapData {
     NodeID parent;
-    _HeapData( NodeID p ) : parent(p) { }
+    bool stalled;
+    _HeapData( NodeID p ) : parent(p), stalled(false) { }
 };
 typedef StaticGraph<QueryEdge::EdgeData> QueryGraph;
-typedef BinaryHeap< NodeID, NodeID, int, _HeapData, UnorderedMapStorage<NodeID, int> > QueryHeapType;
+typedef BinaryHeap< NodeID, NodeID, int, _HeapData, TimestampedArrayStorage<NodeID, int> > QueryHeapType;
 typedef boost::thread_specific_ptr<QueryHeapType> SearchEngineHeapPtr;
+typedef std::vector<std::pair<NodeID, int> > StallQueueType;
+typedef boost::thread_specific_ptr<StallQueueType> SearchEngineStallQueuePtr;
+typedef boost::thread_specific_ptr<std::vector<int> > SearchEngineDistancesPtr;
 
 struct SearchEngineData {
     typedef QueryGraph Graph;
@@ -51,10 +56,19 @@ struct SearchEngineData {
     static SearchEngineHeapPtr backwardHeap2;
     static SearchEngineHeapPtr forwardHeap3;
     static SearchEngineHeapPtr backwardHeap3;
+    static SearchEngineStallQueuePtr stallQueue;
+    static SearchEngineDistancesPtr distances;
 
     void InitializeOrClearFirstThreadLocalStorage();
 
     void InitializeOrClearSecondThreadLocalStorage();
 
     void InitializeOrClearThirdThreadLocalStorage();
+
+    StallQueueType & GetClearedStallQueue();
+
+    std::vector<int> & GetThreadLocalDistances();
+
+private:
+    void InitializeOrClearHeap(SearchEngineHeapPtr & heap);
 };
@@ -0,0 +1,135 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef SHAREDDATALAYOUT_H_
+#define SHAREDDATALAYOUT_H_
+
+#include <boost/cstdint.hpp>
+
+#include <cstring>
+#include <sstream>
+#include <string>
+
+/*
+ * osrm-datastore keeps every dataset in a shared memory region of its own,
+ * named after a generation number. A small control region holds the number
+ * of the live generation. A new dataset is written completely before the
+ * generation number is swapped atomically, i.e. readers either see the old
+ * or the new dataset but never a partially written one.
+ */
+
+static const unsigned SHARED_DATA_LAYOUT_VERSION = 1;
+static const uint64_t SHARED_DATA_PAGE_SIZE = 4096;
+
+//Contents of the control region
+struct SharedDataControl {
+    //0 while no dataset has been published yet
+    volatile unsigned generation;
+};
+
+inline std::string getSharedDataControlName() {
+    return "/osrm-datastore";
+}
+
+inline std::string getSharedDataRegionName(const unsigned generation) {
+    std::ostringstream name;
+    name << "/osrm-data-" << generation;
+    return name.str();
+}
+
+//Reads the live generation, all writes to its region happened before
+inline unsigned readSharedDataGeneration(const SharedDataControl * control) {
+    const unsigned generation = control->generation;
+    __sync_synchronize();
+    return generation;
+}
+
+//Header at the start of a dataset region. Each block starts on a page boundary.
+struct SharedDataLayout {
+    enum BlockID {
+        HSGR_DATA = 0,
+        RAM_INDEX,
+        FILE_INDEX,
+        COORDINATES,
+        VIA_NODES,
+        NAME_IDS,
+        TURN_INSTRUCTIONS,
+        NAMES_DATA,
+        LEVEL_DATA,
+        TIMESTAMP,
+        NUMBER_OF_BLOCKS
+    };
+
+    SharedDataLayout() : version(SHARED_DATA_LAYOUT_VERSION) {
+        memset(blockOffset, 0, sizeof(blockOffset));
+        memset(blockSize, 0, sizeof(blockSize));
+    }
+
+    //Assigns consecutive, page aligned offsets once all block sizes are set
+    void ComputeBlockOffsets() {
+        uint64_t offset = AlignToPage(sizeof(SharedDataLayout));
+        for(unsigned block = 0; block < NUMBER_OF_BLOCKS; ++block) {
+            blockOffset[block] = offset;
+            offset = AlignToPage(offset + blockSize[block]);
+        }
+    }
+
+    inline uint64_t GetTotalSize() const {
+        return AlignToPage(blockOffset[NUMBER_OF_BLOCKS-1] + blockSize[NUMBER_OF_BLOCKS-1]);
+    }
+
+    inline bool IsValidForRegionOfSize(const uint64_t regionSize) const {
+        if(SHARED_DATA_LAYOUT_VERSION != version) {
+            return false;
+        }
+        for(unsigned block = 0; block < NUMBER_OF_BLOCKS; ++block) {
+            if(blockOffset[block] + blockSize[block] > regionSize) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    template<typename T>
+    inline const T * GetBlock(const char * regionData, const BlockID block) const {
+        return reinterpret_cast<const T *>(regionData + blockOffset[block]);
+    }
+
+    template<typename T>
+    inline T * GetBlock(char * regionData, const BlockID block) const {
+        return reinterpret_cast<T *>(regionData + blockOffset[block]);
+    }
+
+    template<typename T>
+    inline unsigned GetNumberOfEntries(const BlockID block) const {
+        return blockSize[block]/sizeof(T);
+    }
+
+    unsigned version;
+    uint64_t blockOffset[NUMBER_OF_BLOCKS];
+    uint64_t blockSize[NUMBER_OF_BLOCKS];
+
+private:
+    static inline uint64_t AlignToPage(const uint64_t offset) {
+        return ((offset + SHARED_DATA_PAGE_SIZE - 1) / SHARED_DATA_PAGE_SIZE) * SHARED_DATA_PAGE_SIZE;
+    }
+};
+
+#endif /* SHAREDDATALAYOUT_H_ */
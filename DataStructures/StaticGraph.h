@@ -23,11 +23,13 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "../typedefs.h"
 
+#include <boost/noncopyable.hpp>
+
 #include <algorithm>
 #include <vector>
 
 template< typename EdgeDataT>
-class StaticGraph {
+class StaticGraph : boost::noncopyable {
 public:
     typedef NodeID NodeIterator;
     typedef NodeID EdgeIterator;
@@ -69,6 +71,8 @@ public:
             position += edge - lastEdge; //remove
         }
         _edges.resize( position ); //(edge)
+        _nodeArray = &_nodes[0];
+        _edgeArray = _edges.empty() ? NULL : &_edges[0];
         edge = 0;
         for ( NodeIterator node = 0; node < _numNodes; ++node ) {
             for ( EdgeIterator i = _nodes[node].firstEdge, e = _nodes[node+1].firstEdge; i != e; ++i ) {
@@ -89,6 +93,8 @@ public:
 
         //Add dummy node to end of _nodes array;
         _nodes.push_back(_nodes.back());
+        _nodeArray = &_nodes[0];
+        _edgeArray = _edges.empty() ? NULL : &_edges[0];
 
 #ifndef NDEBUG
         Percent p(GetNumberOfNodes());
@@ -114,6 +120,16 @@ public:
 #endif
     }
 
+    //Read-only graph on top of memory owned by someone else, e.g. a memory
+    //mapped .hsgr file. The node array has to hold nodes+1 entries.
+    StaticGraph( const _StrNode * nodes, const unsigned numberOfNodes, const _StrEdge * edges, const unsigned numberOfEdges ) :
+        _numNodes(numberOfNodes),
+        _numEdges(numberOfEdges),
+        //never written to, the non-const accessors are only used on graphs that own their data
+        _nodeArray(const_cast<_StrNode *>(nodes)),
+        _edgeArray(const_cast<_StrEdge *>(edges))
+    { }
+
     unsigned GetNumberOfNodes() const {
         return _numNodes;
     }
@@ -127,23 +143,23 @@ public:
     }
 
     inline NodeIterator GetTarget( const EdgeIterator &e ) const {
-        return NodeIterator( _edges[e].target );
+        return NodeIterator( _edgeArray[e].target );
     }
 
     inline EdgeDataT &GetEdgeData( const EdgeIterator &e ) {
-        return _edges[e].data;
+        return _edgeArray[e].data;
     }
 
     const EdgeDataT &GetEdgeData( const EdgeIterator &e ) const {
-        return _edges[e].data;
+        return _edgeArray[e].data;
     }
 
     EdgeIterator BeginEdges( const NodeIterator &n ) const {
-        return EdgeIterator( _nodes[n].firstEdge );
+        return EdgeIterator( _nodeArray[n].firstEdge );
     }
 
     EdgeIterator EndEdges( const NodeIterator &n ) const {
-        return EdgeIterator( _nodes[n+1].firstEdge );
+        return EdgeIterator( _nodeArray[n+1].firstEdge );
     }
 
     //searches for a specific edge
@@ -182,6 +198,10 @@ private:
 
     std::vector< _StrNode > _nodes;
     std::vector< _StrEdge > _edges;
+
+    //point either into the vectors above or into external memory
+    _StrNode * _nodeArray;
+    _StrEdge * _edgeArray;
 };
 
 #endif // STATICGRAPH_H_INCLUDED
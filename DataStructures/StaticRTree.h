@@ -27,6 +27,8 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "PhantomNodes.h"
 #include "DeallocatingVector.h"
 #include "HilbertValue.h"
+#include "../Util/MemoryMappedFile.h"
+#include "../Util/OSRMException.h"
 #include "../typedefs.h"
 
 #include <boost/assert.hpp>
@@ -48,9 +50,16 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <string>
 #include <vector>
 
+#if defined(_OPENMP) && defined(__GLIBCXX__)
+#include <parallel/algorithm>
+#endif
+
 //tuning parameters
 const static uint32_t RTREE_BRANCHING_FACTOR = 50;
 const static uint32_t RTREE_LEAF_NODE_SIZE = 1170;
+const static uint32_t RTREE_BATCH_LEAF_CACHE_SIZE = 8;
+//number of leaves that are packed in parallel during construction
+const static uint32_t RTREE_LEAVES_PER_CHUNK = 256;
 
 // Implements a static, i.e. packed, R-tree
 
@@ -120,50 +129,19 @@ private:
             );
         }
 
+        //Distance to the closest point of the rectangle, a lower bound for
+        //the distance to every element within.
         inline double GetMinDist(const _Coordinate & location) const {
             bool is_contained = Contains(location);
             if (is_contained) {
                 return 0.0;
             }
 
-            double min_dist = DBL_MAX;
-            min_dist = std::min(
-                    min_dist,
-                    ApproximateDistance(
-                            location.lat,
-                            location.lon,
-                            max_lat,
-                            min_lon
-                    )
-            );
-            min_dist = std::min(
-                    min_dist,
-                    ApproximateDistance(
-                            location.lat,
-                            location.lon,
-                            max_lat,
-                            max_lon
-                    )
-            );
-            min_dist = std::min(
-                    min_dist,
-                    ApproximateDistance(
-                            location.lat,
-                            location.lon,
-                            min_lat,
-                            max_lon
-                    )
-            );
-            min_dist = std::min(
-                    min_dist,
-                    ApproximateDistance(
-                            location.lat,
-                            location.lon,
-                            min_lat,
-                            min_lon
-                    )
+            const _Coordinate closest_point(
+                    std::max(min_lat, std::min(max_lat, location.lat)),
+                    std::max(min_lon, std::min(max_lon, location.lon))
             );
-            return min_dist;
+            return ApproximateDistance(location, closest_point);
         }
 
         inline double GetMinMaxDist(const _Coordinate & location) const {
@@ -268,8 +246,22 @@ private:
         QueryCandidate() : node_id(UINT_MAX), min_dist(DBL_MAX) {}
         uint32_t node_id;
         double min_dist;
+        //std::priority_queue pops the largest element, i.e. the closest node
         inline bool operator<(const QueryCandidate & other) const {
-            return min_dist < other.min_dist;
+            return min_dist > other.min_dist;
+        }
+    };
+
+    //A street segment found by the k-nearest search. Both directions of a
+    //bidirected segment are merged into one phantom node.
+    struct NearestCandidate {
+        NearestCandidate() : distance(DBL_MAX) {}
+        PhantomNode phantom_node;
+        _Coordinate start_coordinate;
+        _Coordinate end_coordinate;
+        double distance;
+        inline bool operator<(const NearestCandidate & other) const {
+            return distance < other.distance;
         }
     };
 
@@ -277,6 +269,10 @@ private:
     uint64_t m_element_count;
 
     const std::string m_leaf_node_filename;
+    //owns the leaf data if the leaf file is memory mapped
+    MemoryMappedFile * m_leaf_node_mapping;
+    //leaves are read from here instead of the file if it is set
+    const char * m_leaf_node_data;
 public:
     //Construct a packed Hilbert-R-Tree with Kamel-Faloutsos algorithm [1]
     explicit StaticRTree(
@@ -285,7 +281,9 @@ public:
         const std::string leaf_node_filename
     )
      :  m_element_count(input_data_vector.size()),
-        m_leaf_node_filename(leaf_node_filename)
+        m_leaf_node_filename(leaf_node_filename),
+        m_leaf_node_mapping(NULL),
+        m_leaf_node_data(NULL)
     {
         INFO("constructing r-tree of " << m_element_count << " elements");
         double time1 = get_timestamp();
@@ -295,113 +293,78 @@ public:
 #pragma omp parallel for schedule(guided)
         for(uint64_t element_counter = 0; element_counter < m_element_count; ++element_counter) {
             input_wrapper_vector[element_counter].m_array_index = element_counter;
-            //Get Hilbert-Value for centroid in mercartor projection
-            DataT & current_element = input_data_vector[element_counter];
-            _Coordinate current_centroid = current_element.Centroid();
-            current_centroid.lat = 100000*lat2y(current_centroid.lat/100000.);
+            input_wrapper_vector[element_counter].m_hilbert_value = GetHilbertValueOfElement(input_data_vector[element_counter]);
+        }
 
-            uint64_t current_hilbert_value = HilbertCode::GetHilbertNumberForCoordinate(current_centroid);
-            input_wrapper_vector[element_counter].m_hilbert_value = current_hilbert_value;
+        //sort the hilbert-value representatives
+        ParallelSort(input_wrapper_vector.begin(), input_wrapper_vector.end());
 
-        }
         //open leaf file
         std::ofstream leaf_node_file(leaf_node_filename.c_str(), std::ios::binary);
         leaf_node_file.write((char*) &m_element_count, sizeof(uint64_t));
 
-        //sort the hilbert-value representatives
-        std::sort(input_wrapper_vector.begin(), input_wrapper_vector.end());
+        //pack M elements into leaf nodes and write them to leaf file chunk by chunk
         std::vector<TreeNode> tree_nodes_in_level;
-
-        //pack M elements into leaf node and write to leaf file
-        uint64_t processed_objects_count = 0;
-        while(processed_objects_count < m_element_count) {
-
-            LeafNode current_leaf;
-            TreeNode current_node;
-            for(uint32_t current_element_index = 0; RTREE_LEAF_NODE_SIZE > current_element_index; ++current_element_index) {
-                if(m_element_count > (processed_objects_count + current_element_index)) {
-                    uint32_t index_of_next_object = input_wrapper_vector[processed_objects_count + current_element_index].m_array_index;
-                    current_leaf.objects[current_element_index] = input_data_vector[index_of_next_object];
-                    ++current_leaf.object_count;
-                }
+        std::vector<DataT> sorted_chunk(RTREE_LEAF_NODE_SIZE*RTREE_LEAVES_PER_CHUNK);
+        for(uint64_t chunk_begin = 0; chunk_begin < m_element_count; chunk_begin += sorted_chunk.size()) {
+            const uint64_t chunk_size = std::min<uint64_t>(sorted_chunk.size(), m_element_count - chunk_begin);
+#pragma omp parallel for schedule(guided)
+            for(uint64_t i = 0; i < chunk_size; ++i) {
+                sorted_chunk[i] = input_data_vector[input_wrapper_vector[chunk_begin + i].m_array_index];
             }
-
-            //generate tree node that resemble the objects in leaf and store it for next level
-            current_node.minimum_bounding_rectangle.InitializeMBRectangle(current_leaf.objects, current_leaf.object_count);
-            current_node.child_is_on_disk = true;
-            current_node.children[0] = tree_nodes_in_level.size();
-            tree_nodes_in_level.push_back(current_node);
-
-            //write leaf_node to leaf node file
-            leaf_node_file.write((char*)&current_leaf, sizeof(current_leaf));
-            processed_objects_count += current_leaf.object_count;
+            PackLeaves(sorted_chunk, chunk_size, leaf_node_file, tree_nodes_in_level);
         }
 
         //close leaf file
         leaf_node_file.close();
 
-        uint32_t processing_level = 0;
-        while(1 < tree_nodes_in_level.size()) {
-            std::vector<TreeNode> tree_nodes_in_next_level;
-            uint32_t processed_tree_nodes_in_level = 0;
-            while(processed_tree_nodes_in_level < tree_nodes_in_level.size()) {
-                TreeNode parent_node;
-                //pack RTREE_BRANCHING_FACTOR elements into tree_nodes each
-                for(
-                    uint32_t current_child_node_index = 0;
-                    RTREE_BRANCHING_FACTOR > current_child_node_index;
-                    ++current_child_node_index
-                ) {
-                    if(processed_tree_nodes_in_level < tree_nodes_in_level.size()) {
-                        TreeNode & current_child_node = tree_nodes_in_level[processed_tree_nodes_in_level];
-                        //add tree node to parent entry
-                        parent_node.children[current_child_node_index] = m_search_tree.size();
-                        m_search_tree.push_back(current_child_node);
-                        //augment MBR of parent
-                        parent_node.minimum_bounding_rectangle.AugmentMBRectangle(current_child_node.minimum_bounding_rectangle);
-                        //increase counters
-                        ++parent_node.child_count;
-                        ++processed_tree_nodes_in_level;
-                    }
-                }
-                tree_nodes_in_next_level.push_back(parent_node);
-            }
-            tree_nodes_in_level.swap(tree_nodes_in_next_level);
-            ++processing_level;
-        }
-        BOOST_ASSERT_MSG(1 == tree_nodes_in_level.size(), "tree broken, more than one root node");
-        //last remaining entry is the root node, store it
-        m_search_tree.push_back(tree_nodes_in_level[0]);
+        BuildTreeLevels(tree_nodes_in_level);
+        WriteTreeNodes(tree_node_filename);
+        double time2 = get_timestamp();
+        INFO("finished r-tree construction in " << (time2-time1) << " seconds");
+    }
 
-        //reverse and renumber tree to have root at index 0
-        std::reverse(m_search_tree.begin(), m_search_tree.end());
-#pragma omp parallel for schedule(guided)
-        for(uint32_t i = 0; i < m_search_tree.size(); ++i) {
-            TreeNode & current_tree_node = m_search_tree[i];
-            for(uint32_t j = 0; j < current_tree_node.child_count; ++j) {
-                const uint32_t old_id = current_tree_node.children[j];
-                const uint32_t new_id = m_search_tree.size() - old_id - 1;
-                current_tree_node.children[j] = new_id;
-            }
+    //Packs elements that arrive in the order of their Hilbert values, e.g. from
+    //the external memory sort in StaticRTreeBuilder.h. sorted_input.Read(chunk, n)
+    //copies the next n elements into the chunk.
+    template<class SortedInputT>
+    explicit StaticRTree(
+        SortedInputT & sorted_input,
+        const uint64_t element_count,
+        const std::string tree_node_filename,
+        const std::string leaf_node_filename
+    )
+     :  m_element_count(element_count),
+        m_leaf_node_filename(leaf_node_filename),
+        m_leaf_node_mapping(NULL),
+        m_leaf_node_data(NULL)
+    {
+        //open leaf file
+        std::ofstream leaf_node_file(leaf_node_filename.c_str(), std::ios::binary);
+        leaf_node_file.write((char*) &m_element_count, sizeof(uint64_t));
+
+        //stream sorted elements into leaf nodes
+        std::vector<TreeNode> tree_nodes_in_level;
+        std::vector<DataT> sorted_chunk(RTREE_LEAF_NODE_SIZE*RTREE_LEAVES_PER_CHUNK);
+        for(uint64_t chunk_begin = 0; chunk_begin < m_element_count; chunk_begin += sorted_chunk.size()) {
+            const uint64_t chunk_size = std::min<uint64_t>(sorted_chunk.size(), m_element_count - chunk_begin);
+            sorted_input.Read(sorted_chunk, chunk_size);
+            PackLeaves(sorted_chunk, chunk_size, leaf_node_file, tree_nodes_in_level);
         }
 
-        //open tree file
-        std::ofstream tree_node_file(tree_node_filename.c_str(), std::ios::binary);
-        uint32_t size_of_tree = m_search_tree.size();
-        BOOST_ASSERT_MSG(0 < size_of_tree, "tree empty");
-        tree_node_file.write((char *)&size_of_tree, sizeof(uint32_t));
-        tree_node_file.write((char *)&m_search_tree[0], sizeof(TreeNode)*size_of_tree);
-        //close tree node file.
-        tree_node_file.close();
-        double time2 = get_timestamp();
-        INFO("finished r-tree construction in " << (time2-time1) << " seconds");
+        //close leaf file
+        leaf_node_file.close();
+
+        BuildTreeLevels(tree_nodes_in_level);
+        WriteTreeNodes(tree_node_filename);
     }
 
     //Read-only operation for queries
     explicit StaticRTree(
             const std::string & node_filename,
-            const std::string & leaf_filename
-    ) : m_leaf_node_filename(leaf_filename) {
+            const std::string & leaf_filename,
+            const bool memory_map_leaves = false
+    ) : m_leaf_node_filename(leaf_filename), m_leaf_node_mapping(NULL), m_leaf_node_data(NULL) {
         //open tree node file and load into RAM.
         std::ifstream tree_node_file(node_filename.c_str(), std::ios::binary);
         uint32_t tree_size = 0;
@@ -411,166 +374,252 @@ public:
         tree_node_file.read((char*)&m_search_tree[0], sizeof(TreeNode)*tree_size);
         tree_node_file.close();
 
-        //open leaf node file and store thread specific pointer
-        std::ifstream leaf_node_file(leaf_filename.c_str(), std::ios::binary);
-        leaf_node_file.read((char*)&m_element_count, sizeof(uint64_t));
-        leaf_node_file.close();
+        if(memory_map_leaves) {
+            //leaves are served from the page cache without any syscall
+            m_leaf_node_mapping = new MemoryMappedFile(leaf_filename);
+            m_leaf_node_mapping->AdviseRandomAccess();
+            if(!SetLeafNodeData(m_leaf_node_mapping->GetData(), m_leaf_node_mapping->GetSize())) {
+                ERR(leaf_filename << " is truncated");
+            }
+        } else {
+            //open leaf node file and store thread specific pointer
+            std::ifstream leaf_node_file(leaf_filename.c_str(), std::ios::binary);
+            leaf_node_file.read((char*)&m_element_count, sizeof(uint64_t));
+            leaf_node_file.close();
+        }
 
         //INFO( tree_size << " nodes in search tree");
         //INFO( m_element_count << " elements in leafs");
     }
-/*
-    inline void FindKNearestPhantomNodesForCoordinate(
-        const _Coordinate & location,
-        const unsigned zoom_level,
-        const unsigned candidate_count,
-        std::vector<std::pair<PhantomNode, double> > & result_vector
-    ) const {
 
+    //Read-only operation on the contents of both files that already reside
+    //in memory, e.g. in a shared memory region that outlives the tree.
+    //The tree nodes are copied, the leaves are used in place. Throws
+    //OSRMException if the data is truncated.
+    explicit StaticRTree(
+            const char * node_data,
+            const uint64_t node_data_size,
+            const char * leaf_data,
+            const uint64_t leaf_data_size
+    ) : m_leaf_node_mapping(NULL), m_leaf_node_data(NULL) {
+        if(sizeof(uint32_t) > node_data_size) {
+            throw OSRMException("r-tree index is truncated");
+        }
+        const uint32_t tree_size = *reinterpret_cast<const uint32_t *>(node_data);
+        if(sizeof(uint32_t) + tree_size*sizeof(TreeNode) > node_data_size) {
+            throw OSRMException("r-tree index is truncated");
+        }
+        const TreeNode * tree_nodes = reinterpret_cast<const TreeNode *>(node_data + sizeof(uint32_t));
+        m_search_tree.assign(tree_nodes, tree_nodes + tree_size);
+        if(!SetLeafNodeData(leaf_data, leaf_data_size)) {
+            throw OSRMException("r-tree leaf data is truncated");
+        }
+    }
+
+    ~StaticRTree() {
+        delete m_leaf_node_mapping;
+    }
+
+    //Finds the number_of_results closest street segments in a single
+    //traversal of the tree. The two directions of a bidirected segment form
+    //one result. Results are ordered by their distance in meters.
+    void FindKNearestPhantomNodesForCoordinate(
+            const _Coordinate & input_coordinate,
+            const unsigned zoom_level,
+            const unsigned number_of_results,
+            std::vector<std::pair<PhantomNode, double> > & result_vector
+    ) {
+        result_vector.clear();
+        if(0 == number_of_results) {
+            return;
+        }
         bool ignore_tiny_components = (zoom_level <= 14);
-        DataT nearest_edge;
 
         uint32_t io_count = 0;
-        uint32_t explored_tree_nodes_count = 0;
-        INFO("searching for coordinate " << input_coordinate);
-        double min_dist = DBL_MAX;
-        double min_max_dist = DBL_MAX;
-        bool found_a_nearest_edge = false;
-
-        _Coordinate nearest, current_start_coordinate, current_end_coordinate;
+        LeafNodeCache & leaf_cache = GetThreadLocalLeafCache();
+        std::vector<NearestCandidate> candidates;
+        _Coordinate nearest;
 
         //initialize queue with root element
         std::priority_queue<QueryCandidate> traversal_queue;
-        traversal_queue.push(QueryCandidate(0, m_search_tree[0].minimum_bounding_rectangle.GetMinDist(input_coordinate)));
-        BOOST_ASSERT_MSG(FLT_EPSILON > (0. - traversal_queue.top().min_dist), "Root element in NN Search has min dist != 0.");
+        traversal_queue.push(
+                QueryCandidate(0, m_search_tree[0].minimum_bounding_rectangle.GetMinDist(input_coordinate))
+        );
 
         while(!traversal_queue.empty()) {
             const QueryCandidate current_query_node = traversal_queue.top(); traversal_queue.pop();
 
-            ++explored_tree_nodes_count;
-            bool prune_downward = (current_query_node.min_dist >= min_max_dist);
-            bool prune_upward    = (current_query_node.min_dist >= min_dist);
-            if( !prune_downward && !prune_upward ) { //downward pruning
-                TreeNode & current_tree_node = m_search_tree[current_query_node.node_id];
-                if (current_tree_node.child_is_on_disk) {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
-                    ++io_count;
-                    for(uint32_t i = 0; i < current_leaf_node.object_count; ++i) {
-                        DataT & current_edge = current_leaf_node.objects[i];
-                        if(ignore_tiny_components && current_edge.belongsToTinyComponent) {
-                            continue;
-                        }
-
-                        double current_ratio = 0.;
-                        double current_perpendicular_distance = ComputePerpendicularDistance(
-                                                                                             input_coordinate,
-                                                                                             _Coordinate(current_edge.lat1, current_edge.lon1),
-                                                                                             _Coordinate(current_edge.lat2, current_edge.lon2),
-                                                                                             nearest,
-                                                                                             &current_ratio
-                                                                                             );
-
-                        if(
-                           current_perpendicular_distance < min_dist
-                           && !DoubleEpsilonCompare(
-                                                    current_perpendicular_distance,
-                                                    min_dist
-                                                    )
-                           ) { //found a new minimum
-                            min_dist = current_perpendicular_distance;
-                            result_phantom_node.edgeBasedNode = current_edge.id;
-                            result_phantom_node.nodeBasedEdgeNameID = current_edge.nameID;
-                            result_phantom_node.weight1 = current_edge.weight;
-                            result_phantom_node.weight2 = INT_MAX;
-                            result_phantom_node.location = nearest;
-                            current_start_coordinate.lat = current_edge.lat1;
-                            current_start_coordinate.lon = current_edge.lon1;
-                            current_end_coordinate.lat = current_edge.lat2;
-                            current_end_coordinate.lon = current_edge.lon2;
-                            nearest_edge = current_edge;
-                            found_a_nearest_edge = true;
-                        } else if(
-                                  DoubleEpsilonCompare(current_perpendicular_distance, min_dist) &&
-                                  1 == abs(current_edge.id - result_phantom_node.edgeBasedNode )
-                                  && CoordinatesAreEquivalent(
-                                                              current_start_coordinate,
-                                                              _Coordinate(
-                                                                          current_edge.lat1,
-                                                                          current_edge.lon1
-                                                                          ),
-                                                              _Coordinate(
-                                                                          current_edge.lat2,
-                                                                          current_edge.lon2
-                                                                          ),
-                                                              current_end_coordinate
-                                                              )
-                                  ) {
-                            result_phantom_node.edgeBasedNode = std::min(current_edge.id, result_phantom_node.edgeBasedNode);
-                            result_phantom_node.weight2 = current_edge.weight;
-                        }
+            //the queue is ordered, no closer segment can follow
+            if(
+                    number_of_results == candidates.size() &&
+                    current_query_node.min_dist > candidates.back().distance
+            ) {
+                break;
+            }
+            TreeNode & current_tree_node = m_search_tree[current_query_node.node_id];
+            if (current_tree_node.child_is_on_disk) {
+                const LeafNode & current_leaf_node = LoadLeafThroughCache(
+                        current_tree_node.children[0],
+                        leaf_cache,
+                        io_count
+                );
+                for(uint32_t i = 0; i < current_leaf_node.object_count; ++i) {
+                    const DataT & current_edge = current_leaf_node.objects[i];
+                    if(ignore_tiny_components && current_edge.belongsToTinyComponent) {
+                        continue;
                     }
-                } else {
-                    //traverse children, prune if global mindist is smaller than local one
-                    for (uint32_t i = 0; i < current_tree_node.child_count; ++i) {
-                        const int32_t child_id = current_tree_node.children[i];
-                        TreeNode & child_tree_node = m_search_tree[child_id];
-                        RectangleT & child_rectangle = child_tree_node.minimum_bounding_rectangle;
-                        const double current_min_dist = child_rectangle.GetMinDist(input_coordinate);
-                        const double current_min_max_dist = child_rectangle.GetMinMaxDist(input_coordinate);
-                        if( current_min_max_dist < min_max_dist ) {
-                            min_max_dist = current_min_max_dist;
-                        }
-                        if (current_min_dist > min_max_dist) {
-                            continue;
-                        }
-                        if (current_min_dist > min_dist) { //upward pruning
-                            continue;
-                        }
-                        traversal_queue.push(QueryCandidate(child_id, current_min_dist));
+                    if(current_edge.isIgnored()) {
+                        continue;
+                    }
+                    double current_ratio = 0.;
+                    ComputePerpendicularDistance(
+                            input_coordinate,
+                            _Coordinate(current_edge.lat1, current_edge.lon1),
+                            _Coordinate(current_edge.lat2, current_edge.lon2),
+                            nearest,
+                            &current_ratio
+                    );
+                    //candidates are ranked in meters like the tree nodes
+                    const double current_distance = ApproximateDistance(input_coordinate, nearest);
+                    if(
+                            number_of_results == candidates.size() &&
+                            current_distance > candidates.back().distance
+                    ) {
+                        continue;
+                    }
+                    AddNearestCandidate(
+                            current_edge,
+                            current_distance,
+                            nearest,
+                            number_of_results,
+                            candidates
+                    );
+                }
+            } else {
+                for (uint32_t i = 0; i < current_tree_node.child_count; ++i) {
+                    const int32_t child_id = current_tree_node.children[i];
+                    const double current_min_dist = m_search_tree[child_id].minimum_bounding_rectangle.GetMinDist(input_coordinate);
+                    if(
+                            number_of_results == candidates.size() &&
+                            current_min_dist > candidates.back().distance
+                    ) {
+                        continue;
                     }
+                    traversal_queue.push(QueryCandidate(child_id, current_min_dist));
                 }
             }
         }
 
-        const double distance_to_edge =
-        ApproximateDistance (
-            _Coordinate(nearest_edge.lat1, nearest_edge.lon1),
-            result_phantom_node.location
-        );
+        BOOST_FOREACH(const NearestCandidate & candidate, candidates) {
+            PhantomNode phantom_node = candidate.phantom_node;
+            const double ratio = std::min(1.,
+                ApproximateDistance(candidate.start_coordinate, phantom_node.location)/
+                ApproximateDistance(candidate.start_coordinate, candidate.end_coordinate)
+            );
+            phantom_node.weight1 *= ratio;
+            if(INT_MAX != phantom_node.weight2) {
+                phantom_node.weight2 *= (1.-ratio);
+            }
+            phantom_node.ratio = ratio;
+
+            //Hack to fix rounding errors and wandering via nodes.
+            if(std::abs(input_coordinate.lon - phantom_node.location.lon) == 1) {
+                phantom_node.location.lon = input_coordinate.lon;
+            }
+            if(std::abs(input_coordinate.lat - phantom_node.location.lat) == 1) {
+                phantom_node.location.lat = input_coordinate.lat;
+            }
+            result_vector.push_back(std::make_pair(phantom_node, candidate.distance));
+        }
+    }
+
+    //Hilbert value of the centroid in mercator projection
+    static inline uint64_t GetHilbertValueOfElement(const DataT & element) {
+        _Coordinate current_centroid = element.Centroid();
+        current_centroid.lat = 100000*lat2y(current_centroid.lat/100000.);
+        return HilbertCode::GetHilbertNumberForCoordinate(current_centroid);
+    }
 
-        const double length_of_edge =
-        ApproximateDistance(
-            _Coordinate(nearest_edge.lat1, nearest_edge.lon1),
-            _Coordinate(nearest_edge.lat2, nearest_edge.lon2)
+    bool FindPhantomNodeForCoordinate(
+            const _Coordinate & input_coordinate,
+            PhantomNode & result_phantom_node,
+            const unsigned zoom_level
+    ) {
+        return FindPhantomNodeForCoordinate(
+                input_coordinate,
+                result_phantom_node,
+                zoom_level,
+                GetThreadLocalLeafCache()
         );
+    }
 
-        const double ratio = (found_a_nearest_edge ?
-          std::min(1., distance_to_edge/ length_of_edge ) : 0 );
-        result_phantom_node.weight1 *= ratio;
-        if(INT_MAX != result_phantom_node.weight2) {
-            result_phantom_node.weight2 *= (1.-ratio);
+    //Resolves a batch of coordinates. Queries are answered in the order of the
+    //Hilbert values of their locations, s.t. subsequent queries mostly hit the
+    //leaves that are still cached from the previous ones.
+    void FindPhantomNodesForCoordinates(
+            const std::vector<_Coordinate> & input_coordinates,
+            std::vector<PhantomNode> & result_phantom_nodes,
+            const unsigned zoom_level
+    ) {
+        result_phantom_nodes.clear();
+        result_phantom_nodes.resize(input_coordinates.size());
+
+        std::vector<WrappedInputElement> query_order(input_coordinates.size());
+        for(uint32_t i = 0; i < input_coordinates.size(); ++i) {
+            _Coordinate projected_coordinate = input_coordinates[i];
+            projected_coordinate.lat = 100000*lat2y(projected_coordinate.lat/100000.);
+            query_order[i] = WrappedInputElement(
+                    i,
+                    HilbertCode::GetHilbertNumberForCoordinate(projected_coordinate)
+            );
         }
-        result_phantom_node.ratio = ratio;
-
-        //Hack to fix rounding errors and wandering via nodes.
-        if(std::abs(input_coordinate.lon - result_phantom_node.location.lon) == 1) {
-            result_phantom_node.location.lon = input_coordinate.lon;
+        std::sort(query_order.begin(), query_order.end());
+
+        LeafNodeCache leaf_cache(RTREE_BATCH_LEAF_CACHE_SIZE);
+        BOOST_FOREACH(const WrappedInputElement & query, query_order) {
+            FindPhantomNodeForCoordinate(
+                    input_coordinates[query.m_array_index],
+                    result_phantom_nodes[query.m_array_index],
+                    zoom_level,
+                    leaf_cache
+            );
         }
-        if(std::abs(input_coordinate.lat - result_phantom_node.location.lat) == 1) {
-            result_phantom_node.location.lat = input_coordinate.lat;
+    }
+private:
+    //Small round-robin cache of leaves that were read from disk
+    struct LeafNodeCache {
+        explicit LeafNodeCache(const uint32_t size) :
+            leaf_ids(size, UINT_MAX),
+            leaves(size),
+            next_slot(0) {}
+
+        std::vector<uint32_t> leaf_ids;
+        std::vector<LeafNode> leaves;
+        uint32_t next_slot;
+
+        void Invalidate() {
+            std::fill(leaf_ids.begin(), leaf_ids.end(), UINT_MAX);
+            next_slot = 0;
         }
+    };
 
-        INFO("mindist: " << min_distphantom_node.isBidirected() ? "yes" : "no") );
-        return found_a_nearest_edge;
+    static boost::thread_specific_ptr<LeafNodeCache> m_thread_local_leaf_cache;
 
+    //Single queries share a cache per thread instead of allocating a leaf each. It is
+    //invalidated first, the leaf may stem from another tree.
+    inline LeafNodeCache & GetThreadLocalLeafCache() {
+        if(!m_thread_local_leaf_cache.get()) {
+            m_thread_local_leaf_cache.reset(new LeafNodeCache(1));
+        }
+        m_thread_local_leaf_cache->Invalidate();
+        return *m_thread_local_leaf_cache;
     }
 
-  */
     bool FindPhantomNodeForCoordinate(
             const _Coordinate & input_coordinate,
             PhantomNode & result_phantom_node,
-            const unsigned zoom_level
+            const unsigned zoom_level,
+            LeafNodeCache & leaf_cache
     ) {
 
         bool ignore_tiny_components = (zoom_level <= 14);
@@ -606,12 +655,14 @@ public:
             if( !prune_downward && !prune_upward ) { //downward pruning
                 TreeNode & current_tree_node = m_search_tree[current_query_node.node_id];
                 if (current_tree_node.child_is_on_disk) {
-                    LeafNode current_leaf_node;
-                    LoadLeafFromDisk(current_tree_node.children[0], current_leaf_node);
-                    ++io_count;
+                    const LeafNode & current_leaf_node = LoadLeafThroughCache(
+                            current_tree_node.children[0],
+                            leaf_cache,
+                            io_count
+                    );
                     //INFO("checking " << current_leaf_node.object_count << " elements");
                     for(uint32_t i = 0; i < current_leaf_node.object_count; ++i) {
-                        DataT & current_edge = current_leaf_node.objects[i];
+                        const DataT & current_edge = current_leaf_node.objects[i];
                         if(ignore_tiny_components && current_edge.belongsToTinyComponent) {
                             continue;
                         }
@@ -720,8 +771,101 @@ public:
         return found_a_nearest_edge;
 
     }
-private:
+
+    //Merges the edge into the candidate of its opposite direction or inserts
+    //it as a new candidate. Only the number_of_results closest are kept.
+    inline void AddNearestCandidate(
+            const DataT & current_edge,
+            const double distance,
+            const _Coordinate & nearest,
+            const unsigned number_of_results,
+            std::vector<NearestCandidate> & candidates
+    ) const {
+        const _Coordinate edge_start(current_edge.lat1, current_edge.lon1);
+        const _Coordinate edge_end(current_edge.lat2, current_edge.lon2);
+        BOOST_FOREACH(NearestCandidate & candidate, candidates) {
+            PhantomNode & phantom_node = candidate.phantom_node;
+            if(
+                    INT_MAX == phantom_node.weight2 &&
+                    (current_edge.id == phantom_node.edgeBasedNode+1 || current_edge.id+1 == phantom_node.edgeBasedNode) &&
+                    CoordinatesAreEquivalent(candidate.start_coordinate, edge_start, edge_end, candidate.end_coordinate)
+            ) {
+                phantom_node.weight2 = current_edge.weight;
+                if(current_edge.id < phantom_node.edgeBasedNode) {
+                    phantom_node.edgeBasedNode = current_edge.id;
+                    std::swap(phantom_node.weight1, phantom_node.weight2);
+                    std::swap(candidate.start_coordinate, candidate.end_coordinate);
+                }
+                return;
+            }
+        }
+
+        NearestCandidate new_candidate;
+        new_candidate.phantom_node.edgeBasedNode = current_edge.id;
+        new_candidate.phantom_node.nodeBasedEdgeNameID = current_edge.nameID;
+        new_candidate.phantom_node.weight1 = current_edge.weight;
+        new_candidate.phantom_node.weight2 = INT_MAX;
+        new_candidate.phantom_node.location = nearest;
+        new_candidate.start_coordinate = edge_start;
+        new_candidate.end_coordinate = edge_end;
+        new_candidate.distance = distance;
+        candidates.insert(
+            std::upper_bound(candidates.begin(), candidates.end(), new_candidate),
+            new_candidate
+        );
+        if(candidates.size() > number_of_results) {
+            candidates.resize(number_of_results);
+        }
+    }
+
+    inline const LeafNode & LoadLeafThroughCache(
+            const uint32_t leaf_id,
+            LeafNodeCache & leaf_cache,
+            uint32_t & io_count
+    ) {
+        if(NULL != m_leaf_node_data) {
+            ++io_count;
+            return GetMappedLeaf(leaf_id);
+        }
+        for(uint32_t i = 0; i < leaf_cache.leaf_ids.size(); ++i) {
+            if(leaf_id == leaf_cache.leaf_ids[i]) {
+                return leaf_cache.leaves[i];
+            }
+        }
+        const uint32_t slot = leaf_cache.next_slot;
+        leaf_cache.next_slot = (slot + 1) % leaf_cache.leaf_ids.size();
+        LoadLeafFromDisk(leaf_id, leaf_cache.leaves[slot]);
+        leaf_cache.leaf_ids[slot] = leaf_id;
+        ++io_count;
+        return leaf_cache.leaves[slot];
+    }
+
+    //returns false if the leaf data is truncated
+    inline bool SetLeafNodeData(const char * leaf_data, const uint64_t leaf_data_size) {
+        if(sizeof(uint64_t) > leaf_data_size) {
+            return false;
+        }
+        m_element_count = *reinterpret_cast<const uint64_t *>(leaf_data);
+        const uint64_t number_of_leaves = (m_element_count + RTREE_LEAF_NODE_SIZE - 1)/RTREE_LEAF_NODE_SIZE;
+        if(sizeof(uint64_t) + number_of_leaves*sizeof(LeafNode) > leaf_data_size) {
+            return false;
+        }
+        m_leaf_node_data = leaf_data;
+        return true;
+    }
+
+    inline const LeafNode & GetMappedLeaf(const uint32_t leaf_id) const {
+        const LeafNode * leaves = reinterpret_cast<const LeafNode *>(
+                m_leaf_node_data + sizeof(uint64_t)
+        );
+        return leaves[leaf_id];
+    }
+
     inline void LoadLeafFromDisk(const uint32_t leaf_id, LeafNode& result_node) {
+        if(NULL != m_leaf_node_data) {
+            result_node = GetMappedLeaf(leaf_id);
+            return;
+        }
         if(!thread_local_rtree_stream.get() || !thread_local_rtree_stream->is_open()) {
             thread_local_rtree_stream.reset(
                 new std::ifstream(
@@ -739,6 +883,100 @@ private:
         thread_local_rtree_stream->read((char *)&result_node, sizeof(LeafNode));
     }
 
+    template<typename IteratorT>
+    static inline void ParallelSort(IteratorT begin, IteratorT end) {
+#if defined(_OPENMP) && defined(__GLIBCXX__)
+        __gnu_parallel::sort(begin, end);
+#else
+        std::sort(begin, end);
+#endif
+    }
+
+    //Packs a chunk of sorted elements into leaves, writes them to the leaf
+    //file and appends a tree node for each of them to the lowest level.
+    void PackLeaves(
+        const std::vector<DataT> & sorted_chunk,
+        const uint64_t chunk_size,
+        std::ofstream & leaf_node_file,
+        std::vector<TreeNode> & tree_nodes_in_level
+    ) const {
+        const uint32_t number_of_leaves = (chunk_size + RTREE_LEAF_NODE_SIZE - 1)/RTREE_LEAF_NODE_SIZE;
+        const uint32_t first_leaf_id = tree_nodes_in_level.size();
+        std::vector<LeafNode> leaves(number_of_leaves);
+        tree_nodes_in_level.resize(first_leaf_id + number_of_leaves);
+#pragma omp parallel for schedule(guided)
+        for(uint32_t leaf_index = 0; leaf_index < number_of_leaves; ++leaf_index) {
+            LeafNode & current_leaf = leaves[leaf_index];
+            const uint64_t first_element = static_cast<uint64_t>(leaf_index)*RTREE_LEAF_NODE_SIZE;
+            current_leaf.object_count = std::min<uint64_t>(RTREE_LEAF_NODE_SIZE, chunk_size - first_element);
+            std::copy(
+                sorted_chunk.begin() + first_element,
+                sorted_chunk.begin() + first_element + current_leaf.object_count,
+                current_leaf.objects
+            );
+
+            //generate tree node that resemble the objects in leaf and store it for next level
+            TreeNode & current_node = tree_nodes_in_level[first_leaf_id + leaf_index];
+            current_node.minimum_bounding_rectangle.InitializeMBRectangle(current_leaf.objects, current_leaf.object_count);
+            current_node.child_is_on_disk = true;
+            current_node.children[0] = first_leaf_id + leaf_index;
+        }
+        leaf_node_file.write((char*)&leaves[0], sizeof(LeafNode)*number_of_leaves);
+    }
+
+    //Builds the inner levels bottom-up. The parents of a level are packed and
+    //their MBRs computed in parallel.
+    void BuildTreeLevels(std::vector<TreeNode> & tree_nodes_in_level) {
+        while(1 < tree_nodes_in_level.size()) {
+            const uint32_t first_child_id = m_search_tree.size();
+            const uint32_t number_of_children = tree_nodes_in_level.size();
+            m_search_tree.insert(m_search_tree.end(), tree_nodes_in_level.begin(), tree_nodes_in_level.end());
+
+            //pack RTREE_BRANCHING_FACTOR elements into tree_nodes each
+            const uint32_t number_of_parents = (number_of_children + RTREE_BRANCHING_FACTOR - 1)/RTREE_BRANCHING_FACTOR;
+            std::vector<TreeNode> tree_nodes_in_next_level(number_of_parents);
+#pragma omp parallel for schedule(guided)
+            for(uint32_t parent_index = 0; parent_index < number_of_parents; ++parent_index) {
+                TreeNode & parent_node = tree_nodes_in_next_level[parent_index];
+                const uint32_t first_child = parent_index*RTREE_BRANCHING_FACTOR;
+                const uint32_t last_child = std::min(first_child + RTREE_BRANCHING_FACTOR, number_of_children);
+                for(uint32_t child_index = first_child; child_index < last_child; ++child_index) {
+                    //add tree node to parent entry and augment MBR of parent
+                    parent_node.children[parent_node.child_count] = first_child_id + child_index;
+                    parent_node.minimum_bounding_rectangle.AugmentMBRectangle(tree_nodes_in_level[child_index].minimum_bounding_rectangle);
+                    ++parent_node.child_count;
+                }
+            }
+            tree_nodes_in_level.swap(tree_nodes_in_next_level);
+        }
+        BOOST_ASSERT_MSG(1 == tree_nodes_in_level.size(), "tree broken, more than one root node");
+        //last remaining entry is the root node, store it
+        m_search_tree.push_back(tree_nodes_in_level[0]);
+
+        //reverse and renumber tree to have root at index 0
+        std::reverse(m_search_tree.begin(), m_search_tree.end());
+#pragma omp parallel for schedule(guided)
+        for(uint32_t i = 0; i < m_search_tree.size(); ++i) {
+            TreeNode & current_tree_node = m_search_tree[i];
+            for(uint32_t j = 0; j < current_tree_node.child_count; ++j) {
+                const uint32_t old_id = current_tree_node.children[j];
+                const uint32_t new_id = m_search_tree.size() - old_id - 1;
+                current_tree_node.children[j] = new_id;
+            }
+        }
+    }
+
+    void WriteTreeNodes(const std::string & tree_node_filename) const {
+        //open tree file
+        std::ofstream tree_node_file(tree_node_filename.c_str(), std::ios::binary);
+        uint32_t size_of_tree = m_search_tree.size();
+        BOOST_ASSERT_MSG(0 < size_of_tree, "tree empty");
+        tree_node_file.write((char *)&size_of_tree, sizeof(uint32_t));
+        tree_node_file.write((char *)&m_search_tree[0], sizeof(TreeNode)*size_of_tree);
+        //close tree node file.
+        tree_node_file.close();
+    }
+
     inline double ComputePerpendicularDistance(
             const _Coordinate& inputPoint,
             const _Coordinate& source,
@@ -797,6 +1035,9 @@ private:
 
 };
 
+template<class DataT>
+boost::thread_specific_ptr<typename StaticRTree<DataT>::LeafNodeCache> StaticRTree<DataT>::m_thread_local_leaf_cache;
+
 //[1] "On Packing R-Trees"; I. Kamel, C. Faloutsos; 1993; DOI: 10.1145/170088.170403
 //[2] "Nearest Neighbor Queries", N. Roussopulos et al; 1995; DOI: 10.1145/223784.223794
 
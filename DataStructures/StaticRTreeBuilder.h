@@ -0,0 +1,137 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef STATICRTREEBUILDER_H_
+#define STATICRTREEBUILDER_H_
+
+#include "StaticRTree.h"
+#include "TimingUtil.h"
+#include "../typedefs.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <stxxl.h>
+
+//Constructs a StaticRTree whose input and sorted elements are kept in external
+//memory. Only the preprocessing includes this header, s.t. the users of the
+//r-tree do not depend on stxxl.
+template<class DataT>
+class StaticRTreeBuilder : boost::noncopyable {
+public:
+    //At most memory_to_use bytes of RAM are used for sorting, s.t. the
+    //construction does not need RAM for all elements at once.
+    static StaticRTree<DataT> * BuildInExternalMemory(
+        stxxl::vector<DataT> & input_data_vector,
+        const std::string tree_node_filename,
+        const std::string leaf_node_filename,
+        const uint64_t memory_to_use
+    ) {
+        const uint64_t element_count = input_data_vector.size();
+        INFO("constructing r-tree of " << element_count << " elements in external memory");
+        double time1 = get_timestamp();
+        stxxl::vector<HilbertSortedElement> sorted_element_vector;
+        sorted_element_vector.reserve(element_count);
+
+        //generate hilbert-values chunk by chunk
+        std::vector<DataT> input_chunk(RTREE_LEAF_NODE_SIZE*RTREE_LEAVES_PER_CHUNK);
+        std::vector<uint64_t> hilbert_values(input_chunk.size());
+        typename stxxl::vector<DataT>::const_iterator input_iterator = input_data_vector.begin();
+        for(uint64_t chunk_begin = 0; chunk_begin < element_count; chunk_begin += input_chunk.size()) {
+            const uint64_t chunk_size = std::min<uint64_t>(input_chunk.size(), element_count - chunk_begin);
+            for(uint64_t i = 0; i < chunk_size; ++i, ++input_iterator) {
+                input_chunk[i] = *input_iterator;
+            }
+#pragma omp parallel for schedule(guided)
+            for(uint64_t i = 0; i < chunk_size; ++i) {
+                hilbert_values[i] = StaticRTree<DataT>::GetHilbertValueOfElement(input_chunk[i]);
+            }
+            for(uint64_t i = 0; i < chunk_size; ++i) {
+                sorted_element_vector.push_back(HilbertSortedElement(hilbert_values[i], input_chunk[i]));
+            }
+        }
+
+        //sort runs on disk and merge them
+        stxxl::sort(
+            sorted_element_vector.begin(),
+            sorted_element_vector.end(),
+            CmpHilbertSortedElement(),
+            memory_to_use
+        );
+
+        SortedElementReader sorted_input(sorted_element_vector);
+        StaticRTree<DataT> * rtree = new StaticRTree<DataT>(
+            sorted_input,
+            element_count,
+            tree_node_filename,
+            leaf_node_filename
+        );
+        double time2 = get_timestamp();
+        INFO("finished r-tree construction in " << (time2-time1) << " seconds");
+        return rtree;
+    }
+
+private:
+    //Element of the external memory construction, sorted along with its value
+    struct HilbertSortedElement {
+        HilbertSortedElement() : m_hilbert_value(0) {}
+        HilbertSortedElement(
+            const uint64_t hilbert_value,
+            const DataT & object
+        ) : m_hilbert_value(hilbert_value), m_object(object) {}
+
+        uint64_t m_hilbert_value;
+        DataT m_object;
+    };
+
+    struct CmpHilbertSortedElement : public std::binary_function<HilbertSortedElement, HilbertSortedElement, bool> {
+        typedef HilbertSortedElement value_type;
+        bool operator ()  (const HilbertSortedElement & a, const HilbertSortedElement & b) const {
+            return a.m_hilbert_value < b.m_hilbert_value;
+        }
+        value_type max_value() {
+            return HilbertSortedElement(std::numeric_limits<uint64_t>::max(), DataT());
+        }
+        value_type min_value() {
+            return HilbertSortedElement(0, DataT());
+        }
+    };
+
+    //Streams the sorted elements into the leaves of the tree
+    class SortedElementReader {
+    public:
+        explicit SortedElementReader(const stxxl::vector<HilbertSortedElement> & sorted_element_vector)
+        : m_sorted_iterator(sorted_element_vector.begin()) {}
+
+        void Read(std::vector<DataT> & chunk, const uint64_t chunk_size) {
+            for(uint64_t i = 0; i < chunk_size; ++i, ++m_sorted_iterator) {
+                chunk[i] = m_sorted_iterator->m_object;
+            }
+        }
+    private:
+        typename stxxl::vector<HilbertSortedElement>::const_iterator m_sorted_iterator;
+    };
+};
+
+#endif /* STATICRTREEBUILDER_H_ */
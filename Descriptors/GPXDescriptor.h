@@ -22,6 +22,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #define GPX_DESCRIPTOR_H_
 
 #include "BaseDescriptor.h"
+#include "../Util/ResponseWriter.h"
 
 #include <boost/foreach.hpp>
 
@@ -30,37 +31,33 @@ private:
     _DescriptorConfig config;
     _Coordinate current;
 
-    std::string tmp;
+    inline void WriteRoutePoint(const _Coordinate & coordinate, ResponseWriter & out) {
+        out.Write("<rtept lat=\"");
+        out.WriteLatLon(coordinate.lat);
+        out.Write("\" lon=\"");
+        out.WriteLatLon(coordinate.lon);
+        out.Write("\"></rtept>");
+    }
 public:
     void SetConfig(const _DescriptorConfig& c) { config = c; }
     void Run(http::Reply & reply, const RawRouteData &rawRoute, PhantomNodes &phantomNodes, SearchEngine &sEngine) {
-        reply.content += ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
-        reply.content += "<gpx creator=\"OSRM Routing Engine\" version=\"1.1\" xmlns=\"http://www.topografix.com/GPX/1/1\" "
+        ResponseWriter out(reply.content);
+        out.Write("<?xml version=\"1.0\" encoding=\"UTF-8\"?>");
+        out.Write("<gpx creator=\"OSRM Routing Engine\" version=\"1.1\" xmlns=\"http://www.topografix.com/GPX/1/1\" "
                 "xmlns:xsi=\"http://www.w3.org/2001/XMLSchema-instance\" "
                 "xsi:schemaLocation=\"http://www.topografix.com/GPX/1/1 gpx.xsd"
-                "\">";
-        reply.content += "<metadata><copyright author=\"Project OSRM\"><license>Data (c) OpenStreetMap contributors (ODbL)</license></copyright></metadata>";
-        reply.content += "<rte>";
+                "\">");
+        out.Write("<metadata><copyright author=\"Project OSRM\"><license>Data (c) OpenStreetMap contributors (ODbL)</license></copyright></metadata>");
+        out.Write("<rte>");
         if(rawRoute.lengthOfShortestPath != INT_MAX && rawRoute.computedShortestPath.size()) {
-            convertInternalLatLonToString(phantomNodes.startPhantom.location.lat, tmp);
-            reply.content += "<rtept lat=\"" + tmp + "\" ";
-            convertInternalLatLonToString(phantomNodes.startPhantom.location.lon, tmp);
-            reply.content += "lon=\"" + tmp + "\"></rtept>";
-
+            WriteRoutePoint(phantomNodes.startPhantom.location, out);
             BOOST_FOREACH(const _PathData & pathData, rawRoute.computedShortestPath) {
                 sEngine.GetCoordinatesForNodeID(pathData.node, current);
-
-                convertInternalLatLonToString(current.lat, tmp);
-                reply.content += "<rtept lat=\"" + tmp + "\" ";
-                convertInternalLatLonToString(current.lon, tmp);
-                reply.content += "lon=\"" + tmp + "\"></rtept>";
+                WriteRoutePoint(current, out);
             }
-            convertInternalLatLonToString(phantomNodes.targetPhantom.location.lat, tmp);
-            reply.content += "<rtept lat=\"" + tmp + "\" ";
-            convertInternalLatLonToString(phantomNodes.targetPhantom.location.lon, tmp);
-            reply.content += "lon=\"" + tmp + "\"></rtept>";
+            WriteRoutePoint(phantomNodes.targetPhantom.location, out);
         }
-        reply.content += "</rte></gpx>";
+        out.Write("</rte></gpx>");
     }
 };
 #endif /* GPX_DESCRIPTOR_H_ */
@@ -27,6 +27,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "../DataStructures/SegmentInformation.h"
 #include "../DataStructures/TurnInstructions.h"
 #include "../Util/Azimuth.h"
+#include "../Util/ResponseWriter.h"
 #include "../Util/StringUtil.h"
 
 #include <boost/bind.hpp>
@@ -74,12 +75,13 @@ public:
 
     void Run(http::Reply & reply, const RawRouteData &rawRoute, PhantomNodes &phantomNodes, SearchEngine &sEngine) {
 
-        WriteHeaderToOutput(reply.content);
+        ResponseWriter out(reply.content);
+        WriteHeaderToOutput(out);
 
         if(rawRoute.lengthOfShortestPath != INT_MAX) {
             descriptionFactory.SetStartSegment(phantomNodes.startPhantom);
-            reply.content += "0,"
-                    "\"status_message\": \"Found route between points\",";
+            out.Write("0,"
+                    "\"status_message\": \"Found route between points\",");
 
             //Get all the coordinates for the computed route
             BOOST_FOREACH(const _PathData & pathData, rawRoute.computedShortestPath) {
@@ -89,48 +91,48 @@ public:
             descriptionFactory.SetEndSegment(phantomNodes.targetPhantom);
         } else {
             //We do not need to do much, if there is no route ;-)
-            reply.content += "207,"
-                    "\"status_message\": \"Cannot find route between points\",";
+            out.Write("207,"
+                    "\"status_message\": \"Cannot find route between points\",");
         }
 
         descriptionFactory.Run(sEngine, config.z);
-        reply.content += "\"route_geometry\": ";
+        out.Write("\"route_geometry\": ");
         if(config.geometry) {
             descriptionFactory.AppendEncodedPolylineString(reply.content, config.encodeGeometry);
         } else {
-            reply.content += "[]";
+            out.Write("[]");
         }
 
-        reply.content += ","
-                "\"route_instructions\": [";
+        out.Write(","
+                "\"route_instructions\": [");
         numberOfEnteredRestrictedAreas = 0;
         if(config.instructions) {
-            BuildTextualDescription(descriptionFactory, reply, rawRoute.lengthOfShortestPath, sEngine, shortestSegments);
+            BuildTextualDescription(descriptionFactory, out, rawRoute.lengthOfShortestPath, sEngine, shortestSegments);
         } else {
             BOOST_FOREACH(const SegmentInformation & segment, descriptionFactory.pathDescription) {
                 TurnInstruction currentInstruction = segment.turnInstruction & TurnInstructions.InverseAccessRestrictionFlag;
                 numberOfEnteredRestrictedAreas += (currentInstruction != segment.turnInstruction);
             }
         }
-        reply.content += "],";
+        out.Write("],");
         descriptionFactory.BuildRouteSummary(descriptionFactory.entireLength, rawRoute.lengthOfShortestPath - ( numberOfEnteredRestrictedAreas*TurnInstructions.AccessRestrictionPenalty));
 
-        reply.content += "\"route_summary\":";
-        reply.content += "{";
-        reply.content += "\"total_distance\":";
-        reply.content += descriptionFactory.summary.lengthString;
-        reply.content += ","
-                "\"total_time\":";
-        reply.content += descriptionFactory.summary.durationString;
-        reply.content += ","
-                "\"start_point\":\"";
-        reply.content += sEngine.GetEscapedNameForNameID(descriptionFactory.summary.startName);
-        reply.content += "\","
-                "\"end_point\":\"";
-        reply.content += sEngine.GetEscapedNameForNameID(descriptionFactory.summary.destName);
-        reply.content += "\"";
-        reply.content += "}";
-        reply.content +=",";
+        out.Write("\"route_summary\":");
+        out.Write("{");
+        out.Write("\"total_distance\":");
+        out.Write(descriptionFactory.summary.lengthString);
+        out.Write(","
+                "\"total_time\":");
+        out.Write(descriptionFactory.summary.durationString);
+        out.Write(","
+                "\"start_point\":\"");
+        out.Write(sEngine.GetEscapedNameForNameID(descriptionFactory.summary.startName));
+        out.Write("\","
+                "\"end_point\":\"");
+        out.Write(sEngine.GetEscapedNameForNameID(descriptionFactory.summary.destName));
+        out.Write("\"");
+        out.Write("}");
+        out.Write(",");
 
         //only one alternative route is computed at this time, so this is hardcoded
 
@@ -146,108 +148,103 @@ public:
         alternateDescriptionFactory.Run(sEngine, config.z);
 
         //give an array of alternative routes
-        reply.content += "\"alternative_geometries\": [";
+        out.Write("\"alternative_geometries\": [");
         if(config.geometry && INT_MAX != rawRoute.lengthOfAlternativePath) {
             //Generate the linestrings for each alternative
             alternateDescriptionFactory.AppendEncodedPolylineString(reply.content, config.encodeGeometry);
         }
-        reply.content += "],";
-        reply.content += "\"alternative_instructions\":[";
+        out.Write("],");
+        out.Write("\"alternative_instructions\":[");
         numberOfEnteredRestrictedAreas = 0;
         if(INT_MAX != rawRoute.lengthOfAlternativePath) {
-            reply.content += "[";
+            out.Write("[");
             //Generate instructions for each alternative
             if(config.instructions) {
-                BuildTextualDescription(alternateDescriptionFactory, reply, rawRoute.lengthOfAlternativePath, sEngine, alternativeSegments);
+                BuildTextualDescription(alternateDescriptionFactory, out, rawRoute.lengthOfAlternativePath, sEngine, alternativeSegments);
             } else {
                 BOOST_FOREACH(const SegmentInformation & segment, alternateDescriptionFactory.pathDescription) {
                 	TurnInstruction currentInstruction = segment.turnInstruction & TurnInstructions.InverseAccessRestrictionFlag;
                     numberOfEnteredRestrictedAreas += (currentInstruction != segment.turnInstruction);
                 }
             }
-            reply.content += "]";
+            out.Write("]");
         }
-        reply.content += "],";
-        reply.content += "\"alternative_summaries\":[";
+        out.Write("],");
+        out.Write("\"alternative_summaries\":[");
         if(INT_MAX != rawRoute.lengthOfAlternativePath) {
             //Generate route summary (length, duration) for each alternative
             alternateDescriptionFactory.BuildRouteSummary(alternateDescriptionFactory.entireLength, rawRoute.lengthOfAlternativePath - ( numberOfEnteredRestrictedAreas*TurnInstructions.AccessRestrictionPenalty));
-            reply.content += "{";
-            reply.content += "\"total_distance\":";
-            reply.content += alternateDescriptionFactory.summary.lengthString;
-            reply.content += ","
-                    "\"total_time\":";
-            reply.content += alternateDescriptionFactory.summary.durationString;
-            reply.content += ","
-                    "\"start_point\":\"";
-            reply.content += sEngine.GetEscapedNameForNameID(descriptionFactory.summary.startName);
-            reply.content += "\","
-                    "\"end_point\":\"";
-            reply.content += sEngine.GetEscapedNameForNameID(descriptionFactory.summary.destName);
-            reply.content += "\"";
-            reply.content += "}";
+            out.Write("{");
+            out.Write("\"total_distance\":");
+            out.Write(alternateDescriptionFactory.summary.lengthString);
+            out.Write(","
+                    "\"total_time\":");
+            out.Write(alternateDescriptionFactory.summary.durationString);
+            out.Write(","
+                    "\"start_point\":\"");
+            out.Write(sEngine.GetEscapedNameForNameID(descriptionFactory.summary.startName));
+            out.Write("\","
+                    "\"end_point\":\"");
+            out.Write(sEngine.GetEscapedNameForNameID(descriptionFactory.summary.destName));
+            out.Write("\"");
+            out.Write("}");
         }
-        reply.content += "],";
+        out.Write("],");
 
         //Get Names for both routes
         RouteNames routeNames;
         GetRouteNames(shortestSegments, alternativeSegments, sEngine, routeNames);
 
-        reply.content += "\"route_name\":[\"";
-        reply.content += routeNames.shortestPathName1;
-        reply.content += "\",\"";
-        reply.content += routeNames.shortestPathName2;
-        reply.content += "\"],"
-                "\"alternative_names\":[";
-        reply.content += "[\"";
-        reply.content += routeNames.alternativePathName1;
-        reply.content += "\",\"";
-        reply.content += routeNames.alternativePathName2;
-        reply.content += "\"]";
-        reply.content += "],";
+        out.Write("\"route_name\":[\"");
+        out.Write(routeNames.shortestPathName1);
+        out.Write("\",\"");
+        out.Write(routeNames.shortestPathName2);
+        out.Write("\"],"
+                "\"alternative_names\":[");
+        out.Write("[\"");
+        out.Write(routeNames.alternativePathName1);
+        out.Write("\",\"");
+        out.Write(routeNames.alternativePathName2);
+        out.Write("\"]");
+        out.Write("],");
         //list all viapoints so that the client may display it
-        reply.content += "\"via_points\":[";
-        std::string tmp;
+        out.Write("\"via_points\":[");
         if(config.geometry && INT_MAX != rawRoute.lengthOfShortestPath) {
             for(unsigned i = 0; i < rawRoute.segmentEndCoordinates.size(); ++i) {
-                reply.content += "[";
+                out.Write("[");
                 if(rawRoute.segmentEndCoordinates[i].startPhantom.location.isSet())
-                    convertInternalReversedCoordinateToString(rawRoute.segmentEndCoordinates[i].startPhantom.location, tmp);
+                    WriteReversedCoordinate(rawRoute.segmentEndCoordinates[i].startPhantom.location, out);
                 else
-                    convertInternalReversedCoordinateToString(rawRoute.rawViaNodeCoordinates[i], tmp);
-
-                reply.content += tmp;
-                reply.content += "],";
+                    WriteReversedCoordinate(rawRoute.rawViaNodeCoordinates[i], out);
+                out.Write("],");
             }
-            reply.content += "[";
+            out.Write("[");
             if(rawRoute.segmentEndCoordinates.back().startPhantom.location.isSet())
-                convertInternalReversedCoordinateToString(rawRoute.segmentEndCoordinates.back().targetPhantom.location, tmp);
+                WriteReversedCoordinate(rawRoute.segmentEndCoordinates.back().targetPhantom.location, out);
             else
-                convertInternalReversedCoordinateToString(rawRoute.rawViaNodeCoordinates.back(), tmp);
-            reply.content += tmp;
-            reply.content += "]";
+                WriteReversedCoordinate(rawRoute.rawViaNodeCoordinates.back(), out);
+            out.Write("]");
         }
-        reply.content += "],";
-        reply.content += "\"hint_data\": {";
-        reply.content += "\"checksum\":";
-        intToString(rawRoute.checkSum, tmp);
-        reply.content += tmp;
-        reply.content += ", \"locations\": [";
+        out.Write("],");
+        out.Write("\"hint_data\": {");
+        out.Write("\"checksum\":");
+        out.WriteInt(rawRoute.checkSum);
+        out.Write(", \"locations\": [");
 
         std::string hint;
         for(unsigned i = 0; i < rawRoute.segmentEndCoordinates.size(); ++i) {
-            reply.content += "\"";
+            out.Write("\"");
             EncodeObjectToBase64(rawRoute.segmentEndCoordinates[i].startPhantom, hint);
-            reply.content += hint;
-            reply.content += "\", ";
+            out.Write(hint);
+            out.Write("\", ");
         }
         EncodeObjectToBase64(rawRoute.segmentEndCoordinates.back().targetPhantom, hint);
-        reply.content += "\"";
-        reply.content += hint;
-        reply.content += "\"]";
-        reply.content += "},";
-        reply.content += "\"transactionId\": \"OSRM Routing Engine JSON Descriptor (v0.3)\"";
-        reply.content += "}";
+        out.Write("\"");
+        out.Write(hint);
+        out.Write("\"]");
+        out.Write("},");
+        out.Write("\"transactionId\": \"OSRM Routing Engine JSON Descriptor (v0.3)\"");
+        out.Write("}");
     }
 
     void GetRouteNames(std::vector<Segment> & shortestSegments, std::vector<Segment> & alternativeSegments, const SearchEngine &sEngine, RouteNames & routeNames) {
@@ -302,13 +299,21 @@ public:
         }
     }
 
-    inline void WriteHeaderToOutput(std::string & output) {
-        output += "{"
+    inline void WriteHeaderToOutput(ResponseWriter & out) {
+        out.Write("{"
                 "\"version\": 0.3,"
-                "\"status\":";
+                "\"status\":");
+    }
+
+    //"lat,lon " as written by convertInternalReversedCoordinateToString
+    inline void WriteReversedCoordinate(const _Coordinate & coordinate, ResponseWriter & out) {
+        out.WriteLatLon(coordinate.lat);
+        out.Write(',');
+        out.WriteLatLon(coordinate.lon);
+        out.Write(' ');
     }
 
-    inline void BuildTextualDescription(DescriptionFactory & descriptionFactory, http::Reply & reply, const int lengthOfRoute, const SearchEngine &sEngine, std::vector<Segment> & segmentVector) {
+    inline void BuildTextualDescription(DescriptionFactory & descriptionFactory, ResponseWriter & out, const int lengthOfRoute, const SearchEngine &sEngine, std::vector<Segment> & segmentVector) {
         //Segment information has following format:
         //["instruction","streetname",length,position,time,"length","earth_direction",azimuth]
         //Example: ["Turn left","High Street",200,4,10,"200m","NE",22.5]
@@ -316,7 +321,6 @@ public:
         unsigned prefixSumOfNecessarySegments = 0;
         roundAbout.leaveAtExit = 0;
         roundAbout.nameID = 0;
-        std::string tmpDist, tmpLength, tmpDuration, tmpBearing, tmpInstruction;
         //Fetch data from Factory and generate a string from it.
         BOOST_FOREACH(const SegmentInformation & segment, descriptionFactory.pathDescription) {
         	TurnInstruction currentInstruction = segment.turnInstruction & TurnInstructions.InverseAccessRestrictionFlag;
@@ -327,42 +331,34 @@ public:
                     roundAbout.startIndex = prefixSumOfNecessarySegments;
                 } else {
                     if(0 != prefixSumOfNecessarySegments){
-                        reply.content += ",";
+                        out.Write(",");
                     }
-                    reply.content += "[\"";
+                    out.Write("[\"");
                     if(TurnInstructions.LeaveRoundAbout == currentInstruction) {
-                        intToString(TurnInstructions.EnterRoundAbout, tmpInstruction);
-                        reply.content += tmpInstruction;
-                        reply.content += "-";
-                        intToString(roundAbout.leaveAtExit+1, tmpInstruction);
-                        reply.content += tmpInstruction;
+                        out.WriteInt(TurnInstructions.EnterRoundAbout);
+                        out.Write("-");
+                        out.WriteInt(roundAbout.leaveAtExit+1);
                         roundAbout.leaveAtExit = 0;
                     } else {
-                        intToString(currentInstruction, tmpInstruction);
-                        reply.content += tmpInstruction;
+                        out.WriteInt(currentInstruction);
                     }
 
 
-                    reply.content += "\",\"";
-                    reply.content += sEngine.GetEscapedNameForNameID(segment.nameID);
-                    reply.content += "\",";
-                    intToString(segment.length, tmpDist);
-                    reply.content += tmpDist;
-                    reply.content += ",";
-                    intToString(prefixSumOfNecessarySegments, tmpLength);
-                    reply.content += tmpLength;
-                    reply.content += ",";
-                    intToString(segment.duration/10, tmpDuration);
-                    reply.content += tmpDuration;
-                    reply.content += ",\"";
-                    intToString(segment.length, tmpLength);
-                    reply.content += tmpLength;
-                    reply.content += "m\",\"";
-                    reply.content += Azimuth::Get(segment.bearing);
-                    reply.content += "\",";
-                    intToString(round(segment.bearing), tmpBearing);
-                    reply.content += tmpBearing;
-                    reply.content += "]";
+                    out.Write("\",\"");
+                    out.Write(sEngine.GetEscapedNameForNameID(segment.nameID));
+                    out.Write("\",");
+                    out.WriteInt(segment.length);
+                    out.Write(",");
+                    out.WriteInt(prefixSumOfNecessarySegments);
+                    out.Write(",");
+                    out.WriteInt(segment.duration/10);
+                    out.Write(",\"");
+                    out.WriteInt(segment.length);
+                    out.Write("m\",\"");
+                    out.Write(Azimuth::Get(segment.bearing));
+                    out.Write("\",");
+                    out.WriteInt(round(segment.bearing));
+                    out.Write("]");
 
                     segmentVector.push_back( Segment(segment.nameID, segment.length, segmentVector.size() ));
                 }
@@ -373,23 +369,21 @@ public:
                 ++prefixSumOfNecessarySegments;
         }
         if(INT_MAX != lengthOfRoute) {
-            reply.content += ",[\"";
-            intToString(TurnInstructions.ReachedYourDestination, tmpInstruction);
-            reply.content += tmpInstruction;
-            reply.content += "\",\"";
-            reply.content += "\",";
-            reply.content += "0";
-            reply.content += ",";
-            intToString(prefixSumOfNecessarySegments-1, tmpLength);
-            reply.content += tmpLength;
-            reply.content += ",";
-            reply.content += "0";
-            reply.content += ",\"";
-            reply.content += "\",\"";
-            reply.content += Azimuth::Get(0.0);
-            reply.content += "\",";
-            reply.content += "0.0";
-            reply.content += "]";
+            out.Write(",[\"");
+            out.WriteInt(TurnInstructions.ReachedYourDestination);
+            out.Write("\",\"");
+            out.Write("\",");
+            out.Write("0");
+            out.Write(",");
+            out.WriteInt(prefixSumOfNecessarySegments-1);
+            out.Write(",");
+            out.Write("0");
+            out.Write(",\"");
+            out.Write("\",\"");
+            out.Write(Azimuth::Get(0.0));
+            out.Write("\",");
+            out.Write("0.0");
+            out.Write("]");
         }
     }
 
@@ -20,7 +20,12 @@
 
 #include "PBFParser.h"
 
-PBFParser::PBFParser(const char * fileName, ExtractorCallbacks* ec, ScriptingEnvironment& se) : BaseParser( ec, se ) {
+PBFParser::PBFParser(const char * fileName, ExtractorCallbacks* ec, ScriptingEnvironment& se) :
+	BaseParser( ec, se ),
+	nextBlockToEmit(0),
+	numberOfReadBlocks(0),
+	readFinished(false)
+{
 	GOOGLE_PROTOBUF_VERIFY_VERSION;
 	//TODO: What is the bottleneck here? Filling the queue or reading the stuff from disk?
 	//NOTE: With Lua scripting, it is parsing the stuff. I/O is virtually for free.
@@ -31,6 +36,10 @@ PBFParser::PBFParser(const char * fileName, ExtractorCallbacks* ec, ScriptingEnv
 		std::cerr << fileName << ": File not found." << std::endl;
 	}
 
+	//each parse thread runs the Lua callbacks on a state of its own
+	numberOfParseThreads = std::min<unsigned>(omp_get_max_threads(), scriptingEnvironment.luaStateVector.size());
+	numberOfParseThreads = std::max(numberOfParseThreads, 1u);
+
 #ifndef NDEBUG
 	blockCount = 0;
 	groupCount = 0;
@@ -47,6 +56,9 @@ PBFParser::~PBFParser() {
 	while (threadDataQueue->try_pop(td)) {
 		delete td;
 	}
+	for(std::map<unsigned, _ThreadData*>::iterator it = parsedBlocks.begin(); it != parsedBlocks.end(); ++it) {
+		delete it->second;
+	}
 	google::protobuf::ShutdownProtobufLibrary();
 
 #ifndef NDEBUG
@@ -61,7 +73,7 @@ inline bool PBFParser::ReadHeader() {
 		return false;
 	}
 
-	if(readBlob(input, &initData)) {
+	if(readBlob(input, &initData) && decodeBlob(&initData)) {
 		if(!initData.PBFHeaderBlock.ParseFromArray(&(initData.charBuffer[0]), initData.charBuffer.size() ) ) {
 			std::cerr << "[error] Header not parseable!" << std::endl;
 			return false;
@@ -88,71 +100,155 @@ inline bool PBFParser::ReadHeader() {
 	return true;
 }
 
+/*
+ * The read thread only fetches the raw blobs from disk and numbers them. The
+ * parse threads inflate and decode blocks independently, extract their
+ * entities and run the Lua callbacks on them. The calling thread hands the
+ * parsed blocks to the extractor callbacks strictly in file order, s.t. the
+ * output does not depend on the number of threads or on their scheduling.
+ */
 inline void PBFParser::ReadData() {
+	unsigned blockID = 0;
 	bool keepRunning = true;
 	do {
 		_ThreadData *threadData = new _ThreadData();
 		keepRunning = readNextBlock(input, threadData);
 
 		if (keepRunning) {
+			threadData->blockID = blockID++;
 			threadDataQueue->push(threadData);
 		} else {
 			threadDataQueue->push(NULL); // No more data to read, parse stops when NULL encountered
 			delete threadData;
 		}
 	} while(keepRunning);
+
+	boost::mutex::scoped_lock lock(parsedBlocksMutex);
+	numberOfReadBlocks = blockID;
+	readFinished = true;
+	parsedBlocksCondition.notify_all();
 }
 
-inline void PBFParser::ParseData() {
+inline void PBFParser::ParseData(const int threadID) {
+	lua_State * luaStateForThread = scriptingEnvironment.getLuaStateForThreadID(threadID);
 	while (true) {
 		_ThreadData *threadData;
 		threadDataQueue->wait_and_pop(threadData);
 		if( NULL==threadData ) {
-			INFO("Parse Data Thread Finished");
 			threadDataQueue->push(NULL); // Signal end of data for other threads
 			break;
 		}
 
-		loadBlock(threadData);
+		{
+			//bound the number of parsed blocks waiting for a slow predecessor
+			boost::mutex::scoped_lock lock(parsedBlocksMutex);
+			while(threadData->blockID >= nextBlockToEmit + MAX_BLOCKS_AHEAD_PER_THREAD*numberOfParseThreads) {
+				parsedBlocksCondition.wait(lock);
+			}
+		}
+
+		threadData->decoded = decodeBlock(threadData);
+		if(threadData->decoded) {
+			loadBlock(threadData);
 
-		for(int i = 0, groupSize = threadData->PBFprimitiveBlock.primitivegroup_size(); i < groupSize; ++i) {
-			threadData->currentGroupID = i;
-			loadGroup(threadData);
+			for(int i = 0, groupSize = threadData->PBFprimitiveBlock.primitivegroup_size(); i < groupSize; ++i) {
+				threadData->currentGroupID = i;
+				loadGroup(threadData);
 
-			if(threadData->entityTypeIndicator == TypeNode) {
-				parseNode(threadData);
+				if(threadData->entityTypeIndicator == TypeNode) {
+					parseNode(threadData);
+				}
+				if(threadData->entityTypeIndicator == TypeWay) {
+					parseWay(threadData, luaStateForThread);
+				}
+				if(threadData->entityTypeIndicator == TypeRelation) {
+					parseRelation(threadData);
+				}
+				if(threadData->entityTypeIndicator == TypeDenseNode) {
+					parseDenseNode(threadData, luaStateForThread);
+				}
 			}
-			if(threadData->entityTypeIndicator == TypeWay) {
-				parseWay(threadData);
+		}
+
+		//the raw and decoded block data is not needed anymore
+		std::vector<char>().swap(threadData->blobBuffer);
+		std::vector<char>().swap(threadData->charBuffer);
+		threadData->PBFBlob.Clear();
+
+		boost::mutex::scoped_lock lock(parsedBlocksMutex);
+		parsedBlocks.insert(std::make_pair(threadData->blockID, threadData));
+		parsedBlocksCondition.notify_all();
+	}
+	INFO("Parse Data Thread " << threadID << " Finished");
+}
+
+inline void PBFParser::EmitData() {
+	while (true) {
+		_ThreadData *threadData = NULL;
+		{
+			boost::mutex::scoped_lock lock(parsedBlocksMutex);
+			std::map<unsigned, _ThreadData*>::iterator it = parsedBlocks.find(nextBlockToEmit);
+			while(parsedBlocks.end() == it && !(readFinished && nextBlockToEmit == numberOfReadBlocks)) {
+				parsedBlocksCondition.wait(lock);
+				it = parsedBlocks.find(nextBlockToEmit);
 			}
-			if(threadData->entityTypeIndicator == TypeRelation) {
-				parseRelation(threadData);
+			if(parsedBlocks.end() == it) {
+				break;
 			}
-			if(threadData->entityTypeIndicator == TypeDenseNode) {
-				parseDenseNode(threadData);
+			threadData = it->second;
+			parsedBlocks.erase(it);
+		}
+
+		//a corrupt block would silently leave a partial extract
+		if(!threadData->decoded) {
+			ERR("failed to parse PrimitiveBlock " << threadData->blockID);
+		}
+
+		BOOST_FOREACH(ImportNode &n, threadData->parsedNodes) {
+			extractor_callbacks->nodeFunction(n);
+		}
+		BOOST_FOREACH(ExtractionWay &w, threadData->parsedWays) {
+			extractor_callbacks->wayFunction(w);
+		}
+		BOOST_FOREACH(_RawRestrictionContainer &r, threadData->parsedRestrictions) {
+			if(!extractor_callbacks->restrictionFunction(r)) {
+				std::cerr << "[PBFParser] relation not parsed" << std::endl;
 			}
 		}
 
+#ifndef NDEBUG
+		++blockCount;
+		groupCount += threadData->PBFprimitiveBlock.primitivegroup_size();
+#endif
 		delete threadData;
-		threadData = NULL;
+
+		boost::mutex::scoped_lock lock(parsedBlocksMutex);
+		++nextBlockToEmit;
+		parsedBlocksCondition.notify_all();
 	}
+	INFO("Emit Data Thread Finished");
 }
 
 inline bool PBFParser::Parse() {
-	// Start the read and parse threads
+	// Start the read thread and the parse threads
 	boost::thread readThread(boost::bind(&PBFParser::ReadData, this));
 
-	//Open several parse threads that are synchronized before call to
-	boost::thread parseThread(boost::bind(&PBFParser::ParseData, this));
+	boost::thread_group parseThreads;
+	for(unsigned i = 0; i < numberOfParseThreads; ++i) {
+		parseThreads.create_thread(boost::bind(&PBFParser::ParseData, this, i));
+	}
+
+	// Hand the parsed blocks to the callbacks in file order
+	EmitData();
 
 	// Wait for the threads to finish
 	readThread.join();
-	parseThread.join();
+	parseThreads.join_all();
 
 	return true;
 }
 
-inline void PBFParser::parseDenseNode(_ThreadData * threadData) {
+inline void PBFParser::parseDenseNode(_ThreadData * threadData, lua_State * luaStateForThread) {
 	const OSMPBF::DenseNodes& dense = threadData->PBFprimitiveBlock.primitivegroup( threadData->currentGroupID ).dense();
 	int denseTagIndex = 0;
 	int64_t m_lastDenseID = 0;
@@ -160,11 +256,13 @@ inline void PBFParser::parseDenseNode(_ThreadData * threadData) {
 	int64_t m_lastDenseLongitude = 0;
 
 	const int number_of_nodes = dense.id_size();
-	std::vector<ImportNode> extracted_nodes_vector(number_of_nodes);
-	for(int i = 0; i < number_of_nodes; ++i) {
-		m_lastDenseID += dense.id( i );
-		m_lastDenseLatitude += dense.lat( i );
-		m_lastDenseLongitude += dense.lon( i );
+	std::vector<ImportNode> & extracted_nodes_vector = threadData->parsedNodes;
+	const int first_node = extracted_nodes_vector.size();
+	extracted_nodes_vector.resize(first_node + number_of_nodes);
+	for(int i = first_node; i < first_node + number_of_nodes; ++i) {
+		m_lastDenseID += dense.id( i - first_node );
+		m_lastDenseLatitude += dense.lat( i - first_node );
+		m_lastDenseLongitude += dense.lon( i - first_node );
 		extracted_nodes_vector[i].id = m_lastDenseID;
 		extracted_nodes_vector[i].lat = 100000*( ( double ) m_lastDenseLatitude * threadData->PBFprimitiveBlock.granularity() + threadData->PBFprimitiveBlock.lat_offset() ) / NANO;
 		extracted_nodes_vector[i].lon = 100000*( ( double ) m_lastDenseLongitude * threadData->PBFprimitiveBlock.granularity() + threadData->PBFprimitiveBlock.lon_offset() ) / NANO;
@@ -182,14 +280,8 @@ inline void PBFParser::parseDenseNode(_ThreadData * threadData) {
 		}
 	}
 
-#pragma omp parallel for schedule ( guided )
-	for(int i = 0; i < number_of_nodes; ++i) {
-	    ImportNode &n = extracted_nodes_vector[i];
-	    ParseNodeInLua( n, scriptingEnvironment.getLuaStateForThreadID(omp_get_thread_num()) );
-	}
-
-	BOOST_FOREACH(ImportNode &n, extracted_nodes_vector) {
-	    extractor_callbacks->nodeFunction(n);
+	for(int i = first_node; i < first_node + number_of_nodes; ++i) {
+	    ParseNodeInLua( extracted_nodes_vector[i], luaStateForThread );
 	}
 }
 
@@ -280,18 +372,18 @@ inline void PBFParser::parseRelation(_ThreadData * threadData) {
 					break;
 				}
 			}
-			if(!extractor_callbacks->restrictionFunction(currentRestrictionContainer)) {
-				std::cerr << "[PBFParser] relation not parsed" << std::endl;
-			}
+			threadData->parsedRestrictions.push_back(currentRestrictionContainer);
 		}
 	}
 }
 
-inline void PBFParser::parseWay(_ThreadData * threadData) {
+inline void PBFParser::parseWay(_ThreadData * threadData, lua_State * luaStateForThread) {
 	const int number_of_ways = threadData->PBFprimitiveBlock.primitivegroup( threadData->currentGroupID ).ways_size();
-	std::vector<ExtractionWay> parsed_way_vector(number_of_ways);
-	for(int i = 0; i < number_of_ways; ++i) {
-		const OSMPBF::Way& inputWay = threadData->PBFprimitiveBlock.primitivegroup( threadData->currentGroupID ).ways( i );
+	std::vector<ExtractionWay> & parsed_way_vector = threadData->parsedWays;
+	const int first_way = parsed_way_vector.size();
+	parsed_way_vector.resize(first_way + number_of_ways);
+	for(int i = first_way; i < first_way + number_of_ways; ++i) {
+		const OSMPBF::Way& inputWay = threadData->PBFprimitiveBlock.primitivegroup( threadData->currentGroupID ).ways( i - first_way );
 		parsed_way_vector[i].id = inputWay.id();
 		unsigned pathNode(0);
 		const int number_of_referenced_nodes = inputWay.refs_size();
@@ -308,22 +400,12 @@ inline void PBFParser::parseWay(_ThreadData * threadData) {
 		}
 	}
 
-#pragma omp parallel for schedule ( guided )
-	for(int i = 0; i < number_of_ways; ++i) {
-	    ExtractionWay & w = parsed_way_vector[i];
-	    ParseWayInLua( w, scriptingEnvironment.getLuaStateForThreadID(omp_get_thread_num()) );
-	}
-
-	BOOST_FOREACH(ExtractionWay & w, parsed_way_vector) {
-	    extractor_callbacks->wayFunction(w);
+	for(int i = first_way; i < first_way + number_of_ways; ++i) {
+	    ParseWayInLua( parsed_way_vector[i], luaStateForThread );
 	}
 }
 
 inline void PBFParser::loadGroup(_ThreadData * threadData) {
-#ifndef NDEBUG
-	++groupCount;
-#endif
-
 	const OSMPBF::PrimitiveGroup& group = threadData->PBFprimitiveBlock.primitivegroup( threadData->currentGroupID );
 	threadData->entityTypeIndicator = 0;
 	if ( group.nodes_size() != 0 ) {
@@ -343,9 +425,6 @@ inline void PBFParser::loadGroup(_ThreadData * threadData) {
 }
 
 inline void PBFParser::loadBlock(_ThreadData * threadData) {
-#ifndef NDEBUG
-	++blockCount;
-#endif
 	threadData->currentGroupID = 0;
 	threadData->currentEntityID = 0;
 }
@@ -368,7 +447,7 @@ inline bool PBFParser::readPBFBlobHeader(std::fstream& stream, _ThreadData * thr
 	return dataSuccessfullyParsed;
 }
 
-inline bool PBFParser::unpackZLIB(std::fstream &, _ThreadData * threadData) {
+inline bool PBFParser::unpackZLIB(_ThreadData * threadData) {
 	unsigned rawSize = threadData->PBFBlob.raw_size();
 	char* unpackedDataArray = new char[rawSize];
 	z_stream compressedDataStream;
@@ -407,7 +486,7 @@ inline bool PBFParser::unpackZLIB(std::fstream &, _ThreadData * threadData) {
 	return true;
 }
 
-inline bool PBFParser::unpackLZMA(std::fstream &, _ThreadData * ) {
+inline bool PBFParser::unpackLZMA(_ThreadData * ) {
 	return false;
 }
 
@@ -417,17 +496,19 @@ inline bool PBFParser::readBlob(std::fstream& stream, _ThreadData * threadData)
 	}
 
 	const int size = threadData->PBFBlobHeader.datasize();
-	if ( size < 0 || size > MAX_BLOB_SIZE ) {
+	if ( size <= 0 || size > MAX_BLOB_SIZE ) {
 		std::cerr << "[error] invalid Blob size:" << size << std::endl;
 		return false;
 	}
 
-	char* data = new char[size];
-	stream.read(data, sizeof(data[0])*size);
+	threadData->blobBuffer.resize(size);
+	stream.read(&(threadData->blobBuffer[0]), sizeof(char)*size);
+	return !stream.fail();
+}
 
-	if ( !threadData->PBFBlob.ParseFromArray( data, size ) ) {
+inline bool PBFParser::decodeBlob(_ThreadData * threadData) {
+	if ( !threadData->PBFBlob.ParseFromArray( &(threadData->blobBuffer[0]), threadData->blobBuffer.size() ) ) {
 		std::cerr << "[error] failed to parse blob" << std::endl;
-		delete[] data;
 		return false;
 	}
 
@@ -437,23 +518,19 @@ inline bool PBFParser::readBlob(std::fstream& stream, _ThreadData * threadData)
 		threadData->charBuffer.resize( data.size() );
 		std::copy(data.begin(), data.end(), threadData->charBuffer.begin());
 	} else if ( threadData->PBFBlob.has_zlib_data() ) {
-		if ( !unpackZLIB(stream, threadData) ) {
+		if ( !unpackZLIB(threadData) ) {
 			std::cerr << "[error] zlib data encountered that could not be unpacked" << std::endl;
-			delete[] data;
 			return false;
 		}
 	} else if ( threadData->PBFBlob.has_lzma_data() ) {
-		if ( !unpackLZMA(stream, threadData) ) {
+		if ( !unpackLZMA(threadData) ) {
 			std::cerr << "[error] lzma data encountered that could not be unpacked" << std::endl;
 		}
-		delete[] data;
 		return false;
 	} else {
 		std::cerr << "[error] Blob contains no data" << std::endl;
-		delete[] data;
 		return false;
 	}
-	delete[] data;
 	return true;
 }
 
@@ -470,12 +547,15 @@ bool PBFParser::readNextBlock(std::fstream& stream, _ThreadData * threadData) {
 		return false;
 	}
 
-	if ( !readBlob(stream, threadData) ) {
+	return readBlob(stream, threadData);
+}
+
+inline bool PBFParser::decodeBlock(_ThreadData * threadData) {
+	if ( !decodeBlob(threadData) ) {
 		return false;
 	}
 
 	if ( !threadData->PBFprimitiveBlock.ParseFromArray( &(threadData->charBuffer[0]), threadData-> charBuffer.size() ) ) {
-		ERR("failed to parse PrimitiveBlock");
 		return false;
 	}
 	return true;
@@ -32,12 +32,18 @@
 #include <boost/shared_ptr.hpp>
 #include <boost/make_shared.hpp>
 #include <boost/ref.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/mutex.hpp>
 
 #include <osmpbf/fileformat.pb.h>
 #include <osmpbf/osmformat.pb.h>
 
 #include <zlib.h>
 
+#include <fstream>
+#include <map>
+#include <vector>
+
 class PBFParser : public BaseParser {
 
     enum EntityType {
@@ -48,6 +54,9 @@ class PBFParser : public BaseParser {
     } ;
 
     struct _ThreadData {
+        unsigned blockID;
+        //false if the block could not be decoded, which the emitting thread reports
+        bool decoded;
         int currentGroupID;
         int currentEntityID;
         short entityTypeIndicator;
@@ -58,7 +67,13 @@ class PBFParser : public BaseParser {
         OSMPBF::HeaderBlock PBFHeaderBlock;
         OSMPBF::PrimitiveBlock PBFprimitiveBlock;
 
+        std::vector<char> blobBuffer;
         std::vector<char> charBuffer;
+
+        //entities of the block in file order, already processed by Lua
+        std::vector<ImportNode> parsedNodes;
+        std::vector<ExtractionWay> parsedWays;
+        std::vector<_RawRestrictionContainer> parsedRestrictions;
     };
 
 public:
@@ -70,23 +85,28 @@ public:
 
 private:
     inline void ReadData();
-    inline void ParseData();
-    inline void parseDenseNode(_ThreadData * threadData);
+    inline void ParseData(const int threadID);
+    inline void EmitData();
+    inline void parseDenseNode(_ThreadData * threadData, lua_State * luaStateForThread);
     inline void parseNode(_ThreadData * );
     inline void parseRelation(_ThreadData * threadData);
-    inline void parseWay(_ThreadData * threadData);
+    inline void parseWay(_ThreadData * threadData, lua_State * luaStateForThread);
 
     inline void loadGroup(_ThreadData * threadData);
     inline void loadBlock(_ThreadData * threadData);
     inline bool readPBFBlobHeader(std::fstream& stream, _ThreadData * threadData);
-    inline bool unpackZLIB(std::fstream &, _ThreadData * threadData);
-    inline bool unpackLZMA(std::fstream &, _ThreadData * );
+    inline bool unpackZLIB(_ThreadData * threadData);
+    inline bool unpackLZMA(_ThreadData * );
     inline bool readBlob(std::fstream& stream, _ThreadData * threadData) ;
+    inline bool decodeBlob(_ThreadData * threadData);
     inline bool readNextBlock(std::fstream& stream, _ThreadData * threadData);
+    inline bool decodeBlock(_ThreadData * threadData);
 
     static const int NANO = 1000 * 1000 * 1000;
     static const int MAX_BLOB_HEADER_SIZE = 64 * 1024;
     static const int MAX_BLOB_SIZE = 32 * 1024 * 1024;
+    /* a parse thread may run this many blocks per thread ahead of the next block to be emitted */
+    static const unsigned MAX_BLOCKS_AHEAD_PER_THREAD = 4;
 
 #ifndef NDEBUG
     /* counting the number of read blocks and groups */
@@ -96,6 +116,15 @@ private:
 
     std::fstream input;     // the input stream to parse
     boost::shared_ptr<ConcurrentQueue < _ThreadData* > > threadDataQueue;
+
+    /* parsed blocks wait here until all blocks before them have been handed to the callbacks */
+    unsigned numberOfParseThreads;
+    boost::mutex parsedBlocksMutex;
+    boost::condition parsedBlocksCondition;
+    std::map<unsigned, _ThreadData*> parsedBlocks;
+    unsigned nextBlockToEmit;
+    unsigned numberOfReadBlocks;
+    bool readFinished;
 };
 
 #endif /* PBFPARSER_H_ */
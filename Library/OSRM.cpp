@@ -20,46 +20,145 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "OSRM.h"
 
-OSRM::OSRM(const char * server_ini_path) {
+OSRM::OSRM(const char * server_ini_path) : sharedDataControl(NULL), generationWatcher(NULL), reuseAlternativeSearchSpaces(false) {
     if( !testDataFile(server_ini_path) ){
         throw OSRMException("server.ini not found");
     }
 
     BaseConfiguration serverConfig(server_ini_path);
-    objects = new QueryObjectsStorage(
+    reuseAlternativeSearchSpaces = ("yes" == serverConfig.GetParameter("reuseAlternativeSearchSpaces"));
+    if("yes" == serverConfig.GetParameter("sharedMemory")) {
+        sharedDataControl = SharedMemoryRegion::Attach(getSharedDataControlName());
+        if(NULL == sharedDataControl || sizeof(SharedDataControl) > sharedDataControl->GetSize()) {
+            throw OSRMException("no data in shared memory, run osrm-datastore first");
+        }
+        currentDataset.reset(AttachToSharedDataset());
+        generationWatcher = new boost::thread(boost::bind(&OSRM::WatchSharedDataGeneration, this));
+        return;
+    }
+
+    QueryObjectsStorage * objects = new QueryObjectsStorage(
         serverConfig.GetParameter("hsgrData"),
         serverConfig.GetParameter("ramIndex"),
         serverConfig.GetParameter("fileIndex"),
         serverConfig.GetParameter("nodesData"),
         serverConfig.GetParameter("edgesData"),
         serverConfig.GetParameter("namesData"),
-        serverConfig.GetParameter("timestamp")
+        serverConfig.GetParameter("timestamp"),
+        serverConfig.GetParameter("levelData"),
+        ("yes" == serverConfig.GetParameter("memoryMapGraph")),
+        ("yes" == serverConfig.GetParameter("memoryMapFileIndex"))
     );
+    currentDataset.reset(new Dataset(objects, 0, reuseAlternativeSearchSpaces));
+}
+
+OSRM::~OSRM() {
+    if(NULL != generationWatcher) {
+        generationWatcher->interrupt();
+        generationWatcher->join();
+        delete generationWatcher;
+    }
+    currentDataset.reset();
+    delete sharedDataControl;
+}
 
+OSRM::Dataset::Dataset(QueryObjectsStorage * o, const unsigned g, const bool reuseAlternativeSearchSpaces) : objects(o), generation(g) {
+    RegisterPlugin(new BatchRoutePlugin(objects));
+    RegisterPlugin(new DistanceTablePlugin(objects));
     RegisterPlugin(new HelloWorldPlugin());
+    if(!objects->nodeRanks.empty()) {
+        RegisterPlugin(new IsochronePlugin(objects));
+    }
     RegisterPlugin(new LocatePlugin(objects));
+    RegisterPlugin(new MetricsPlugin());
     RegisterPlugin(new NearestPlugin(objects));
     RegisterPlugin(new TimestampPlugin(objects));
-    RegisterPlugin(new ViaRoutePlugin(objects));
+    RegisterPlugin(new ViaRoutePlugin(objects, "viaroute", reuseAlternativeSearchSpaces));
 }
 
-OSRM::~OSRM() {
+OSRM::Dataset::~Dataset() {
     BOOST_FOREACH(PluginMap::value_type & plugin_pointer, pluginMap) {
         delete plugin_pointer.second;
     }
     delete objects;
 }
 
-void OSRM::RegisterPlugin(BasePlugin * plugin) {
+void OSRM::Dataset::RegisterPlugin(BasePlugin * plugin) {
     std::cout << "[plugin] " << plugin->GetDescriptor() << std::endl;
     pluginMap[plugin->GetDescriptor()] = plugin;
+    metricsSlots[plugin->GetDescriptor()] = QueryMetrics::GetInstance().GetPluginSlot(plugin->GetDescriptor());
+}
+
+boost::shared_ptr<OSRM::Dataset> OSRM::GetCurrentDataset() {
+    return boost::atomic_load(&currentDataset);
+}
+
+OSRM::Dataset * OSRM::AttachToSharedDataset() {
+    const SharedDataControl * control = reinterpret_cast<const SharedDataControl *>(sharedDataControl->GetData());
+    while(true) {
+        const unsigned generation = readSharedDataGeneration(control);
+        if(0 == generation) {
+            throw OSRMException("no data in shared memory, run osrm-datastore first");
+        }
+        SharedMemoryRegion * region = SharedMemoryRegion::Attach(getSharedDataRegionName(generation));
+        if(NULL != region) {
+            return new Dataset(new QueryObjectsStorage(region), generation, reuseAlternativeSearchSpaces);
+        }
+        //the region was replaced and removed in between, retry with its successor
+        if(generation == readSharedDataGeneration(control)) {
+            throw OSRMException("dataset in shared memory has vanished");
+        }
+    }
+}
+
+//Polls the live generation and swaps in a new dataset once it is published.
+//Queries that are in flight keep using the dataset they started with.
+void OSRM::WatchSharedDataGeneration() {
+    const SharedDataControl * control = reinterpret_cast<const SharedDataControl *>(sharedDataControl->GetData());
+    try {
+        while(true) {
+            boost::this_thread::sleep(boost::posix_time::seconds(1));
+            if(GetCurrentDataset()->generation == readSharedDataGeneration(control)) {
+                continue;
+            }
+            try {
+                boost::shared_ptr<Dataset> newDataset(AttachToSharedDataset());
+                INFO("switching to dataset generation " << newDataset->generation);
+                boost::atomic_store(&currentDataset, newDataset);
+            } catch(OSRMException & e) {
+                WARN("could not switch datasets: " << static_cast<std::exception &>(e).what());
+            }
+        }
+    } catch(boost::thread_interrupted &) {
+        //shutting down
+    }
 }
 
 void OSRM::RunQuery(RouteParameters & route_parameters, http::Reply & reply) {
-    const PluginMap::const_iterator & iter = pluginMap.find(route_parameters.service);
-    if(pluginMap.end() != iter) {
+    //a dataset read from files is never replaced, queries on it do not touch its reference count
+    boost::shared_ptr<Dataset> sharedDataset;
+    const Dataset * dataset = NULL;
+    if(NULL == sharedDataControl) {
+        dataset = currentDataset.get();
+    } else {
+        sharedDataset = GetCurrentDataset();
+        dataset = sharedDataset.get();
+    }
+    const PluginMap::const_iterator & iter = dataset->pluginMap.find(route_parameters.service);
+    if(dataset->pluginMap.end() != iter) {
         reply.status = http::Reply::ok;
+        //parsing is timed by the caller, the other phases must not add up across queries
+        PhaseTimings & phaseTimings = GetPhaseTimingsOfThread();
+        const double parsingSeconds = phaseTimings.seconds[PhaseTimings::parsing];
+        phaseTimings.Clear();
+        phaseTimings.seconds[PhaseTimings::parsing] = parsingSeconds;
+        const double start = get_timestamp();
         iter->second->HandleRequest(route_parameters, reply );
+        QueryMetrics::GetInstance().Record(
+            dataset->metricsSlots.find(route_parameters.service)->second,
+            phaseTimings.seconds[PhaseTimings::parsing] + get_timestamp() - start,
+            phaseTimings
+        );
     } else {
         reply = http::Reply::stockReply(http::Reply::badRequest);
     }
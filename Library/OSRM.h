@@ -24,43 +24,64 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "OSRM.h"
 
 #include "../Plugins/BasePlugin.h"
+#include "../Plugins/BatchRoutePlugin.h"
+#include "../Plugins/DistanceTablePlugin.h"
 #include "../Plugins/HelloWorldPlugin.h"
+#include "../Plugins/IsochronePlugin.h"
 #include "../Plugins/LocatePlugin.h"
+#include "../Plugins/MetricsPlugin.h"
 #include "../Plugins/NearestPlugin.h"
 #include "../Plugins/TimestampPlugin.h"
 #include "../Plugins/ViaRoutePlugin.h"
 #include "../Plugins/RouteParameters.h"
 #include "../Util/BaseConfiguration.h"
 #include "../Util/InputFileUtil.h"
+#include "../Util/OSRMException.h"
+#include "../Util/SharedMemory.h"
+#include "../DataStructures/QueryMetrics.h"
+#include "../DataStructures/SharedDataLayout.h"
 #include "../Server/BasicDatastructures.h"
 
 #include <boost/assert.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
 #include <exception>
 #include <vector>
 
-class OSRMException: public std::exception {
-public:
-    OSRMException(const char * message) : message(message) {}
-private:
-    virtual const char* what() const throw() {
-        return message;
-    }
-    const char * message;
-};
-
 class OSRM : boost::noncopyable {
     typedef boost::unordered_map<std::string, BasePlugin *> PluginMap;
-    QueryObjectsStorage * objects;
+
+    //Query data and the plugins working on it. A dataset is replaced as a
+    //whole and freed once the last query that uses it has finished.
+    struct Dataset : boost::noncopyable {
+        Dataset(QueryObjectsStorage * objects, const unsigned generation, const bool reuseAlternativeSearchSpaces);
+        ~Dataset();
+        void RegisterPlugin(BasePlugin * plugin);
+        QueryObjectsStorage * objects;
+        PluginMap pluginMap;
+        //slots of the plugins in the query metrics
+        boost::unordered_map<std::string, unsigned> metricsSlots;
+        //generation in shared memory, 0 if the data was read from files
+        const unsigned generation;
+    };
 public:
     OSRM(const char * server_ini_path);
     ~OSRM();
     void RunQuery(RouteParameters & route_parameters, http::Reply & reply);
 private:
-    void RegisterPlugin(BasePlugin * plugin);
-    PluginMap pluginMap;
+    boost::shared_ptr<Dataset> GetCurrentDataset();
+    Dataset * AttachToSharedDataset();
+    void WatchSharedDataGeneration();
+
+    //replaced through boost::atomic_store by the watcher only
+    boost::shared_ptr<Dataset> currentDataset;
+    //control region of osrm-datastore, NULL if the data was read from files
+    SharedMemoryRegion * sharedDataControl;
+    boost::thread * generationWatcher;
+    //select alternative routes from the search spaces of the shortest path query
+    bool reuseAlternativeSearchSpaces;
 };
 
 #endif //OSRM_H
\ No newline at end of file
@@ -0,0 +1,169 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef BATCHROUTEPLUGIN_H_
+#define BATCHROUTEPLUGIN_H_
+
+#include "BasePlugin.h"
+#include "RouteParameters.h"
+
+#include "../Algorithms/ObjectToBase64.h"
+#include "../DataStructures/PhaseTimings.h"
+#include "../DataStructures/SearchEngine.h"
+#include "../Server/DataStructures/QueryObjectsStorage.h"
+#include "../Util/StringUtil.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * This Plugin computes the shortest routes of a list of independent
+ * origin/destination pairs, given as consecutive locations, i.e.
+ * loc=o1&loc=d1&loc=o2&loc=d2... Only duration (in tenth of seconds) and
+ * distance (in meters) are returned per pair, INT_MAX denotes that there is
+ * no route.
+ */
+class BatchRoutePlugin : public BasePlugin {
+private:
+    NodeInformationHelpDesk * nodeHelpDesk;
+    std::vector<std::string> & names;
+    StaticGraph<QueryEdge::EdgeData> * graph;
+    std::string pluginDescriptorString;
+    SearchEngine * searchEnginePtr;
+public:
+
+    BatchRoutePlugin(QueryObjectsStorage * objects, std::string psd = "batchroute") : names(objects->names), pluginDescriptorString(psd) {
+        nodeHelpDesk = objects->nodeHelpDesk;
+        graph = objects->graph;
+
+        searchEnginePtr = new SearchEngine(graph, nodeHelpDesk, names);
+    }
+
+    virtual ~BatchRoutePlugin() {
+        delete searchEnginePtr;
+    }
+
+    std::string GetDescriptor() const { return pluginDescriptorString; }
+    std::string GetVersionString() const { return std::string("0.3 (DL)"); }
+    void HandleRequest(const RouteParameters & routeParameters, http::Reply& reply) {
+        //check number of parameters
+        const unsigned numberOfLocations = routeParameters.coordinates.size();
+        if( 2 > numberOfLocations || 0 != numberOfLocations%2 ) {
+            reply = http::Reply::stockReply(http::Reply::badRequest);
+            return;
+        }
+
+        for(unsigned i = 0; i < numberOfLocations; ++i) {
+            if(false == checkCoord(routeParameters.coordinates[i])) {
+                reply = http::Reply::stockReply(http::Reply::badRequest);
+                return;
+            }
+        }
+
+        //Take valid hints as they are, resolve all other locations in one batch
+        const bool checksumOK = (routeParameters.checkSum == nodeHelpDesk->GetCheckSum());
+        std::vector<PhantomNode> phantomNodeVector(numberOfLocations);
+        std::vector<unsigned> unresolvedLocations;
+        std::vector<_Coordinate> unresolvedCoordinates;
+        for(unsigned i = 0; i < numberOfLocations; ++i) {
+            if(checksumOK && i < routeParameters.hints.size() && "" != routeParameters.hints[i]) {
+                DecodeObjectFromBase64(routeParameters.hints[i], phantomNodeVector[i]);
+                if(phantomNodeVector[i].isValid(nodeHelpDesk->getNumberOfNodes())) {
+                    continue;
+                }
+                phantomNodeVector[i].Reset();
+            }
+            unresolvedLocations.push_back(i);
+            unresolvedCoordinates.push_back(routeParameters.coordinates[i]);
+        }
+        std::vector<PhantomNode> resolvedPhantomNodes;
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::phantomLookup);
+            searchEnginePtr->FindPhantomNodesForCoordinates(unresolvedCoordinates, resolvedPhantomNodes, routeParameters.zoomLevel);
+        }
+        for(unsigned i = 0; i < unresolvedLocations.size(); ++i) {
+            phantomNodeVector[unresolvedLocations[i]] = resolvedPhantomNodes[i];
+        }
+
+        std::vector<PhantomNodes> phantomNodePairs(numberOfLocations/2);
+        for(unsigned i = 0; i < phantomNodePairs.size(); ++i) {
+            phantomNodePairs[i].startPhantom = phantomNodeVector[2*i];
+            phantomNodePairs[i].targetPhantom = phantomNodeVector[2*i+1];
+        }
+
+        std::vector<BatchRouteSummary> routeSummaries;
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::search);
+            searchEnginePtr->batchRoutes(phantomNodePairs, routeSummaries);
+        }
+
+        std::string tmp;
+        if("" != routeParameters.jsonpParameter) {
+            reply.content += routeParameters.jsonpParameter;
+            reply.content += "(";
+        }
+
+        reply.status = http::Reply::ok;
+        reply.content += ("{");
+        reply.content += ("\"version\":0.3,");
+        reply.content += ("\"status\":0,");
+        reply.content += ("\"route_summaries\":[");
+        for(unsigned i = 0; i < routeSummaries.size(); ++i) {
+            if(0 != i) {
+                reply.content += ",";
+            }
+            reply.content += "[";
+            intToString(routeSummaries[i].duration, tmp);
+            reply.content += tmp;
+            reply.content += ",";
+            intToString(routeSummaries[i].distance, tmp);
+            reply.content += tmp;
+            reply.content += "]";
+        }
+        reply.content += "]";
+        reply.content += ",\"transactionId\":\"OSRM Routing Engine JSON Batch Route (v0.3)\"";
+        reply.content += ("}");
+        reply.headers.resize(3);
+        if("" != routeParameters.jsonpParameter) {
+            reply.content += ")";
+            reply.headers[1].name = "Content-Type";
+            reply.headers[1].value = "text/javascript";
+            reply.headers[2].name = "Content-Disposition";
+            reply.headers[2].value = "attachment; filename=\"batchroute.js\"";
+        } else {
+            reply.headers[1].name = "Content-Type";
+            reply.headers[1].value = "application/x-javascript";
+            reply.headers[2].name = "Content-Disposition";
+            reply.headers[2].value = "attachment; filename=\"batchroute.json\"";
+        }
+        reply.headers[0].name = "Content-Length";
+        intToString(reply.content.size(), tmp);
+        reply.headers[0].value = tmp;
+    }
+private:
+    inline bool checkCoord(const _Coordinate & c) {
+        if(c.lat > 90*100000 || c.lat < -90*100000 || c.lon > 180*100000 || c.lon <-180*100000) {
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif /* BATCHROUTEPLUGIN_H_ */
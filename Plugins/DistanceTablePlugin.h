@@ -0,0 +1,150 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef DISTANCETABLEPLUGIN_H_
+#define DISTANCETABLEPLUGIN_H_
+
+#include "BasePlugin.h"
+#include "RouteParameters.h"
+
+#include "../Algorithms/ObjectToBase64.h"
+#include "../DataStructures/PhaseTimings.h"
+#include "../DataStructures/SearchEngine.h"
+#include "../Server/DataStructures/QueryObjectsStorage.h"
+#include "../Util/StringUtil.h"
+
+#include <string>
+#include <vector>
+
+/*
+ * This Plugin computes the matrix of travel times between all pairs of given locations.
+ * Entries are given in tenth of seconds, INT_MAX denotes an unreachable target.
+ */
+class DistanceTablePlugin : public BasePlugin {
+private:
+    NodeInformationHelpDesk * nodeHelpDesk;
+    std::vector<std::string> & names;
+    StaticGraph<QueryEdge::EdgeData> * graph;
+    std::string pluginDescriptorString;
+    SearchEngine * searchEnginePtr;
+public:
+
+    DistanceTablePlugin(QueryObjectsStorage * objects, std::string psd = "table") : names(objects->names), pluginDescriptorString(psd) {
+        nodeHelpDesk = objects->nodeHelpDesk;
+        graph = objects->graph;
+
+        searchEnginePtr = new SearchEngine(graph, nodeHelpDesk, names);
+    }
+
+    virtual ~DistanceTablePlugin() {
+        delete searchEnginePtr;
+    }
+
+    std::string GetDescriptor() const { return pluginDescriptorString; }
+    std::string GetVersionString() const { return std::string("0.3 (DL)"); }
+    void HandleRequest(const RouteParameters & routeParameters, http::Reply& reply) {
+        //check number of parameters
+        if( 2 > routeParameters.coordinates.size() ) {
+            reply = http::Reply::stockReply(http::Reply::badRequest);
+            return;
+        }
+
+        for(unsigned i = 0; i < routeParameters.coordinates.size(); ++i) {
+            if(false == checkCoord(routeParameters.coordinates[i])) {
+                reply = http::Reply::stockReply(http::Reply::badRequest);
+                return;
+            }
+        }
+
+        const bool checksumOK = (routeParameters.checkSum == nodeHelpDesk->GetCheckSum());
+        std::vector<PhantomNode> phantomNodeVector(routeParameters.coordinates.size());
+        for(unsigned i = 0; i < routeParameters.coordinates.size(); ++i) {
+            if(checksumOK && i < routeParameters.hints.size() && "" != routeParameters.hints[i]) {
+                DecodeObjectFromBase64(routeParameters.hints[i], phantomNodeVector[i]);
+                if(phantomNodeVector[i].isValid(nodeHelpDesk->getNumberOfNodes())) {
+                    continue;
+                }
+            }
+            ScopedPhaseTimer phaseTimer(PhaseTimings::phantomLookup);
+            searchEnginePtr->FindPhantomNodeForCoordinate(routeParameters.coordinates[i], phantomNodeVector[i], routeParameters.zoomLevel);
+        }
+
+        std::vector<int> resultTable;
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::search);
+            searchEnginePtr->distanceTable(phantomNodeVector, resultTable);
+        }
+
+        std::string tmp;
+        if("" != routeParameters.jsonpParameter) {
+            reply.content += routeParameters.jsonpParameter;
+            reply.content += "(";
+        }
+
+        reply.status = http::Reply::ok;
+        reply.content += ("{");
+        reply.content += ("\"version\":0.3,");
+        reply.content += ("\"status\":0,");
+        reply.content += ("\"distance_table\":[");
+        const unsigned numberOfLocations = phantomNodeVector.size();
+        for(unsigned row = 0; row < numberOfLocations; ++row) {
+            if(0 != row) {
+                reply.content += ",";
+            }
+            reply.content += "[";
+            for(unsigned column = 0; column < numberOfLocations; ++column) {
+                if(0 != column) {
+                    reply.content += ",";
+                }
+                intToString(resultTable[row*numberOfLocations + column], tmp);
+                reply.content += tmp;
+            }
+            reply.content += "]";
+        }
+        reply.content += "]";
+        reply.content += ",\"transactionId\":\"OSRM Routing Engine JSON Distance Table (v0.3)\"";
+        reply.content += ("}");
+        reply.headers.resize(3);
+        if("" != routeParameters.jsonpParameter) {
+            reply.content += ")";
+            reply.headers[1].name = "Content-Type";
+            reply.headers[1].value = "text/javascript";
+            reply.headers[2].name = "Content-Disposition";
+            reply.headers[2].value = "attachment; filename=\"table.js\"";
+        } else {
+            reply.headers[1].name = "Content-Type";
+            reply.headers[1].value = "application/x-javascript";
+            reply.headers[2].name = "Content-Disposition";
+            reply.headers[2].value = "attachment; filename=\"table.json\"";
+        }
+        reply.headers[0].name = "Content-Length";
+        intToString(reply.content.size(), tmp);
+        reply.headers[0].value = tmp;
+    }
+private:
+    inline bool checkCoord(const _Coordinate & c) {
+        if(c.lat > 90*100000 || c.lat < -90*100000 || c.lon > 180*100000 || c.lon <-180*100000) {
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif /* DISTANCETABLEPLUGIN_H_ */
@@ -0,0 +1,198 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef ISOCHRONEPLUGIN_H_
+#define ISOCHRONEPLUGIN_H_
+
+#include "BasePlugin.h"
+#include "RouteParameters.h"
+
+#include "../Algorithms/ObjectToBase64.h"
+#include "../DataStructures/PhaseTimings.h"
+#include "../DataStructures/SearchEngine.h"
+#include "../Server/DataStructures/QueryObjectsStorage.h"
+#include "../Util/StringUtil.h"
+
+#include <climits>
+#include <string>
+#include <vector>
+
+/*
+ * This Plugin computes all edge-based nodes that can be reached from a single
+ * location within the time given by time=<seconds>. For each such node the
+ * coordinate of its start and the travel time in tenth of seconds are given,
+ * preceded by the snapped location itself. Needs the node ranks (levelData).
+ */
+class IsochronePlugin : public BasePlugin {
+private:
+    typedef OneToAllRouting<SearchEngineData>::SweepGraph SweepGraph;
+
+    NodeInformationHelpDesk * nodeHelpDesk;
+    std::vector<std::string> & names;
+    StaticGraph<QueryEdge::EdgeData> * graph;
+    std::string pluginDescriptorString;
+    SearchEngine * searchEnginePtr;
+    SweepGraph * sweepGraph;
+    //an original edge entering each node, its via node locates the node
+    std::vector<unsigned> enteringEdgeOfNode;
+public:
+
+    IsochronePlugin(QueryObjectsStorage * objects, std::string psd = "isochrone") : names(objects->names), pluginDescriptorString(psd) {
+        nodeHelpDesk = objects->nodeHelpDesk;
+        graph = objects->graph;
+
+        searchEnginePtr = new SearchEngine(graph, nodeHelpDesk, names);
+        sweepGraph = new SweepGraph(*graph, objects->nodeRanks);
+
+        enteringEdgeOfNode.resize(graph->GetNumberOfNodes(), UINT_MAX);
+        for(NodeID node = 0; node < graph->GetNumberOfNodes(); ++node) {
+            for(StaticGraph<QueryEdge::EdgeData>::EdgeIterator edge = graph->BeginEdges(node); edge < graph->EndEdges(node); ++edge) {
+                const QueryEdge::EdgeData & data = graph->GetEdgeData(edge);
+                if(data.shortcut) {
+                    continue;
+                }
+                if(data.forward) {
+                    enteringEdgeOfNode[graph->GetTarget(edge)] = data.id;
+                }
+                if(data.backward) {
+                    enteringEdgeOfNode[node] = data.id;
+                }
+            }
+        }
+    }
+
+    virtual ~IsochronePlugin() {
+        delete sweepGraph;
+        delete searchEnginePtr;
+    }
+
+    std::string GetDescriptor() const { return pluginDescriptorString; }
+    std::string GetVersionString() const { return std::string("0.3 (DL)"); }
+    void HandleRequest(const RouteParameters & routeParameters, http::Reply& reply) {
+        //check number of parameters
+        if( 1 != routeParameters.coordinates.size() || 0 == routeParameters.timeLimit ) {
+            reply = http::Reply::stockReply(http::Reply::badRequest);
+            return;
+        }
+
+        if(false == checkCoord(routeParameters.coordinates[0])) {
+            reply = http::Reply::stockReply(http::Reply::badRequest);
+            return;
+        }
+
+        PhantomNode phantomNode;
+        const bool checksumOK = (routeParameters.checkSum == nodeHelpDesk->GetCheckSum());
+        if(checksumOK && 0 < routeParameters.hints.size() && "" != routeParameters.hints[0]) {
+            DecodeObjectFromBase64(routeParameters.hints[0], phantomNode);
+        }
+        if(!phantomNode.isValid(nodeHelpDesk->getNumberOfNodes())) {
+            phantomNode.Reset();
+            ScopedPhaseTimer phaseTimer(PhaseTimings::phantomLookup);
+            searchEnginePtr->FindPhantomNodeForCoordinate(routeParameters.coordinates[0], phantomNode, routeParameters.zoomLevel);
+        }
+
+        const std::vector<int> * distancesPtr = NULL;
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::search);
+            distancesPtr = &searchEnginePtr->oneToAll(phantomNode, *sweepGraph, 10*static_cast<int>(routeParameters.timeLimit));
+        }
+        const std::vector<int> & distances = *distancesPtr;
+
+        std::string tmp;
+        if("" != routeParameters.jsonpParameter) {
+            reply.content += routeParameters.jsonpParameter;
+            reply.content += "(";
+        }
+
+        reply.status = http::Reply::ok;
+        reply.content += ("{");
+        reply.content += ("\"version\":0.3,");
+        reply.content += ("\"status\":");
+        if(UINT_MAX != phantomNode.edgeBasedNode) {
+            reply.content += "0,";
+        } else {
+            reply.content += "207,";
+        }
+        reply.content += ("\"isochrone\":[");
+        bool isFirstEntry = true;
+        if(UINT_MAX != phantomNode.edgeBasedNode) {
+            reply.content += "[";
+            convertInternalLatLonToString(phantomNode.location.lat, tmp);
+            reply.content += tmp;
+            reply.content += ",";
+            convertInternalLatLonToString(phantomNode.location.lon, tmp);
+            reply.content += tmp;
+            reply.content += ",0]";
+            isFirstEntry = false;
+        }
+        for(unsigned position = 0; position < distances.size(); ++position) {
+            //negative distances belong to the nodes of the source, which start behind it
+            if(INT_MAX == distances[position] || 0 > distances[position]) {
+                continue;
+            }
+            const unsigned enteringEdge = enteringEdgeOfNode[sweepGraph->GetNode(position)];
+            if(UINT_MAX == enteringEdge) {
+                continue;
+            }
+            if(!isFirstEntry) {
+                reply.content += ",";
+            }
+            isFirstEntry = false;
+            reply.content += "[";
+            convertInternalLatLonToString(nodeHelpDesk->getLatitudeOfNode(enteringEdge), tmp);
+            reply.content += tmp;
+            reply.content += ",";
+            convertInternalLatLonToString(nodeHelpDesk->getLongitudeOfNode(enteringEdge), tmp);
+            reply.content += tmp;
+            reply.content += ",";
+            intToString(distances[position], tmp);
+            reply.content += tmp;
+            reply.content += "]";
+        }
+        reply.content += "]";
+        reply.content += ",\"transactionId\":\"OSRM Routing Engine JSON Isochrone (v0.3)\"";
+        reply.content += ("}");
+        reply.headers.resize(3);
+        if("" != routeParameters.jsonpParameter) {
+            reply.content += ")";
+            reply.headers[1].name = "Content-Type";
+            reply.headers[1].value = "text/javascript";
+            reply.headers[2].name = "Content-Disposition";
+            reply.headers[2].value = "attachment; filename=\"isochrone.js\"";
+        } else {
+            reply.headers[1].name = "Content-Type";
+            reply.headers[1].value = "application/x-javascript";
+            reply.headers[2].name = "Content-Disposition";
+            reply.headers[2].value = "attachment; filename=\"isochrone.json\"";
+        }
+        reply.headers[0].name = "Content-Length";
+        intToString(reply.content.size(), tmp);
+        reply.headers[0].value = tmp;
+    }
+private:
+    inline bool checkCoord(const _Coordinate & c) {
+        if(c.lat > 90*100000 || c.lat < -90*100000 || c.lon > 180*100000 || c.lon <-180*100000) {
+            return false;
+        }
+        return true;
+    }
+};
+
+#endif /* ISOCHRONEPLUGIN_H_ */
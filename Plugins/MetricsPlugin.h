@@ -0,0 +1,54 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef METRICSPLUGIN_H_
+#define METRICSPLUGIN_H_
+
+#include "BasePlugin.h"
+#include "RouteParameters.h"
+
+#include "../DataStructures/QueryMetrics.h"
+#include "../Util/StringUtil.h"
+
+#include <string>
+
+/*
+ * Returns the query counts and latency histograms of all plugins in the text
+ * format that Prometheus scrapes.
+ */
+class MetricsPlugin : public BasePlugin {
+public:
+    std::string GetDescriptor() const { return std::string("metrics"); }
+    std::string GetVersionString() const { return std::string("0.1"); }
+    void HandleRequest(const RouteParameters & routeParameters, http::Reply& reply) {
+        reply.status = http::Reply::ok;
+        QueryMetrics::GetInstance().WritePrometheusText(reply.content);
+
+        std::string tmp;
+        reply.headers.resize(2);
+        reply.headers[0].name = "Content-Length";
+        intToString(reply.content.size(), tmp);
+        reply.headers[0].value = tmp;
+        reply.headers[1].name = "Content-Type";
+        reply.headers[1].value = "text/plain; version=0.0.4";
+    }
+};
+
+#endif /* METRICSPLUGIN_H_ */
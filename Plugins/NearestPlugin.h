@@ -29,6 +29,8 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "../Util/StringUtil.h"
 
 #include <fstream>
+#include <utility>
+#include <vector>
 
 /*
  * This Plugin locates the nearest point on a street in the road network for a given coordinate.
@@ -56,7 +58,20 @@ public:
 
         //query to helpdesk
         PhantomNode result;
-        nodeHelpDesk->FindPhantomNodeForCoordinate(routeParameters.coordinates[0], result, routeParameters.zoomLevel);
+        std::vector<std::pair<PhantomNode, double> > candidates;
+        if(1 < routeParameters.numberOfResults) {
+            nodeHelpDesk->FindKNearestPhantomNodesForCoordinate(
+                routeParameters.coordinates[0],
+                routeParameters.zoomLevel,
+                routeParameters.numberOfResults,
+                candidates
+            );
+            if(!candidates.empty()) {
+                result = candidates[0].first;
+            }
+        } else {
+            nodeHelpDesk->FindPhantomNodeForCoordinate(routeParameters.coordinates[0], result, routeParameters.zoomLevel);
+        }
 
         std::string tmp;
         //json
@@ -88,6 +103,29 @@ public:
         if(UINT_MAX != result.edgeBasedNode)
             reply.content += names[result.nodeBasedEdgeNameID];
         reply.content += "\"";
+        if(1 < routeParameters.numberOfResults) {
+            //all candidates, ordered by their distance in meters
+            reply.content += ",\"results\":[";
+            for(unsigned i = 0; i < candidates.size(); ++i) {
+                const PhantomNode & candidate = candidates[i].first;
+                if(0 != i) {
+                    reply.content += ",";
+                }
+                reply.content += "{\"mapped_coordinate\":[";
+                convertInternalLatLonToString(candidate.location.lat, tmp);
+                reply.content += tmp;
+                convertInternalLatLonToString(candidate.location.lon, tmp);
+                reply.content += ",";
+                reply.content += tmp;
+                reply.content += "],\"name\":\"";
+                reply.content += names[candidate.nodeBasedEdgeNameID];
+                reply.content += "\",\"distance\":";
+                intToString(static_cast<int>(candidates[i].second + 0.5), tmp);
+                reply.content += tmp;
+                reply.content += "}";
+            }
+            reply.content += "]";
+        }
         reply.content += ",\"transactionId\":\"OSRM Routing Engine JSON Nearest (v0.3)\"";
         reply.content += ("}");
         reply.headers.resize(3);
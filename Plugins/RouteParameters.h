@@ -28,10 +28,18 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <boost/fusion/sequence/intrinsic.hpp>
 #include <boost/fusion/include/at_c.hpp>
 
+#include <climits>
+
 #include <string>
 #include <vector>
 
 struct RouteParameters {
+    //upper bound for the number of candidates returned by the nearest service
+    static const unsigned MAX_NUMBER_OF_RESULTS = 100;
+    //upper bound for the time limit of the isochrone service in seconds, s.t. it
+    //fits into an int in tenth of seconds
+    static const unsigned MAX_TIME_LIMIT = INT_MAX/10;
+
     RouteParameters() :
         zoomLevel(18),
         printInstructions(false),
@@ -39,7 +47,9 @@ struct RouteParameters {
         geometry(true),
         compression(true),
         deprecatedAPI(false),
-        checkSum(-1) {}
+        checkSum(-1),
+        timeLimit(0),
+        numberOfResults(1) {}
     short zoomLevel;
     bool printInstructions;
     bool alternateRoute;
@@ -47,6 +57,8 @@ struct RouteParameters {
     bool compression;
     bool deprecatedAPI;
     unsigned checkSum;
+    unsigned timeLimit;
+    unsigned numberOfResults;
     std::string service;
     std::string outputFormat;
     std::string jsonpParameter;
@@ -72,6 +84,17 @@ struct RouteParameters {
         checkSum = c;
     }
 
+    void setTimeLimit(const unsigned t) {
+        timeLimit = t;
+        if (MAX_TIME_LIMIT < t)
+            timeLimit = MAX_TIME_LIMIT;
+    }
+
+    void setNumberOfResults(const unsigned n) {
+        if (0 < n && MAX_NUMBER_OF_RESULTS >= n)
+            numberOfResults = n;
+    }
+
     void setInstructionFlag(const bool b) {
         printInstructions = b;
     }
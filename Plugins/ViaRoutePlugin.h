@@ -26,6 +26,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "../Algorithms/ObjectToBase64.h"
 #include "../DataStructures/HashTable.h"
+#include "../DataStructures/PhaseTimings.h"
 #include "../DataStructures/QueryEdge.h"
 #include "../DataStructures/StaticGraph.h"
 #include "../DataStructures/SearchEngine.h"
@@ -52,11 +53,12 @@ private:
     SearchEngine * searchEnginePtr;
 public:
 
-    ViaRoutePlugin(QueryObjectsStorage * objects, std::string psd = "viaroute") : names(objects->names), pluginDescriptorString(psd) {
+    ViaRoutePlugin(QueryObjectsStorage * objects, std::string psd = "viaroute", const bool reuseAlternativeSearchSpaces = false) : names(objects->names), pluginDescriptorString(psd) {
         nodeHelpDesk = objects->nodeHelpDesk;
         graph = objects->graph;
 
         searchEnginePtr = new SearchEngine(graph, nodeHelpDesk, names);
+        searchEnginePtr->alternativePaths.SetSearchSpaceReuse(reuseAlternativeSearchSpaces);
 
         descriptorTable.Set("", 0); //default descriptor
         descriptorTable.Set("json", 0);
@@ -88,17 +90,20 @@ public:
             rawRoute.rawViaNodeCoordinates.push_back(routeParameters.coordinates[i]);
         }
         std::vector<PhantomNode> phantomNodeVector(rawRoute.rawViaNodeCoordinates.size());
-        for(unsigned i = 0; i < rawRoute.rawViaNodeCoordinates.size(); ++i) {
-            if(checksumOK && i < routeParameters.hints.size() && "" != routeParameters.hints[i]) {
-//                INFO("Decoding hint: " << routeParameters.hints[i] << " for location index " << i);
-                DecodeObjectFromBase64(routeParameters.hints[i], phantomNodeVector[i]);
-                if(phantomNodeVector[i].isValid(nodeHelpDesk->getNumberOfNodes())) {
-//                    INFO("Decoded hint " << i << " successfully");
-                    continue;
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::phantomLookup);
+            for(unsigned i = 0; i < rawRoute.rawViaNodeCoordinates.size(); ++i) {
+                if(checksumOK && i < routeParameters.hints.size() && "" != routeParameters.hints[i]) {
+//                    INFO("Decoding hint: " << routeParameters.hints[i] << " for location index " << i);
+                    DecodeObjectFromBase64(routeParameters.hints[i], phantomNodeVector[i]);
+                    if(phantomNodeVector[i].isValid(nodeHelpDesk->getNumberOfNodes())) {
+//                        INFO("Decoded hint " << i << " successfully");
+                        continue;
+                    }
                 }
+//                INFO("Brute force lookup of coordinate " << i);
+                searchEnginePtr->FindPhantomNodeForCoordinate( rawRoute.rawViaNodeCoordinates[i], phantomNodeVector[i], routeParameters.zoomLevel);
             }
-//            INFO("Brute force lookup of coordinate " << i);
-            searchEnginePtr->FindPhantomNodeForCoordinate( rawRoute.rawViaNodeCoordinates[i], phantomNodeVector[i], routeParameters.zoomLevel);
         }
 
         for(unsigned i = 0; i < phantomNodeVector.size()-1; ++i) {
@@ -107,12 +112,15 @@ public:
             segmentPhantomNodes.targetPhantom = phantomNodeVector[i+1];
             rawRoute.segmentEndCoordinates.push_back(segmentPhantomNodes);
         }
-        if( ( routeParameters.alternateRoute ) && (1 == rawRoute.segmentEndCoordinates.size()) ) {
-//            INFO("Checking for alternative paths");
-            searchEnginePtr->alternativePaths(rawRoute.segmentEndCoordinates[0],  rawRoute);
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::search);
+            if( ( routeParameters.alternateRoute ) && (1 == rawRoute.segmentEndCoordinates.size()) ) {
+//                INFO("Checking for alternative paths");
+                searchEnginePtr->alternativePaths(rawRoute.segmentEndCoordinates[0],  rawRoute);
 
-        } else {
-            searchEnginePtr->shortestPath(rawRoute.segmentEndCoordinates, rawRoute);
+            } else {
+                searchEnginePtr->shortestPath(rawRoute.segmentEndCoordinates, rawRoute);
+            }
         }
 
 
@@ -158,7 +166,10 @@ public:
 //        INFO("Number of segments: " << rawRoute.segmentEndCoordinates.size());
         desc->SetConfig(descriptorConfig);
 
-        desc->Run(reply, rawRoute, phantomNodes, *searchEnginePtr);
+        {
+            ScopedPhaseTimer phaseTimer(PhaseTimings::description);
+            desc->Run(reply, rawRoute, phantomNodes, *searchEnginePtr);
+        }
         if("" != routeParameters.jsonpParameter) {
             reply.content += ")\n";
         }
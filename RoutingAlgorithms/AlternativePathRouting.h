@@ -29,10 +29,14 @@ or see http://www.gnu.org/licenses/agpl.txt.
 const double VIAPATH_ALPHA   = 0.15;
 const double VIAPATH_EPSILON = 0.10; //alternative at most 15% longer
 const double VIAPATH_GAMMA   = 0.75; //alternative shares at most 75% with the shortest.
-
-template<class QueryDataT>
-class AlternativeRouting : private BasicRoutingInterface<QueryDataT> {
-    typedef BasicRoutingInterface<QueryDataT> super;
+//number of via node candidates that are T-tested when search spaces are reused
+const unsigned VIAPATH_MAX_CANDIDATE_EVALUATIONS = 10;
+
+//The exploration from s and t does not stall, since its heaps provide the distances
+//of the via paths. Stalls are only propagated on request, see BasicRoutingInterface.
+template<class QueryDataT, bool StallOnDemand = false>
+class AlternativeRouting : private BasicRoutingInterface<QueryDataT, StallOnDemand> {
+    typedef BasicRoutingInterface<QueryDataT, StallOnDemand> super;
     typedef typename QueryDataT::Graph SearchGraph;
     typedef typename QueryDataT::QueryHeap QueryHeap;
     typedef std::pair<NodeID, NodeID> SearchSpaceEdge;
@@ -48,13 +52,21 @@ class AlternativeRouting : private BasicRoutingInterface<QueryDataT> {
     };
 
     const SearchGraph * search_graph;
+    bool reuse_search_spaces;
 
 public:
 
-    AlternativeRouting(QueryDataT & qd) : super(qd), search_graph(qd.graph) { }
+    AlternativeRouting(QueryDataT & qd) : super(qd), search_graph(qd.graph), reuse_search_spaces(false) { }
 
     ~AlternativeRouting() {}
 
+    //Selects the via node from the search spaces of the shortest path query
+    //instead of running new searches for each candidate. Via paths then
+    //consist of the search tree paths s-->v and v-->t.
+    void SetSearchSpaceReuse(const bool reuse) {
+        reuse_search_spaces = reuse;
+    }
+
     void operator()(const PhantomNodes & phantomNodePair, RawRouteData & rawRouteData) {
         if(!phantomNodePair.AtLeastOnePhantomNodeIsUINTMAX() || phantomNodePair.PhantomNodesHaveEqualLocation()) {
             rawRouteData.lengthOfShortestPath = rawRouteData.lengthOfAlternativePath = INT_MAX;
@@ -101,11 +113,31 @@ public:
         }
         sort_unique_resize(viaNodeCandidates);
 
+        //No path between the phantom nodes, nothing to unpack
+        if(INT_MAX == upper_bound_to_shortest_path_distance) {
+            rawRouteData.lengthOfShortestPath = rawRouteData.lengthOfAlternativePath = INT_MAX;
+            return;
+        }
+
         std::vector<NodeID> packed_forward_path;
         std::vector<NodeID> packed_reverse_path;
 
         super::RetrievePackedPathFromSingleHeap(forward_heap1, middle_node, packed_forward_path);
         super::RetrievePackedPathFromSingleHeap(reverse_heap1, middle_node, packed_reverse_path);
+
+        if(reuse_search_spaces) {
+            selectViaNodeFromSearchSpaces(
+                forward_heap1,
+                reverse_heap1,
+                middle_node,
+                upper_bound_to_shortest_path_distance,
+                viaNodeCandidates,
+                packed_forward_path,
+                packed_reverse_path,
+                rawRouteData
+            );
+            return;
+        }
         boost::unordered_map<NodeID, int> approximated_forward_sharing;
         boost::unordered_map<NodeID, int> approximated_reverse_sharing;
 
@@ -332,8 +364,7 @@ private:
     		int *upper_bound_to_shortest_path_distance,
     		std::vector<NodeID>& searchSpaceIntersection,
     		std::vector<SearchSpaceEdge> & search_space,
-    		const int edgeBasedOffset
-    		) const {
+    		const int edgeBasedOffset) const {
         const NodeID node = _forward_heap.DeleteMin();
         const int distance = _forward_heap.GetKey(node);
         int scaledDistance = (distance-edgeBasedOffset)/(1.+VIAPATH_EPSILON);
@@ -382,50 +413,125 @@ private:
         }
     }
 
-    //conduct T-Test
-    inline bool viaNodeCandidatePasses_T_Test( QueryHeap& existingForwardHeap, QueryHeap& existingBackwardHeap, QueryHeap& newForwardHeap, QueryHeap& newBackwardHeap, const RankedCandidateNode& candidate, const int offset, const int lengthOfShortestPath, int * lengthOfViaPath, NodeID * s_v_middle, NodeID * v_t_middle) {
-    	newForwardHeap.Clear();
-    	newBackwardHeap.Clear();
-        std::vector < NodeID > packed_s_v_path;
-        std::vector < NodeID > packed_v_t_path;
+    //Ranks the candidates by length and sharing as given by the search trees
+    //of the shortest path query and T-tests the best ones. Only the T-test
+    //queries are run, each bounded by the length of the tested path.
+    inline void selectViaNodeFromSearchSpaces(QueryHeap & forward_heap, QueryHeap & reverse_heap, const NodeID middle_node, const int lengthOfShortestPath,
+            const std::vector<NodeID> & viaNodeCandidates, const std::vector<NodeID> & packed_forward_path, const std::vector<NodeID> & packed_reverse_path,
+            RawRouteData & rawRouteData) {
+        boost::unordered_map<NodeID, int> forward_sharing;
+        boost::unordered_map<NodeID, int> reverse_sharing;
+        forward_sharing[middle_node] = forward_heap.GetKey(middle_node);
+        reverse_sharing[middle_node] = reverse_heap.GetKey(middle_node);
+        BOOST_FOREACH(const NodeID node, packed_forward_path) {
+            forward_sharing[node] = forward_heap.GetKey(node);
+        }
+        BOOST_FOREACH(const NodeID node, packed_reverse_path) {
+            reverse_sharing[node] = reverse_heap.GetKey(node);
+        }
 
-        *s_v_middle = UINT_MAX;
-        int upperBoundFor_s_v_Path = INT_MAX;
-        //compute path <s,..,v> by reusing forward search from s
-        newBackwardHeap.Insert(candidate.node, 0, candidate.node);
-        while (newBackwardHeap.Size() > 0) {
-            super::RoutingStep(newBackwardHeap, existingForwardHeap, s_v_middle, &upperBoundFor_s_v_Path, 2*offset, false);
+        std::vector<RankedCandidateNode> rankedCandidates;
+        BOOST_FOREACH(const NodeID node, viaNodeCandidates) {
+            const int length = forward_heap.GetKey(node) + reverse_heap.GetKey(node);
+            const int sharing = std::max(0,
+                computeSharingInSearchTree(forward_heap, node, forward_sharing) +
+                computeSharingInSearchTree(reverse_heap, node, reverse_sharing)
+            );
+            bool lengthPassed = (length < lengthOfShortestPath*(1+VIAPATH_EPSILON));
+            bool sharingPassed = (sharing <= lengthOfShortestPath*VIAPATH_GAMMA);
+            bool stretchPassed = length - sharing < (1.+VIAPATH_EPSILON)*(lengthOfShortestPath-sharing);
+            if(lengthPassed && sharingPassed && stretchPassed) {
+                rankedCandidates.push_back(RankedCandidateNode(node, length, sharing));
+            }
         }
+        std::sort(rankedCandidates.begin(), rankedCandidates.end());
 
-        if(INT_MAX == upperBoundFor_s_v_Path)
-            return false;
+        std::vector<NodeID> packedShortestPath(packed_forward_path.rbegin(), packed_forward_path.rend());
+        packedShortestPath.push_back(middle_node);
+        packedShortestPath.insert(packedShortestPath.end(), packed_reverse_path.begin(), packed_reverse_path.end());
+        super::UnpackPath(packedShortestPath, rawRouteData.computedShortestPath);
+        rawRouteData.lengthOfShortestPath = lengthOfShortestPath;
+        rawRouteData.lengthOfAlternativePath = INT_MAX;
 
-        //compute path <v,..,t> by reusing backward search from t
-        *v_t_middle = UINT_MAX;
-        int upperBoundFor_v_t_Path = INT_MAX;
-        newForwardHeap.Insert(candidate.node, 0, candidate.node);
-        while (newForwardHeap.Size() > 0) {
-            super::RoutingStep(newForwardHeap, existingBackwardHeap, v_t_middle, &upperBoundFor_v_t_Path, 2*offset, true);
+        const int T_threshold = VIAPATH_EPSILON * lengthOfShortestPath;
+        const unsigned numberOfEvaluations = std::min<unsigned>(rankedCandidates.size(), VIAPATH_MAX_CANDIDATE_EVALUATIONS);
+        for(unsigned i = 0; i < numberOfEvaluations; ++i) {
+            const NodeID via_node = rankedCandidates[i].node;
+            std::vector<NodeID> packed_s_v_path;
+            super::RetrievePackedPathFromSingleHeap(forward_heap, via_node, packed_s_v_path);
+            std::reverse(packed_s_v_path.begin(), packed_s_v_path.end());
+            packed_s_v_path.push_back(via_node);
+            std::vector<NodeID> packed_v_t_path(1, via_node);
+            super::RetrievePackedPathFromSingleHeap(reverse_heap, via_node, packed_v_t_path);
+
+            NodeID s_P = via_node, t_P = via_node;
+            int lengthOfPathT_Test_Path = 0;
+            if(!computeT_TestEndpoints(packed_s_v_path, packed_v_t_path, T_threshold, &s_P, &t_P, &lengthOfPathT_Test_Path)) {
+                continue;
+            }
+            if(pathIsLocallyOptimal(s_P, t_P, lengthOfPathT_Test_Path)) {
+                // select first admissable
+                std::vector<NodeID> packedViaPath(packed_s_v_path);
+                packedViaPath.insert(packedViaPath.end(), packed_v_t_path.begin()+1, packed_v_t_path.end());
+                super::UnpackPath(packedViaPath, rawRouteData.computedAlternativePath);
+                rawRouteData.lengthOfAlternativePath = rankedCandidates[i].length;
+                return;
+            }
         }
+    }
 
-        if(INT_MAX == upperBoundFor_v_t_Path)
-            return false;
-
-        *lengthOfViaPath = upperBoundFor_s_v_Path + upperBoundFor_v_t_Path;
+    //Length of the path from the root of the search tree to the deepest node
+    //that the tree path to node shares with the shortest path. Known values
+    //are memoized in sharing.
+    inline int computeSharingInSearchTree(QueryHeap & search_heap, const NodeID node, boost::unordered_map<NodeID, int> & sharing) const {
+        std::vector<NodeID> unknown_nodes;
+        NodeID current_node = node;
+        int current_sharing = 0;
+        while(true) {
+            typename boost::unordered_map<NodeID, int>::const_iterator known = sharing.find(current_node);
+            if(sharing.end() != known) {
+                current_sharing = known->second;
+                break;
+            }
+            unknown_nodes.push_back(current_node);
+            const NodeID parent = search_heap.GetData(current_node).parent;
+            if(parent == current_node) {
+                //root of the other phantom node direction
+                break;
+            }
+            current_node = parent;
+        }
+        BOOST_FOREACH(const NodeID unknown_node, unknown_nodes) {
+            sharing[unknown_node] = current_sharing;
+        }
+        return current_sharing;
+    }
 
-        //retrieve packed paths
-        super::RetrievePackedPathFromHeap(existingForwardHeap, newBackwardHeap, *s_v_middle, packed_s_v_path);
-        super::RetrievePackedPathFromHeap(newForwardHeap, existingBackwardHeap, *v_t_middle, packed_v_t_path);
+    //T-test query that is pruned at the length of the tested path. The path
+    //is locally optimal if no shorter path is found.
+    inline bool pathIsLocallyOptimal(const NodeID s_P, const NodeID t_P, const int lengthOfPathT_Test_Path) {
+        super::_queryData.InitializeOrClearThirdThreadLocalStorage();
 
-        NodeID s_P = *s_v_middle, t_P = *v_t_middle;
-        if(UINT_MAX == s_P) {
-            return false;
+        QueryHeap& forward_heap3 = *super::_queryData.forwardHeap3;
+        QueryHeap& backward_heap3 = *super::_queryData.backwardHeap3;
+        int _upperBound = lengthOfPathT_Test_Path;
+        NodeID middle = UINT_MAX;
+        forward_heap3.Insert(s_P, 0, s_P);
+        backward_heap3.Insert(t_P, 0, t_P);
+        while (forward_heap3.Size() + backward_heap3.Size() > 0) {
+            if (forward_heap3.Size() > 0) {
+                super::RoutingStep(forward_heap3, backward_heap3, &middle, &_upperBound, 0, true);
+            }
+            if (backward_heap3.Size() > 0) {
+                super::RoutingStep(backward_heap3, forward_heap3, &middle, &_upperBound, 0, false);
+            }
         }
+        return (_upperBound == lengthOfPathT_Test_Path);
+    }
 
-        if(UINT_MAX == t_P) {
-            return false;
-        }
-        const int T_threshold = VIAPATH_EPSILON * lengthOfShortestPath;
+    //Unpacks the via path around v until the T-test path <s_P,..,v,..,t_P>
+    //reaches T_threshold on either side of v.
+    inline bool computeT_TestEndpoints(const std::vector<NodeID> & packed_s_v_path, const std::vector<NodeID> & packed_v_t_path, const int T_threshold, NodeID * s_P, NodeID * t_P, int * lengthOfPathT_Test_Path) const {
         int unpackedUntilDistance = 0;
 
         std::stack<SearchSpaceEdge> unpackStack;
@@ -437,7 +543,7 @@ private:
                 unpackStack.push(std::make_pair(packed_s_v_path[i - 1], packed_s_v_path[i]));
             } else {
                 unpackedUntilDistance += lengthOfCurrentEdge;
-                s_P = packed_s_v_path[i - 1];
+                *s_P = packed_s_v_path[i - 1];
             }
         }
 
@@ -464,11 +570,11 @@ private:
             } else {
                 // edge is not a shortcut, set the start node for T-Test to end of edge.
                 unpackedUntilDistance += currentEdgeData.distance;
-                s_P = viaPathEdge.first;
+                *s_P = viaPathEdge.first;
             }
         }
 
-        int lengthOfPathT_Test_Path = unpackedUntilDistance;
+        *lengthOfPathT_Test_Path = unpackedUntilDistance;
         unpackedUntilDistance = 0;
         //Traverse path s-->v
         for (unsigned i = 0, lengthOfPackedPath = packed_v_t_path.size() - 1; (i < lengthOfPackedPath) && unpackStack.empty(); ++i) {
@@ -478,7 +584,7 @@ private:
                 unpackStack.push( std::make_pair(packed_v_t_path[i], packed_v_t_path[i + 1]));
             } else {
                 unpackedUntilDistance += lengthOfCurrentEdge;
-                t_P = packed_v_t_path[i + 1];
+                *t_P = packed_v_t_path[i + 1];
             }
         }
 
@@ -504,11 +610,62 @@ private:
             } else {
                 // edge is not a shortcut, set the start node for T-Test to end of edge.
                 unpackedUntilDistance += currentEdgeData.distance;
-                t_P = viaPathEdge.second;
+                *t_P = viaPathEdge.second;
             }
         }
 
-        lengthOfPathT_Test_Path += unpackedUntilDistance;
+        *lengthOfPathT_Test_Path += unpackedUntilDistance;
+        return true;
+    }
+
+    //conduct T-Test
+    inline bool viaNodeCandidatePasses_T_Test( QueryHeap& existingForwardHeap, QueryHeap& existingBackwardHeap, QueryHeap& newForwardHeap, QueryHeap& newBackwardHeap, const RankedCandidateNode& candidate, const int offset, const int lengthOfShortestPath, int * lengthOfViaPath, NodeID * s_v_middle, NodeID * v_t_middle) {
+    	newForwardHeap.Clear();
+    	newBackwardHeap.Clear();
+        std::vector < NodeID > packed_s_v_path;
+        std::vector < NodeID > packed_v_t_path;
+
+        *s_v_middle = UINT_MAX;
+        int upperBoundFor_s_v_Path = INT_MAX;
+        //compute path <s,..,v> by reusing forward search from s
+        newBackwardHeap.Insert(candidate.node, 0, candidate.node);
+        while (newBackwardHeap.Size() > 0) {
+            super::RoutingStep(newBackwardHeap, existingForwardHeap, s_v_middle, &upperBoundFor_s_v_Path, 2*offset, false);
+        }
+
+        if(INT_MAX == upperBoundFor_s_v_Path)
+            return false;
+
+        //compute path <v,..,t> by reusing backward search from t
+        *v_t_middle = UINT_MAX;
+        int upperBoundFor_v_t_Path = INT_MAX;
+        newForwardHeap.Insert(candidate.node, 0, candidate.node);
+        while (newForwardHeap.Size() > 0) {
+            super::RoutingStep(newForwardHeap, existingBackwardHeap, v_t_middle, &upperBoundFor_v_t_Path, 2*offset, true);
+        }
+
+        if(INT_MAX == upperBoundFor_v_t_Path)
+            return false;
+
+        *lengthOfViaPath = upperBoundFor_s_v_Path + upperBoundFor_v_t_Path;
+
+        //retrieve packed paths
+        super::RetrievePackedPathFromHeap(existingForwardHeap, newBackwardHeap, *s_v_middle, packed_s_v_path);
+        super::RetrievePackedPathFromHeap(newForwardHeap, existingBackwardHeap, *v_t_middle, packed_v_t_path);
+
+        NodeID s_P = *s_v_middle, t_P = *v_t_middle;
+        if(UINT_MAX == s_P) {
+            return false;
+        }
+
+        if(UINT_MAX == t_P) {
+            return false;
+        }
+        const int T_threshold = VIAPATH_EPSILON * lengthOfShortestPath;
+        int lengthOfPathT_Test_Path = 0;
+        if(!computeT_TestEndpoints(packed_s_v_path, packed_v_t_path, T_threshold, &s_P, &t_P, &lengthOfPathT_Test_Path)) {
+            return false;
+        }
         //Run actual T-Test query and compare if distances equal.
         super::_queryData.InitializeOrClearThirdThreadLocalStorage();
 
@@ -23,6 +23,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #ifndef BASICROUTINGINTERFACE_H_
 #define BASICROUTINGINTERFACE_H_
 
+#include "../DataStructures/PhaseTimings.h"
 #include "../Plugins/RawRouteData.h"
 #include "../Util/ContainerUtils.h"
 
@@ -32,16 +33,20 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <climits>
 
 #include <stack>
+#include <vector>
 
-template<class QueryDataT>
+//StallOnDemand switches between full stall-on-demand, i.e. stalls are propagated
+//to the queued nodes reachable from a stalled node, and stalling of single nodes.
+template<class QueryDataT, bool StallOnDemand = true>
 class BasicRoutingInterface : boost::noncopyable{
 protected:
+    typedef typename QueryDataT::QueryHeap QueryHeap;
     QueryDataT & _queryData;
 public:
     BasicRoutingInterface(QueryDataT & qd) : _queryData(qd) { }
     virtual ~BasicRoutingInterface(){ };
 
-    inline void RoutingStep(typename QueryDataT::QueryHeap & _forwardHeap, typename QueryDataT::QueryHeap & _backwardHeap, NodeID *middle, int *_upperbound, const int edgeBasedOffset, const bool forwardDirection) const {
+    inline void RoutingStep(QueryHeap & _forwardHeap, QueryHeap & _backwardHeap, NodeID *middle, int *_upperbound, const int edgeBasedOffset, const bool forwardDirection) const {
         const NodeID node = _forwardHeap.DeleteMin();
         const int distance = _forwardHeap.GetKey(node);
         //INFO("Settled (" << _forwardHeap.GetData( node ).parent << "," << node << ")=" << distance);
@@ -61,22 +66,8 @@ public:
             return;
         }
 
-        //Stalling
-        for ( typename QueryDataT::Graph::EdgeIterator edge = _queryData.graph->BeginEdges( node ); edge < _queryData.graph->EndEdges(node); ++edge ) {
-            const typename QueryDataT::Graph::EdgeData & data = _queryData.graph->GetEdgeData(edge);
-            bool backwardDirectionFlag = (!forwardDirection) ? data.forward : data.backward;
-            if(backwardDirectionFlag) {
-                const NodeID to = _queryData.graph->GetTarget(edge);
-                const int edgeWeight = data.distance;
-
-                assert( edgeWeight > 0 );
-
-                if(_forwardHeap.WasInserted( to )) {
-                    if(_forwardHeap.GetKey( to ) + edgeWeight < distance) {
-                        return;
-                    }
-                }
-            }
+        if(StallAtNode(_forwardHeap, node, distance, forwardDirection)) {
+            return;
         }
 
         for ( typename QueryDataT::Graph::EdgeIterator edge = _queryData.graph->BeginEdges( node ); edge < _queryData.graph->EndEdges(node); ++edge ) {
@@ -97,6 +88,7 @@ public:
                 //Found a shorter Path -> Update distance
                 else if ( toDistance < _forwardHeap.GetKey( to ) ) {
                     _forwardHeap.GetData( to ).parent = node;
+                    _forwardHeap.GetData( to ).stalled = false;
                     _forwardHeap.DecreaseKey( to, toDistance );
                     //new parent
                 }
@@ -104,7 +96,64 @@ public:
         }
     }
 
+    //Returns true if node need not be expanded, because it can be reached on a
+    //shorter path via one of its higher ranked neighbours.
+    inline bool StallAtNode(QueryHeap & _forwardHeap, const NodeID node, const int distance, const bool forwardDirection) const {
+        //node has been stalled by propagation and was not reached on a shorter path since
+        if(StallOnDemand && _forwardHeap.GetData(node).stalled) {
+            return true;
+        }
+
+        for ( typename QueryDataT::Graph::EdgeIterator edge = _queryData.graph->BeginEdges( node ); edge < _queryData.graph->EndEdges(node); ++edge ) {
+            const typename QueryDataT::Graph::EdgeData & data = _queryData.graph->GetEdgeData(edge);
+            bool backwardDirectionFlag = (!forwardDirection) ? data.forward : data.backward;
+            if(backwardDirectionFlag) {
+                const NodeID to = _queryData.graph->GetTarget(edge);
+                const int edgeWeight = data.distance;
+
+                assert( edgeWeight > 0 );
+
+                if(_forwardHeap.WasInserted( to )) {
+                    const int stallDistance = _forwardHeap.GetKey( to ) + edgeWeight;
+                    if(stallDistance < distance) {
+                        if(StallOnDemand) {
+                            PropagateStall(_forwardHeap, node, stallDistance, forwardDirection);
+                        }
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+private:
+    //Breadth-first search from a stalled node that marks all queued nodes as
+    //stalled whose tentative distance exceeds the distance via the stalled node.
+    inline void PropagateStall(QueryHeap & _forwardHeap, const NodeID node, const int stallDistance, const bool forwardDirection) const {
+        std::vector<std::pair<NodeID, int> > & stallQueue = _queryData.GetClearedStallQueue();
+        stallQueue.push_back(std::make_pair(node, stallDistance));
+        for(unsigned i = 0; i < stallQueue.size(); ++i) {
+            const NodeID stalledNode = stallQueue[i].first;
+            const int stalledDistance = stallQueue[i].second;
+            for ( typename QueryDataT::Graph::EdgeIterator edge = _queryData.graph->BeginEdges( stalledNode ); edge < _queryData.graph->EndEdges(stalledNode); ++edge ) {
+                const typename QueryDataT::Graph::EdgeData & data = _queryData.graph->GetEdgeData(edge);
+                bool forwardDirectionFlag = (forwardDirection ? data.forward : data.backward );
+                if(forwardDirectionFlag) {
+                    const NodeID to = _queryData.graph->GetTarget(edge);
+                    const int toStallDistance = stalledDistance + data.distance;
+                    if(_forwardHeap.WasInserted( to ) && !_forwardHeap.WasRemoved( to ) && !_forwardHeap.GetData( to ).stalled && toStallDistance < _forwardHeap.GetKey( to )) {
+                        _forwardHeap.GetData( to ).stalled = true;
+                        stallQueue.push_back(std::make_pair(to, toStallDistance));
+                    }
+                }
+            }
+        }
+    }
+
+public:
     inline void UnpackPath(const std::vector<NodeID> & packedPath, std::vector<_PathData> & unpackedPath) const {
+        ScopedPhaseTimer timer(PhaseTimings::unpacking);
         const unsigned sizeOfPackedPath = packedPath.size();
         std::stack<std::pair<NodeID, NodeID> > recursionStack;
 
@@ -0,0 +1,132 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef BATCHROUTING_H_
+#define BATCHROUTING_H_
+
+#include "BasicRoutingInterface.h"
+#include "../DataStructures/Coordinate.h"
+#include "../DataStructures/PhantomNodes.h"
+
+#include <cassert>
+#include <climits>
+#include <cmath>
+
+#include <vector>
+
+//Duration and length of the shortest route between one origin/destination pair
+struct BatchRouteSummary {
+    BatchRouteSummary() : duration(INT_MAX), distance(INT_MAX) {}
+    int duration; //tenth of seconds
+    int distance; //meters
+};
+
+/*
+ * Computes duration and distance of the shortest routes of a list of
+ * independent origin/destination pairs. The thread-local heaps are fetched
+ * once for the whole batch and only cleared in between pairs. No geometry
+ * is produced, the packed path is only unpacked to sum up its length.
+ */
+template<class QueryDataT>
+class BatchRouting : public BasicRoutingInterface<QueryDataT> {
+    typedef BasicRoutingInterface<QueryDataT> super;
+    typedef typename QueryDataT::QueryHeap QueryHeap;
+public:
+    BatchRouting(QueryDataT & qd) : super(qd) {}
+
+    ~BatchRouting() {}
+
+    void operator()(const std::vector<PhantomNodes> & phantomNodePairs, std::vector<BatchRouteSummary> & results) const {
+        results.clear();
+        results.resize(phantomNodePairs.size());
+
+        super::_queryData.InitializeOrClearFirstThreadLocalStorage();
+        QueryHeap & forward_heap = *(super::_queryData.forwardHeap);
+        QueryHeap & reverse_heap = *(super::_queryData.backwardHeap);
+
+        std::vector<NodeID> packedPath;
+        std::vector<_PathData> unpackedPath;
+
+        for(unsigned i = 0; i < phantomNodePairs.size(); ++i) {
+            const PhantomNodes & phantomNodePair = phantomNodePairs[i];
+            //Note the inverted semantics: true iff both phantom nodes are set
+            if(!phantomNodePair.AtLeastOnePhantomNodeIsUINTMAX()) {
+                continue;
+            }
+            const PhantomNode & startPhantom = phantomNodePair.startPhantom;
+            const PhantomNode & targetPhantom = phantomNodePair.targetPhantom;
+
+            forward_heap.Clear();
+            reverse_heap.Clear();
+            int upperBound = INT_MAX;
+            NodeID middle = UINT_MAX;
+
+            forward_heap.Insert(startPhantom.edgeBasedNode, -startPhantom.weight1, startPhantom.edgeBasedNode);
+            if(startPhantom.isBidirected()) {
+                forward_heap.Insert(startPhantom.edgeBasedNode+1, -startPhantom.weight2, startPhantom.edgeBasedNode+1);
+            }
+            reverse_heap.Insert(targetPhantom.edgeBasedNode, targetPhantom.weight1, targetPhantom.edgeBasedNode);
+            if(targetPhantom.isBidirected()) {
+                reverse_heap.Insert(targetPhantom.edgeBasedNode+1, targetPhantom.weight2, targetPhantom.edgeBasedNode+1);
+            }
+            const int forward_offset = startPhantom.weight1 + (startPhantom.isBidirected() ? startPhantom.weight2 : 0);
+            const int reverse_offset = targetPhantom.weight1 + (targetPhantom.isBidirected() ? targetPhantom.weight2 : 0);
+
+            while(0 < (forward_heap.Size() + reverse_heap.Size())) {
+                if(0 < forward_heap.Size()) {
+                    super::RoutingStep(forward_heap, reverse_heap, &middle, &upperBound, forward_offset, true);
+                }
+                if(0 < reverse_heap.Size()) {
+                    super::RoutingStep(reverse_heap, forward_heap, &middle, &upperBound, reverse_offset, false);
+                }
+            }
+
+            if(INT_MAX == upperBound) {
+                continue;
+            }
+
+            packedPath.clear();
+            unpackedPath.clear();
+            super::RetrievePackedPathFromHeap(forward_heap, reverse_heap, middle, packedPath);
+            super::UnpackPath(packedPath, unpackedPath);
+
+            results[i].duration = upperBound;
+            results[i].distance = static_cast<int>(round(ComputeLengthOfPath(startPhantom.location, unpackedPath, targetPhantom.location)));
+        }
+    }
+
+private:
+    //Sums up the length of the polyline through the via nodes of the path
+    inline double ComputeLengthOfPath(const _Coordinate & start, const std::vector<_PathData> & unpackedPath, const _Coordinate & target) const {
+        double length = 0.;
+        _Coordinate previous = start;
+        _Coordinate current;
+        for(unsigned i = 0; i < unpackedPath.size(); ++i) {
+            current.lat = super::_queryData.nodeHelpDesk->getLatitudeOfNode(unpackedPath[i].node);
+            current.lon = super::_queryData.nodeHelpDesk->getLongitudeOfNode(unpackedPath[i].node);
+            length += ApproximateEuclideanDistance(previous, current);
+            previous = current;
+        }
+        length += ApproximateEuclideanDistance(previous, target);
+        return length;
+    }
+};
+
+#endif /* BATCHROUTING_H_ */
@@ -0,0 +1,181 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef MANYTOMANYROUTING_H_
+#define MANYTOMANYROUTING_H_
+
+#include "BasicRoutingInterface.h"
+#include "../DataStructures/PhantomNodes.h"
+
+#include <boost/unordered_map.hpp>
+
+#include <cassert>
+#include <climits>
+
+#include <vector>
+
+/*
+ * Computes a complete distance table between a set of locations with the
+ * bucket-based many-to-many algorithm: one backward upward search per target
+ * deposits (target, distance) entries into per-node buckets, one forward
+ * upward search per source scans the buckets of all nodes it settles.
+ * An NxN table thus costs 2N half-searches instead of N^2 bidirected queries.
+ */
+template<class QueryDataT>
+class ManyToManyRouting : public BasicRoutingInterface<QueryDataT> {
+    typedef BasicRoutingInterface<QueryDataT> super;
+    typedef typename QueryDataT::Graph SearchGraph;
+    typedef typename QueryDataT::QueryHeap QueryHeap;
+
+    struct NodeBucket {
+        NodeBucket(const unsigned t, const int d) : targetID(t), distance(d) {}
+        unsigned targetID; //column in the distance table
+        int distance;
+    };
+    typedef boost::unordered_map<NodeID, std::vector<NodeBucket> > SearchSpaceWithBuckets;
+
+public:
+    ManyToManyRouting(QueryDataT & qd) : super(qd) {}
+
+    ~ManyToManyRouting() {}
+
+    //resultTable is filled row-wise, i.e. entry [i*n+j] holds the distance from location i to location j
+    void operator()(const std::vector<PhantomNode> & phantomNodeVector, std::vector<int> & resultTable) const {
+        const unsigned numberOfLocations = phantomNodeVector.size();
+        resultTable.clear();
+        resultTable.resize(numberOfLocations*numberOfLocations, INT_MAX);
+
+        super::_queryData.InitializeOrClearFirstThreadLocalStorage();
+        QueryHeap & query_heap = *(super::_queryData.forwardHeap);
+
+        SearchSpaceWithBuckets searchSpaceWithBuckets;
+
+        //backward searches from each target, fill buckets
+        for(unsigned targetID = 0; targetID < numberOfLocations; ++targetID) {
+            const PhantomNode & phantomNode = phantomNodeVector[targetID];
+            if(UINT_MAX == phantomNode.edgeBasedNode) {
+                continue;
+            }
+            query_heap.Clear();
+            query_heap.Insert(phantomNode.edgeBasedNode, phantomNode.weight1, phantomNode.edgeBasedNode);
+            if(phantomNode.isBidirected()) {
+                query_heap.Insert(phantomNode.edgeBasedNode+1, phantomNode.weight2, phantomNode.edgeBasedNode+1);
+            }
+            while(0 < query_heap.Size()) {
+                BackwardRoutingStep(targetID, query_heap, searchSpaceWithBuckets);
+            }
+        }
+
+        //forward searches from each source, scan buckets of settled nodes
+        for(unsigned sourceID = 0; sourceID < numberOfLocations; ++sourceID) {
+            const PhantomNode & phantomNode = phantomNodeVector[sourceID];
+            if(UINT_MAX == phantomNode.edgeBasedNode) {
+                continue;
+            }
+            query_heap.Clear();
+            query_heap.Insert(phantomNode.edgeBasedNode, -phantomNode.weight1, phantomNode.edgeBasedNode);
+            if(phantomNode.isBidirected()) {
+                query_heap.Insert(phantomNode.edgeBasedNode+1, -phantomNode.weight2, phantomNode.edgeBasedNode+1);
+            }
+            while(0 < query_heap.Size()) {
+                ForwardRoutingStep(sourceID, numberOfLocations, query_heap, searchSpaceWithBuckets, resultTable);
+            }
+        }
+    }
+
+private:
+    inline void ForwardRoutingStep(
+            const unsigned sourceID,
+            const unsigned numberOfLocations,
+            QueryHeap & query_heap,
+            const SearchSpaceWithBuckets & searchSpaceWithBuckets,
+            std::vector<int> & resultTable) const {
+        const NodeID node = query_heap.DeleteMin();
+        const int sourceDistance = query_heap.GetKey(node);
+
+
+        if(super::StallAtNode(query_heap, node, sourceDistance, true)) {
+            return;
+        }
+
+        //check if each encountered node has an entry
+        const typename SearchSpaceWithBuckets::const_iterator bucketIterator = searchSpaceWithBuckets.find(node);
+        if(bucketIterator != searchSpaceWithBuckets.end()) {
+            const std::vector<NodeBucket> & bucketList = bucketIterator->second;
+            for(unsigned i = 0; i < bucketList.size(); ++i) {
+                const NodeBucket & currentBucket = bucketList[i];
+                const int newDistance = sourceDistance + currentBucket.distance;
+                int & currentDistance = resultTable[sourceID*numberOfLocations + currentBucket.targetID];
+                //negative sums stem from phantom offsets on one and the same edge-based node
+                if(0 <= newDistance && newDistance < currentDistance) {
+                    currentDistance = newDistance;
+                }
+            }
+        }
+
+        RelaxOutgoingEdges<true>(node, sourceDistance, query_heap);
+    }
+
+    inline void BackwardRoutingStep(
+            const unsigned targetID,
+            QueryHeap & query_heap,
+            SearchSpaceWithBuckets & searchSpaceWithBuckets) const {
+        const NodeID node = query_heap.DeleteMin();
+        const int targetDistance = query_heap.GetKey(node);
+
+
+        if(super::StallAtNode(query_heap, node, targetDistance, false)) {
+            return;
+        }
+
+        //store settled nodes in search space bucket
+        searchSpaceWithBuckets[node].push_back(NodeBucket(targetID, targetDistance));
+
+        RelaxOutgoingEdges<false>(node, targetDistance, query_heap);
+    }
+
+    template<bool forwardDirection>
+    inline void RelaxOutgoingEdges(const NodeID node, const int distance, QueryHeap & query_heap) const {
+        for(typename SearchGraph::EdgeIterator edge = super::_queryData.graph->BeginEdges(node); edge < super::_queryData.graph->EndEdges(node); ++edge) {
+            const typename SearchGraph::EdgeData & data = super::_queryData.graph->GetEdgeData(edge);
+            const bool directionFlag = (forwardDirection ? data.forward : data.backward);
+            if(directionFlag) {
+                const NodeID to = super::_queryData.graph->GetTarget(edge);
+                const int edgeWeight = data.distance;
+
+                assert( edgeWeight > 0 );
+                const int toDistance = distance + edgeWeight;
+
+                //New Node discovered -> Add to Heap + Node Info Storage
+                if(!query_heap.WasInserted(to)) {
+                    query_heap.Insert(to, toDistance, node);
+                }
+                //Found a shorter Path -> Update distance
+                else if(toDistance < query_heap.GetKey(to)) {
+                    query_heap.GetData(to).parent = node;
+                    query_heap.GetData(to).stalled = false;
+                    query_heap.DecreaseKey(to, toDistance);
+                }
+            }
+        }
+    }
+};
+
+#endif /* MANYTOMANYROUTING_H_ */
@@ -0,0 +1,112 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef ONETOALLROUTING_H_
+#define ONETOALLROUTING_H_
+
+#include "BasicRoutingInterface.h"
+#include "../DataStructures/DownwardSweepGraph.h"
+#include "../DataStructures/PhantomNodes.h"
+
+#include <cassert>
+#include <climits>
+
+#include <vector>
+
+/*
+ * Computes the distances from one location to all nodes of the contracted
+ * graph PHAST-style: an upward search from the source is followed by a
+ * sweep over all nodes in order of decreasing rank that relaxes the downward
+ * arcs entering each node. Distances beyond maxDistance are cut off.
+ */
+template<class QueryDataT>
+class OneToAllRouting : public BasicRoutingInterface<QueryDataT> {
+    typedef BasicRoutingInterface<QueryDataT> super;
+    typedef typename QueryDataT::Graph SearchGraph;
+    typedef typename QueryDataT::QueryHeap QueryHeap;
+public:
+    typedef DownwardSweepGraph<SearchGraph> SweepGraph;
+
+    OneToAllRouting(QueryDataT & qd) : super(qd) {}
+
+    ~OneToAllRouting() {}
+
+    //distances are indexed by sweep position, INT_MAX denotes a node farther away than maxDistance.
+    //they are stored in thread-local storage that is valid until the next query of the thread.
+    const std::vector<int> & operator()(const PhantomNode & phantomNode, const SweepGraph & sweepGraph, const int maxDistance) const {
+        const unsigned numberOfNodes = sweepGraph.GetNumberOfNodes();
+        std::vector<int> & distances = super::_queryData.GetThreadLocalDistances();
+        distances.assign(numberOfNodes, INT_MAX);
+        if(UINT_MAX == phantomNode.edgeBasedNode) {
+            return distances;
+        }
+
+        super::_queryData.InitializeOrClearFirstThreadLocalStorage();
+        QueryHeap & query_heap = *(super::_queryData.forwardHeap);
+
+        query_heap.Insert(phantomNode.edgeBasedNode, -phantomNode.weight1, phantomNode.edgeBasedNode);
+        if(phantomNode.isBidirected()) {
+            query_heap.Insert(phantomNode.edgeBasedNode+1, -phantomNode.weight2, phantomNode.edgeBasedNode+1);
+        }
+
+        //upward search, its tentative distances are upper bounds for the sweep
+        while(0 < query_heap.Size()) {
+            const NodeID node = query_heap.DeleteMin();
+            const int distance = query_heap.GetKey(node);
+            if(distance > maxDistance) {
+                break;
+            }
+            distances[sweepGraph.GetPosition(node)] = distance;
+
+            for(typename SearchGraph::EdgeIterator edge = super::_queryData.graph->BeginEdges(node); edge < super::_queryData.graph->EndEdges(node); ++edge) {
+                const typename SearchGraph::EdgeData & data = super::_queryData.graph->GetEdgeData(edge);
+                if(data.forward) {
+                    const NodeID to = super::_queryData.graph->GetTarget(edge);
+                    const int toDistance = distance + data.distance;
+                    assert( data.distance > 0 );
+                    if(!query_heap.WasInserted(to)) {
+                        query_heap.Insert(to, toDistance, node);
+                    } else if(toDistance < query_heap.GetKey(to)) {
+                        query_heap.GetData(to).parent = node;
+                        query_heap.DecreaseKey(to, toDistance);
+                    }
+                }
+            }
+        }
+
+        //downward sweep, all arcs entering a position start at earlier positions
+        for(unsigned position = 0; position < numberOfNodes; ++position) {
+            int & distance = distances[position];
+            for(unsigned arc = sweepGraph.BeginArcs(position); arc < sweepGraph.EndArcs(position); ++arc) {
+                const typename SweepGraph::Arc & currentArc = sweepGraph.GetArc(arc);
+                const int sourceDistance = distances[currentArc.sourcePosition];
+                if(INT_MAX != sourceDistance && sourceDistance + currentArc.weight < distance) {
+                    distance = sourceDistance + currentArc.weight;
+                }
+            }
+            if(distance > maxDistance) {
+                distance = INT_MAX;
+            }
+        }
+        return distances;
+    }
+};
+
+#endif /* ONETOALLROUTING_H_ */
@@ -25,9 +25,9 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "BasicRoutingInterface.h"
 
-template<class QueryDataT>
-class ShortestPathRouting : public BasicRoutingInterface<QueryDataT>{
-    typedef BasicRoutingInterface<QueryDataT> super;
+template<class QueryDataT, bool StallOnDemand = true>
+class ShortestPathRouting : public BasicRoutingInterface<QueryDataT, StallOnDemand>{
+    typedef BasicRoutingInterface<QueryDataT, StallOnDemand> super;
     typedef typename QueryDataT::QueryHeap QueryHeap;
 public:
     ShortestPathRouting( QueryDataT & qd) : super(qd) {}
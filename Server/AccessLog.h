@@ -0,0 +1,218 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef ACCESSLOG_H_
+#define ACCESSLOG_H_
+
+#include "BasicDatastructures.h"
+
+#include "../DataStructures/LockFreeRingBuffer.h"
+#include "../typedefs.h"
+
+#include <boost/asio.hpp>
+#include <boost/atomic.hpp>
+#include <boost/bind.hpp>
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/thread.hpp>
+
+#include <cstdio>
+#include <ctime>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+static const unsigned ACCESS_LOG_BUFFER_SIZE = 16384;
+static const unsigned ACCESS_LOG_FLUSH_INTERVAL_MS = 100;
+
+struct AccessLogEntry {
+    AccessLogEntry() : time(0) { }
+    time_t time;
+    boost::asio::ip::address endpoint;
+    std::string referrer;
+    std::string agent;
+    std::string uri;
+};
+
+inline void swap(AccessLogEntry & a, AccessLogEntry & b) {
+    std::swap(a.time, b.time);
+    std::swap(a.endpoint, b.endpoint);
+    a.referrer.swap(b.referrer);
+    a.agent.swap(b.agent);
+    a.uri.swap(b.uri);
+}
+
+/*
+ * Request threads put their entries into a lock-free ring buffer. A
+ * background thread formats them and writes them in batches, so no request
+ * thread ever waits for the output. When the buffer is full, entries are
+ * dropped and counted instead. Optionally, only every n-th request of a
+ * thread is logged, and the log file is rotated once it reaches a size.
+ */
+class AccessLog : boost::noncopyable {
+public:
+    //an empty path logs to stdout, a maximum size of 0 disables the rotation
+    AccessLog(
+        const std::string & path,
+        const unsigned sampleRate,
+        const uint64_t maxFileSize,
+        const unsigned numberOfRotations
+    ) :
+        path(path),
+        sampleRate(std::max(1u, sampleRate)),
+        maxFileSize(maxFileSize),
+        numberOfRotations(numberOfRotations),
+        bytesWritten(0),
+        buffer(ACCESS_LOG_BUFFER_SIZE),
+        droppedEntries(0),
+        reportedDroppedEntries(0)
+    {
+        if(!path.empty()) {
+            file.open(path.c_str(), std::ios::app);
+            if(!file) {
+                ERR("could not open access log " << path);
+            }
+            file.seekp(0, std::ios::end);
+            bytesWritten = file.tellp();
+        }
+        writer = boost::thread(boost::bind(&AccessLog::Run, this));
+    }
+
+    ~AccessLog() {
+        writer.interrupt();
+        writer.join();
+    }
+
+    void Log(const http::Request & request) {
+        if(1 < sampleRate) {
+            if(!requestsOfThread.get()) {
+                requestsOfThread.reset(new unsigned(0));
+            }
+            if(0 != (*requestsOfThread)++ % sampleRate) {
+                return;
+            }
+        }
+        AccessLogEntry entry;
+        entry.time = time(NULL);
+        entry.endpoint = request.endpoint;
+        entry.referrer = request.referrer;
+        entry.agent = request.agent;
+        entry.uri = request.uri;
+        if(!buffer.TryPush(entry)) {
+            droppedEntries.fetch_add(1, boost::memory_order_relaxed);
+        }
+    }
+
+    uint64_t GetNumberOfDroppedEntries() const {
+        return droppedEntries.load(boost::memory_order_relaxed);
+    }
+
+private:
+    void Run() {
+        try {
+            while(true) {
+                WritePendingEntries();
+                boost::this_thread::sleep(boost::posix_time::milliseconds(ACCESS_LOG_FLUSH_INTERVAL_MS));
+            }
+        } catch(boost::thread_interrupted &) {
+            //shutting down, write what is left
+            WritePendingEntries();
+        }
+    }
+
+    void WritePendingEntries() {
+        std::ostringstream lines;
+        AccessLogEntry entry;
+        while(buffer.TryPop(entry)) {
+            FormatEntry(entry, lines);
+        }
+        const uint64_t dropped = droppedEntries.load(boost::memory_order_relaxed);
+        if(dropped != reportedDroppedEntries) {
+            lines << "[access log] buffer overflow, dropped " << (dropped - reportedDroppedEntries) << " entries\n";
+            reportedDroppedEntries = dropped;
+        }
+        const std::string & output = lines.str();
+        if(output.empty()) {
+            return;
+        }
+        std::ostream & out = (path.empty() ? std::cout : file);
+        out.write(output.c_str(), output.size());
+        out.flush();
+        bytesWritten += output.size();
+        if(!path.empty() && 0 < maxFileSize && maxFileSize <= bytesWritten) {
+            Rotate();
+        }
+    }
+
+    //dd-mm-yyyy hh:mm:ss endpoint referrer agent uri
+    static void FormatEntry(const AccessLogEntry & entry, std::ostringstream & lines) {
+        struct tm localTime;
+#ifdef _WIN32
+        localtime_s(&localTime, &entry.time);
+#else
+        localtime_r(&entry.time, &localTime);
+#endif
+        char timeString[32];
+        strftime(timeString, sizeof(timeString), "%d-%m-%Y %H:%M:%S", &localTime);
+        lines << timeString << " " << entry.endpoint.to_string() << " ";
+        lines << (entry.referrer.empty() ? "-" : entry.referrer) << " ";
+        lines << (entry.agent.empty() ? "-" : entry.agent) << " ";
+        lines << entry.uri << "\n";
+    }
+
+    //log -> log.1 -> log.2 ..., the oldest file is removed. Without rotations the log is truncated
+    void Rotate() {
+        file.close();
+        if(0 < numberOfRotations) {
+            std::ostringstream oldest;
+            oldest << path << "." << numberOfRotations;
+            std::remove(oldest.str().c_str());
+            for(unsigned i = numberOfRotations; i > 1; --i) {
+                std::ostringstream from, to;
+                from << path << "." << (i-1);
+                to << path << "." << i;
+                std::rename(from.str().c_str(), to.str().c_str());
+            }
+            std::rename(path.c_str(), (path + ".1").c_str());
+        }
+        file.open(path.c_str(), std::ios::trunc);
+        if(!file) {
+            WARN("could not reopen access log " << path);
+        }
+        bytesWritten = 0;
+    }
+
+    const std::string path;
+    const unsigned sampleRate;
+    const uint64_t maxFileSize;
+    const unsigned numberOfRotations;
+    std::ofstream file;
+    uint64_t bytesWritten;
+    LockFreeRingBuffer<AccessLogEntry> buffer;
+    boost::atomic<uint64_t> droppedEntries;
+    uint64_t reportedDroppedEntries;
+    boost::thread_specific_ptr<unsigned> requestsOfThread;
+    boost::thread writer;
+};
+
+#endif /* ACCESSLOG_H_ */
@@ -58,10 +58,13 @@ enum CompressionType {
 } Compression;
 
 struct Request {
+	Request() : keepAlive(false) {}
 	std::string uri;
 	std::string referrer;
 	std::string agent;
 	boost::asio::ip::address endpoint;
+	//client wants to send further requests over the same connection
+	bool keepAlive;
 };
 
 struct Reply {
@@ -31,17 +31,111 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/enable_shared_from_this.hpp>
+#include <boost/foreach.hpp>
+#include <boost/thread/tss.hpp>
 
 #include <zlib.h>
 
+#include <cassert>
+
+#include <deque>
+#include <stdexcept>
 #include <vector>
 
 namespace http {
 
-/// Represents a single connection from a client.
+const std::size_t COMPRESSED_CHUNK_SIZE = 64 * 1024;
+
+/// How replies are compressed for clients that accept it.
+struct CompressionSettings {
+	CompressionSettings() : level(Z_DEFAULT_COMPRESSION), minimumSize(0) {}
+	//zlib level from 1 (fastest) to 9 (smallest), 0 disables compression
+	int level;
+	//replies with less bytes are sent uncompressed
+	unsigned minimumSize;
+};
+
+/// Deflate streams of a thread. They are set up once and reset for every reply.
+class DeflateStreams : private boost::noncopyable {
+public:
+	DeflateStreams() {
+		initialized[0] = initialized[1] = false;
+	}
+
+	~DeflateStreams() {
+		for(unsigned i = 0; i < 2; ++i) {
+			if(initialized[i]) {
+				deflateEnd(&streams[i]);
+			}
+		}
+	}
+
+	z_stream & Get(const CompressionType type, const int level) {
+		const unsigned i = (gzipRFC1952 == type ? 1 : 0);
+		if(initialized[i] && level != levels[i]) {
+			deflateEnd(&streams[i]);
+			initialized[i] = false;
+		}
+		if(initialized[i]) {
+			deflateReset(&streams[i]);
+			return streams[i];
+		}
+		streams[i].zalloc = Z_NULL;
+		streams[i].zfree = Z_NULL;
+		streams[i].opaque = Z_NULL;
+		/*
+		 * Big thanks to deusty who explains how to have gzip compression turned on by the right call to deflateInit2():
+		 * http://deusty.blogspot.com/2007/07/gzip-compressiondecompression.html
+		 */
+		const int windowBits = (gzipRFC1952 == type ? 15+16 : 15);
+		if(Z_OK != deflateInit2(&streams[i], level, Z_DEFLATED, windowBits, 9, Z_DEFAULT_STRATEGY)) {
+			throw std::runtime_error("could not initialize zlib stream");
+		}
+		initialized[i] = true;
+		levels[i] = level;
+		return streams[i];
+	}
+
+	static DeflateStreams & GetStreamsOfThread() {
+		static boost::thread_specific_ptr<DeflateStreams> streams;
+		if(!streams.get()) {
+			streams.reset(new DeflateStreams());
+		}
+		return *streams;
+	}
+
+private:
+	//deflate and gzip
+	z_stream streams[2];
+	bool initialized[2];
+	int levels[2];
+};
+
+/// Represents a single, possibly persistent connection from a client.
 class Connection : public boost::enable_shared_from_this<Connection>, private boost::noncopyable {
 public:
-	explicit Connection(boost::asio::io_service& io_service, RequestHandler& handler) : strand(io_service), TCPsocket(io_service), requestHandler(handler) {}
+	explicit Connection(
+		boost::asio::io_service& io_service,
+		RequestHandler& handler,
+		const unsigned keepAliveTimeout,
+		const unsigned maxKeepAliveRequests,
+		const CompressionSettings & compressionSettings
+	) :
+		strand(io_service),
+		TCPsocket(io_service),
+		idleTimer(io_service),
+		requestHandler(handler),
+		keepAliveTimeout(keepAliveTimeout),
+		maxKeepAliveRequests(maxKeepAliveRequests),
+		numberOfHandledRequests(0),
+		keepAlive(false),
+		compressionSettings(compressionSettings),
+		compressionType(noCompression),
+		unparsedBegin(NULL),
+		unparsedEnd(NULL),
+		numberOfCompressedChunks(0),
+		sizeOfLastCompressedChunk(0)
+	{}
 
 	boost::asio::ip::tcp::socket& socket() {
 		return TCPsocket;
@@ -49,131 +143,173 @@ public:
 
 	/// Start the first asynchronous operation for the connection.
 	void start() {
-	    TCPsocket.async_read_some(boost::asio::buffer(incomingDataBuffer), strand.wrap( boost::bind(&Connection::handleRead, this->shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)));
+		startRead();
 	}
 
 private:
+	/// Waits for more data. Clients that stay idle for too long are disconnected.
+	void startRead() {
+		idleTimer.expires_from_now(boost::posix_time::seconds(keepAliveTimeout));
+		idleTimer.async_wait(strand.wrap( boost::bind(&Connection::handleTimeout, this->shared_from_this(), boost::asio::placeholders::error)));
+		TCPsocket.async_read_some(boost::asio::buffer(incomingDataBuffer), strand.wrap( boost::bind(&Connection::handleRead, this->shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)));
+	}
+
+	void handleTimeout(const boost::system::error_code& e) {
+		//the timer may have been rearmed after this handler was queued
+		if (boost::asio::error::operation_aborted != e && idleTimer.expires_at() <= boost::asio::deadline_timer::traits_type::now()) {
+			boost::system::error_code ignoredEC;
+			TCPsocket.close(ignoredEC);
+		}
+	}
+
 	void handleRead(const boost::system::error_code& e, std::size_t bytes_transferred) {
+		idleTimer.cancel();
 		if (!e) {
-			CompressionType compressionType(noCompression);
-			boost::tribool result;
-			boost::tie(result, boost::tuples::ignore) = requestParser.Parse( request, incomingDataBuffer.data(), incomingDataBuffer.data() + bytes_transferred, &compressionType);
-
-			if (result) {
-				//                std::cout << "----" << std::endl;
-				//				if(compressionType == gzipRFC1952)
-				//					std::cout << "[debug] using gzip" << std::endl;
-				//				if(compressionType == deflateRFC1951)
-				//					std::cout << "[debug] using deflate" << std::endl;
-				//				if(compressionType == noCompression)
-				//					std::cout << "[debug] no compression" << std::endl;
-			    request.endpoint = TCPsocket.remote_endpoint().address();
-				requestHandler.handle_request(request, reply);
-
-				Header compressionHeader;
-				std::vector<unsigned char> compressed;
-				std::vector<boost::asio::const_buffer> outputBuffer;
-				switch(compressionType) {
-				case deflateRFC1951:
-					compressionHeader.name = "Content-Encoding";
-					compressionHeader.value = "deflate";
-					reply.headers.insert(reply.headers.begin(), compressionHeader);   //push_back(compressionHeader);
-					compressCharArray(reply.content.c_str(), reply.content.length(), compressed, compressionType);
-					reply.setSize(compressed.size());
-					outputBuffer = reply.HeaderstoBuffers();
-					outputBuffer.push_back(boost::asio::buffer(compressed));
-					boost::asio::async_write(TCPsocket, outputBuffer, strand.wrap( boost::bind(&Connection::handleWrite, this->shared_from_this(), boost::asio::placeholders::error)));
-					break;
-				case gzipRFC1952:
-					compressionHeader.name = "Content-Encoding";
-					compressionHeader.value = "gzip";
-					reply.headers.insert(reply.headers.begin(), compressionHeader);
-					compressCharArray(reply.content.c_str(), reply.content.length(), compressed, compressionType);
-					reply.setSize(compressed.size());
-					outputBuffer = reply.HeaderstoBuffers();
-					outputBuffer.push_back(boost::asio::buffer(compressed));
-					boost::asio::async_write(TCPsocket, outputBuffer, strand.wrap( boost::bind(&Connection::handleWrite, this->shared_from_this(), boost::asio::placeholders::error)));break;
-				case noCompression:
-					boost::asio::async_write(TCPsocket, reply.toBuffers(), strand.wrap( boost::bind(&Connection::handleWrite, this->shared_from_this(), boost::asio::placeholders::error)));
-					break;
-				}
-
-			} else if (!result) {
-				reply = Reply::stockReply(Reply::badRequest);
-				boost::asio::async_write(TCPsocket, reply.toBuffers(), strand.wrap( boost::bind(&Connection::handleWrite, this->shared_from_this(), boost::asio::placeholders::error)));
-			} else {
-				TCPsocket.async_read_some(boost::asio::buffer(incomingDataBuffer), strand.wrap( boost::bind(&Connection::handleRead, this->shared_from_this(), boost::asio::placeholders::error, boost::asio::placeholders::bytes_transferred)));
+			unparsedBegin = incomingDataBuffer.data();
+			unparsedEnd = incomingDataBuffer.data() + bytes_transferred;
+			handleUnparsedData();
+		}
+	}
+
+	/// Parses buffered data. Pipelined requests are answered one after the other.
+	void handleUnparsedData() {
+		boost::tribool result;
+		boost::tie(result, unparsedBegin) = requestParser.Parse( request, unparsedBegin, unparsedEnd, &compressionType);
+
+		if (result) {
+			++numberOfHandledRequests;
+			keepAlive = request.keepAlive && (numberOfHandledRequests < maxKeepAliveRequests);
+			boost::system::error_code ignoredEC;
+			request.endpoint = TCPsocket.remote_endpoint(ignoredEC).address();
+			requestHandler.handle_request(request, reply);
+			writeReply();
+		} else if (!result) {
+			keepAlive = false;
+			compressionType = noCompression;
+			reply = Reply::stockReply(Reply::badRequest);
+			writeReply();
+		} else {
+			startRead();
+		}
+	}
+
+	void writeReply() {
+		bool replyHasContentLength = false;
+		BOOST_FOREACH(const Header & h, reply.headers) {
+			replyHasContentLength |= ("Content-Length" == h.name);
+		}
+		Header header;
+		if(!replyHasContentLength) {
+			//the client needs the length to find the end of a reply on a persistent connection
+			header.name = "Content-Length";
+			intToString(reply.content.length(), header.value);
+			reply.headers.push_back(header);
+		}
+		header.name = "Connection";
+		header.value = (keepAlive ? "keep-alive" : "close");
+		reply.headers.push_back(header);
+
+		if(0 == compressionSettings.level || reply.content.length() < compressionSettings.minimumSize) {
+			compressionType = noCompression;
+		}
+
+		std::vector<boost::asio::const_buffer> outputBuffer;
+		if(noCompression == compressionType) {
+			outputBuffer = reply.toBuffers();
+		} else {
+			header.name = "Content-Encoding";
+			header.value = (gzipRFC1952 == compressionType ? "gzip" : "deflate");
+			reply.headers.insert(reply.headers.begin(), header);
+			reply.setSize(compressReply());
+			outputBuffer = reply.HeaderstoBuffers();
+			for(unsigned i = 0; i < numberOfCompressedChunks; ++i) {
+				const std::size_t size = (i+1 == numberOfCompressedChunks ? sizeOfLastCompressedChunk : COMPRESSED_CHUNK_SIZE);
+				outputBuffer.push_back(boost::asio::buffer(&compressedChunks[i][0], size));
 			}
 		}
+		boost::asio::async_write(TCPsocket, outputBuffer, strand.wrap( boost::bind(&Connection::handleWrite, this->shared_from_this(), boost::asio::placeholders::error)));
 	}
 
 	/// Handle completion of a write operation.
 	void handleWrite(const boost::system::error_code& e) {
-		if (!e) {
+		if (e) {
+			return;
+		}
+		if (!keepAlive) {
 			// Initiate graceful connection closure.
 			boost::system::error_code ignoredEC;
 			TCPsocket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignoredEC);
+			// No new asynchronous operations are started. This means that all shared_ptr
+			// references to the connection object will disappear and the object will be
+			// destroyed automatically after this handler returns. The connection class's
+			// destructor closes the socket.
+			return;
 		}
-		// No new asynchronous operations are started. This means that all shared_ptr
-		// references to the connection object will disappear and the object will be
-		// destroyed automatically after this handler returns. The connection class's
-		// destructor closes the socket.
-	}
 
-	void compressCharArray(const void *in_data, size_t in_data_size, std::vector<unsigned char> &buffer, CompressionType type) {
-		const size_t BUFSIZE = 128 * 1024;
-		unsigned char temp_buffer[BUFSIZE];
-
-		z_stream strm;
-		strm.zalloc = Z_NULL;
-		strm.zfree = Z_NULL;
-		strm.opaque = Z_NULL;
-		strm.total_out = 0;
-		strm.next_in = (unsigned char *)(in_data);
-		strm.avail_in = in_data_size;
-		strm.next_out = temp_buffer;
-		strm.avail_out = BUFSIZE;
-		strm.data_type = Z_ASCII;
-
-		switch(type){
-		case deflateRFC1951:
-			deflateInit(&strm, Z_BEST_SPEED);
-			break;
-		case gzipRFC1952:
-			/*
-			 * Big thanks to deusty who explains how to have gzip compression turned on by the right call to deflateInit2():
-			 * http://deusty.blogspot.com/2007/07/gzip-compressiondecompression.html
-			 */
-			deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, (15+16), 9, Z_DEFAULT_STRATEGY);
-			break;
-		default:
-			assert(false);
-			break;
+		//get ready for the next request on this connection
+		requestParser.Reset();
+		request = Request();
+		reply.status = Reply::ok;
+		reply.headers.clear();
+		reply.content.clear();
+		numberOfCompressedChunks = 0;
+		sizeOfLastCompressedChunk = 0;
+		compressionType = noCompression;
+
+		if (unparsedBegin != unparsedEnd) {
+			handleUnparsedData();
+		} else {
+			startRead();
 		}
+	}
+
+	/// Compresses the content into chunks that are handed to the socket as they are.
+	/// The chunks are kept for the following replies on the connection.
+	/// Returns the compressed size.
+	std::size_t compressReply() {
+		z_stream & stream = DeflateStreams::GetStreamsOfThread().Get(compressionType, compressionSettings.level);
+		stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(reply.content.data()));
+		stream.avail_in = reply.content.length();
+		stream.data_type = Z_ASCII;
 
-		int deflate_res = Z_OK;
+		numberOfCompressedChunks = 0;
+		int deflateResult = Z_OK;
 		do {
-			if (strm.avail_out == 0) {
-				buffer.insert(buffer.end(), temp_buffer, temp_buffer + BUFSIZE);
-				strm.next_out = temp_buffer;
-				strm.avail_out = BUFSIZE;
+			if(compressedChunks.size() == numberOfCompressedChunks) {
+				compressedChunks.push_back(std::vector<unsigned char>(COMPRESSED_CHUNK_SIZE));
 			}
-			deflate_res = deflate(&strm, Z_FINISH);
-
-		} while (deflate_res == Z_OK);
+			stream.next_out = &compressedChunks[numberOfCompressedChunks][0];
+			stream.avail_out = COMPRESSED_CHUNK_SIZE;
+			++numberOfCompressedChunks;
+			deflateResult = deflate(&stream, Z_FINISH);
+		} while (Z_OK == deflateResult);
 
-		assert(deflate_res == Z_STREAM_END);
-		buffer.insert(buffer.end(), temp_buffer, temp_buffer + BUFSIZE - strm.avail_out);
-		deflateEnd(&strm);
+		assert(Z_STREAM_END == deflateResult);
+		sizeOfLastCompressedChunk = COMPRESSED_CHUNK_SIZE - stream.avail_out;
+		return (numberOfCompressedChunks-1)*COMPRESSED_CHUNK_SIZE + sizeOfLastCompressedChunk;
 	}
 
 	boost::asio::io_service::strand strand;
 	boost::asio::ip::tcp::socket TCPsocket;
+	boost::asio::deadline_timer idleTimer;
 	RequestHandler& requestHandler;
+	const unsigned keepAliveTimeout; //seconds
+	const unsigned maxKeepAliveRequests;
+	unsigned numberOfHandledRequests;
+	bool keepAlive;
+	const CompressionSettings compressionSettings;
+	CompressionType compressionType;
 	boost::array<char, 8192> incomingDataBuffer;
+	//received, but not yet parsed part of incomingDataBuffer
+	char * unparsedBegin;
+	char * unparsedEnd;
 	Request request;
 	RequestParser requestParser;
 	Reply reply;
+	//deque, so that adding a chunk does not copy the others
+	std::deque<std::vector<unsigned char> > compressedChunks;
+	unsigned numberOfCompressedChunks;
+	std::size_t sizeOfLastCompressedChunk;
 };
 
 } // namespace http
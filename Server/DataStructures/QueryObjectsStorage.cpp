@@ -21,6 +21,10 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include "QueryObjectsStorage.h"
 #include "../../Util/GraphLoader.h"
+#include "../../Util/MemoryMappedFile.h"
+#include "../../Util/OSRMException.h"
+#include "../../Util/SharedMemory.h"
+#include "../../DataStructures/SharedDataLayout.h"
 
 QueryObjectsStorage::QueryObjectsStorage(
 	const std::string & hsgrPath,
@@ -29,26 +33,74 @@ QueryObjectsStorage::QueryObjectsStorage(
 	const std::string & nodesPath,
 	const std::string & edgesPath,
 	const std::string & namesPath,
-	const std::string & timestampPath
-) {
+	const std::string & timestampPath,
+	const std::string & levelPath,
+	const bool memoryMapGraph,
+	const bool memoryMapFileIndex
+) : mappedGraphFile(NULL), sharedDataRegion(NULL) {
 	INFO("loading graph data");
-	std::ifstream hsgrInStream(hsgrPath.c_str(), std::ios::binary);
-    if(!hsgrInStream) { ERR(hsgrPath <<  " not found"); }
-	//Deserialize road network graph
-	std::vector< QueryGraph::_StrNode> nodeList;
-	std::vector< QueryGraph::_StrEdge> edgeList;
-	const int n = readHSGRFromStream(
-		hsgrInStream,
-		nodeList,
-		edgeList,
-		&checkSum
-	);
-	hsgrInStream.close();
+	int n = 0;
+	if(memoryMapGraph) {
+		//The graph is used in place and shares its pages with every other
+		//process that maps the same file.
+		mappedGraphFile = new MemoryMappedFile(hsgrPath);
+		mappedGraphFile->AdviseRandomAccess();
+		const QueryGraph::_StrNode * nodeArray = NULL;
+		const QueryGraph::_StrEdge * edgeArray = NULL;
+		unsigned numberOfEdges = 0;
+		try {
+			n = mapHSGRFromMemory(
+				mappedGraphFile->GetData(),
+				mappedGraphFile->GetSize(),
+				&nodeArray,
+				&edgeArray,
+				&numberOfEdges,
+				&checkSum
+			);
+		} catch(std::exception & e) {
+			ERR(hsgrPath << ": " << e.what());
+		}
+		//same node count as a graph that was read into memory, see StaticGraph
+		graph = new QueryGraph(nodeArray, n+1, edgeArray, numberOfEdges);
+	} else {
+		std::ifstream hsgrInStream(hsgrPath.c_str(), std::ios::binary);
+		if(!hsgrInStream) { ERR(hsgrPath <<  " not found"); }
+		//Deserialize road network graph
+		std::vector< QueryGraph::_StrNode> nodeList;
+		std::vector< QueryGraph::_StrEdge> edgeList;
+		n = readHSGRFromStream(
+			hsgrInStream,
+			nodeList,
+			edgeList,
+			&checkSum
+		);
+		hsgrInStream.close();
 
+		graph = new QueryGraph(nodeList, edgeList);
+		assert(0 == nodeList.size());
+		assert(0 == edgeList.size());
+	}
 	INFO("Data checksum is " << checkSum);
-	graph = new QueryGraph(nodeList, edgeList);
-	assert(0 == nodeList.size());
-	assert(0 == edgeList.size());
+
+	if(levelPath.length()) {
+	    INFO("Loading node ranks");
+	    std::ifstream levelInStream(levelPath.c_str(), std::ios::binary);
+	    if(!levelInStream) {
+	        WARN(levelPath <<  " not found");
+	    } else {
+	        unsigned levelCheckSum = 0;
+	        unsigned numberOfRankedNodes = 0;
+	        levelInStream.read((char *)&levelCheckSum, sizeof(unsigned));
+	        levelInStream.read((char *)&numberOfRankedNodes, sizeof(unsigned));
+	        if(levelCheckSum != checkSum) {
+	            WARN(levelPath << " does not match the graph data, ignoring it");
+	        } else {
+	            nodeRanks.resize(numberOfRankedNodes);
+	            levelInStream.read((char *)&nodeRanks[0], numberOfRankedNodes*sizeof(unsigned));
+	        }
+	    }
+	    levelInStream.close();
+	}
 
 	if(timestampPath.length()) {
 	    INFO("Loading Timestamp");
@@ -73,7 +125,8 @@ QueryObjectsStorage::QueryObjectsStorage(
 		nodesPath,
 		edgesPath,
 		n,
-		checkSum
+		checkSum,
+		memoryMapFileIndex
 	);
 
 	//deserialize street name list
@@ -96,8 +149,98 @@ QueryObjectsStorage::QueryObjectsStorage(
 	INFO("All query data structures loaded");
 }
 
+QueryObjectsStorage::QueryObjectsStorage(SharedMemoryRegion * region) : nodeHelpDesk(NULL), graph(NULL), mappedGraphFile(NULL), sharedDataRegion(region) {
+	try {
+		AttachToSharedData();
+	} catch(...) {
+		//the destructor does not run for a half constructed object
+		delete graph;
+		delete nodeHelpDesk;
+		delete sharedDataRegion;
+		throw;
+	}
+}
+
+void QueryObjectsStorage::AttachToSharedData() {
+	INFO("attaching to shared memory region " << sharedDataRegion->GetName());
+	const char * sharedData = sharedDataRegion->GetData();
+	if(sizeof(SharedDataLayout) > sharedDataRegion->GetSize()) {
+		throw OSRMException("shared memory region " + sharedDataRegion->GetName() + " is truncated");
+	}
+	const SharedDataLayout & layout = *reinterpret_cast<const SharedDataLayout *>(sharedData);
+	if(!layout.IsValidForRegionOfSize(sharedDataRegion->GetSize())) {
+		throw OSRMException("shared memory region " + sharedDataRegion->GetName() + " was written by an incompatible osrm-datastore");
+	}
+
+	const QueryGraph::_StrNode * nodeArray = NULL;
+	const QueryGraph::_StrEdge * edgeArray = NULL;
+	unsigned numberOfEdges = 0;
+	const int n = mapHSGRFromMemory(
+		layout.GetBlock<char>(sharedData, SharedDataLayout::HSGR_DATA),
+		layout.blockSize[SharedDataLayout::HSGR_DATA],
+		&nodeArray,
+		&edgeArray,
+		&numberOfEdges,
+		&checkSum
+	);
+	graph = new QueryGraph(nodeArray, n+1, edgeArray, numberOfEdges);
+	INFO("Data checksum is " << checkSum);
+
+	//same format as the .level file, empty if there was none
+	if(2*sizeof(unsigned) <= layout.blockSize[SharedDataLayout::LEVEL_DATA]) {
+	    const unsigned * levelData = layout.GetBlock<unsigned>(sharedData, SharedDataLayout::LEVEL_DATA);
+	    const unsigned numberOfRankedNodes = levelData[1];
+	    if(levelData[0] != checkSum || (2+numberOfRankedNodes)*sizeof(unsigned) > layout.blockSize[SharedDataLayout::LEVEL_DATA]) {
+	        WARN("node ranks do not match the graph data, ignoring them");
+	    } else {
+	        nodeRanks.assign(levelData + 2, levelData + 2 + numberOfRankedNodes);
+	    }
+	}
+
+	timestamp.assign(
+		layout.GetBlock<char>(sharedData, SharedDataLayout::TIMESTAMP),
+		layout.blockSize[SharedDataLayout::TIMESTAMP]
+	);
+	timestamp = timestamp.substr(0, timestamp.find('\n'));
+	if(!timestamp.length()) {
+	    timestamp = "n/a";
+	}
+	if(25 < timestamp.length()) {
+	    timestamp.resize(25);
+	}
+
+	nodeHelpDesk = new NodeInformationHelpDesk(layout, sharedData, n, checkSum);
+
+	//same format as the .names file
+	const char * namesData = layout.GetBlock<char>(sharedData, SharedDataLayout::NAMES_DATA);
+	const char * namesEnd = namesData + layout.blockSize[SharedDataLayout::NAMES_DATA];
+	unsigned size(0);
+	if(namesData + sizeof(unsigned) <= namesEnd) {
+		memcpy(&size, namesData, sizeof(unsigned));
+		namesData += sizeof(unsigned);
+	}
+	names.reserve(size);
+	for(unsigned i = 0; i < size; ++i) {
+		if(namesData + sizeof(unsigned) > namesEnd) {
+			throw OSRMException("names index in shared memory is truncated");
+		}
+		//the entries are not aligned
+		unsigned sizeOfString = 0;
+		memcpy(&sizeOfString, namesData, sizeof(unsigned));
+		namesData += sizeof(unsigned);
+		if(namesData + sizeOfString > namesEnd) {
+			throw OSRMException("names index in shared memory is truncated");
+		}
+		names.push_back(std::string(namesData, sizeOfString));
+		namesData += sizeOfString;
+	}
+	INFO("All query data structures attached");
+}
+
 QueryObjectsStorage::~QueryObjectsStorage() {
 	//        delete names;
 	delete graph;
+	delete mappedGraphFile;
 	delete nodeHelpDesk;
+	delete sharedDataRegion;
 }
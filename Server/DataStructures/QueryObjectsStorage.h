@@ -29,6 +29,9 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "../../DataStructures/QueryEdge.h"
 #include "../../DataStructures/StaticGraph.h"
 
+class MemoryMappedFile;
+class SharedMemoryRegion;
+
 struct QueryObjectsStorage {
     typedef StaticGraph<QueryEdge::EdgeData>    QueryGraph;
     typedef QueryGraph::InputEdge               InputEdge;
@@ -37,7 +40,12 @@ struct QueryObjectsStorage {
     std::vector<std::string> names;
     QueryGraph * graph;
     std::string timestamp;
+    std::vector<unsigned> nodeRanks;
     unsigned checkSum;
+    //backs the graph if it is memory mapped, NULL otherwise
+    MemoryMappedFile * mappedGraphFile;
+    //backs graph, help desk and r-tree leaves if the data is in shared memory
+    SharedMemoryRegion * sharedDataRegion;
 
     QueryObjectsStorage(
         const std::string & hsgrPath,
@@ -46,10 +54,20 @@ struct QueryObjectsStorage {
         const std::string & nodesPath,
         const std::string & edgesPath,
         const std::string & namesPath,
-        const std::string & timestampPath
+        const std::string & timestampPath,
+        const std::string & levelPath,
+        const bool memoryMapGraph,
+        const bool memoryMapFileIndex
     );
 
+    //Attaches to a dataset written by osrm-datastore and takes ownership of its region.
+    //Throws OSRMException if the dataset is unusable, the region is freed then.
+    explicit QueryObjectsStorage(SharedMemoryRegion * sharedDataRegion);
+
     ~QueryObjectsStorage();
+
+private:
+    void AttachToSharedData();
 };
 
 #endif /* QUERYOBJECTSSTORAGE_H_ */
@@ -21,8 +21,10 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #ifndef REQUEST_HANDLER_H
 #define REQUEST_HANDLER_H
 
+#include "AccessLog.h"
 #include "APIGrammar.h"
 #include "BasicDatastructures.h"
+#include "../DataStructures/PhaseTimings.h"
 #include "../Library/OSRM.h"
 #include "../Plugins/RouteParameters.h"
 #include "../Util/StringUtil.h"
@@ -30,6 +32,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include <boost/foreach.hpp>
 #include <boost/noncopyable.hpp>
+#include <boost/scoped_ptr.hpp>
 
 #include <algorithm>
 #include <iostream>
@@ -39,29 +42,29 @@ or see http://www.gnu.org/licenses/agpl.txt.
 class RequestHandler : private boost::noncopyable {
 public:
     typedef APIGrammar<std::string::iterator, RouteParameters> APIGrammarParser;
-    explicit RequestHandler() { }
+    explicit RequestHandler() : routing_machine(NULL) { }
 
     void handle_request(const http::Request& req, http::Reply& rep){
         //parse command
         try {
             std::string request(req.uri);
 
-            { //This block logs the current request to std out. should be moved to a logging component
-                time_t ltime;
-                struct tm *Tm;
-
-                ltime=time(NULL);
-                Tm=localtime(&ltime);
-
-                INFO((Tm->tm_mday < 10 ? "0" : "" )  << Tm->tm_mday << "-" << (Tm->tm_mon+1 < 10 ? "0" : "" )  << (Tm->tm_mon+1) << "-" << 1900+Tm->tm_year << " " << (Tm->tm_hour < 10 ? "0" : "" ) << Tm->tm_hour << ":" << (Tm->tm_min < 10 ? "0" : "" ) << Tm->tm_min << ":" << (Tm->tm_sec < 10 ? "0" : "" ) << Tm->tm_sec << " " <<
-                        req.endpoint.to_string() << " " << req.referrer << ( 0 == req.referrer.length() ? "- " :" ") << req.agent << ( 0 == req.agent.length() ? "- " :" ") << req.uri );
+            if(accessLog) {
+                accessLog->Log(req);
             }
 
+            //phases of this request, recorded in the query metrics
+            GetPhaseTimingsOfThread().Clear();
+
             RouteParameters routeParameters;
             APIGrammarParser apiParser(&routeParameters);
 
             std::string::iterator it = request.begin();
-            bool result = boost::spirit::qi::parse(it, request.end(), apiParser);
+            bool result = false;
+            {
+                ScopedPhaseTimer phaseTimer(PhaseTimings::parsing);
+                result = boost::spirit::qi::parse(it, request.end(), apiParser);
+            }
             if (!result || (it != request.end()) ) {
                 rep = http::Reply::stockReply(http::Reply::badRequest);
                 int position = std::distance(request.begin(), it);
@@ -93,8 +96,14 @@ public:
         routing_machine = osrm;
     }
 
+    //takes ownership of the log
+    void RegisterAccessLog(AccessLog * log) {
+        accessLog.reset(log);
+    }
+
 private:
     OSRM * routing_machine;
+    boost::scoped_ptr<AccessLog> accessLog;
 };
 
 #endif // REQUEST_HANDLER_H
@@ -21,6 +21,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #ifndef REQUEST_PARSER_H
 #define REQUEST_PARSER_H
 
+#include <boost/algorithm/string/predicate.hpp>
 #include <boost/logic/tribool.hpp>
 #include <boost/tuple/tuple.hpp>
 #include "BasicDatastructures.h"
@@ -29,8 +30,13 @@ namespace http {
 
 class RequestParser {
 public:
-    RequestParser() : state_(method_start) { }
-    void Reset() { state_ = method_start; }
+    RequestParser() : state_(method_start), versionMajor(0), versionMinor(0) { }
+    void Reset() {
+        state_ = method_start;
+        header.Clear();
+        versionMajor = 0;
+        versionMinor = 0;
+    }
 
     boost::tuple<boost::tribool, char*> Parse(Request& req, char* begin, char* end, CompressionType * compressionType) {
         while (begin != end) {
@@ -117,6 +123,7 @@ private:
             }
         case http_version_major_start:
             if (isDigit(input)) {
+                versionMajor = input - '0';
                 state_ = http_version_major;
                 return boost::indeterminate;
             } else {
@@ -127,12 +134,14 @@ private:
                 state_ = http_version_minor_start;
                 return boost::indeterminate;
             } else if (isDigit(input)) {
+                versionMajor = 10*versionMajor + (input - '0');
                 return boost::indeterminate;
             } else {
                 return false;
             }
         case http_version_minor_start:
             if (isDigit(input)) {
+                versionMinor = input - '0';
                 state_ = http_version_minor;
                 return boost::indeterminate;
             } else {
@@ -143,6 +152,7 @@ private:
                 state_ = expecting_newline_1;
                 return boost::indeterminate;
             } else if (isDigit(input)) {
+                versionMinor = 10*versionMinor + (input - '0');
                 return boost::indeterminate;
             }
             else {
@@ -150,6 +160,8 @@ private:
             }
         case expecting_newline_1:
             if (input == '\n') {
+                /* connections are persistent by default since HTTP/1.1 */
+                req.keepAlive = (1 < versionMajor) || (1 == versionMajor && 1 <= versionMinor);
                 state_ = header_line_start;
                 return boost::indeterminate;
             } else {
@@ -170,6 +182,13 @@ private:
             if("User-Agent" == header.name)
                 req.agent = header.value;
 
+            if(boost::algorithm::iequals(header.name, "Connection")) {
+                if(boost::algorithm::icontains(header.value, "close"))
+                    req.keepAlive = false;
+                else if(boost::algorithm::icontains(header.value, "keep-alive"))
+                    req.keepAlive = true;
+            }
+
             if (input == '\r') {
                 state_ = expecting_newline_3;
                 return boost::indeterminate;
@@ -284,6 +303,8 @@ private:
     } state_;
 
     Header header;
+    int versionMajor;
+    int versionMinor;
 };
 
 } // namespace http
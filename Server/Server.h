@@ -24,48 +24,74 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "Connection.h"
 #include "RequestHandler.h"
 
+#include "../typedefs.h"
+
 #include <boost/asio.hpp>
 #include <boost/bind.hpp>
 #include <boost/noncopyable.hpp>
 #include <boost/shared_ptr.hpp>
 #include <boost/thread.hpp>
 
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
 #include <vector>
 
+#ifdef SO_REUSEPORT
+typedef boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT> reuse_port;
+#endif
+
+/*
+ * Two modes of operation:
+ *  - shared: one io_service and one acceptor, run by all threads
+ *  - thread per core: every thread is pinned to a core and owns an io_service
+ *    and an acceptor of its own. The acceptors share the port via SO_REUSEPORT
+ *    and the kernel spreads incoming connections across them. The query heaps
+ *    are thread-local anyway, so no state is shared between workers.
+ */
 class Server: private boost::noncopyable {
 public:
 	explicit Server(
 		const std::string& address,
 		const std::string& port,
-		unsigned thread_pool_size
+		unsigned thread_pool_size,
+		unsigned keep_alive_timeout,
+		unsigned max_keep_alive_requests,
+		bool thread_per_core = false,
+		const http::CompressionSettings & compression_settings = http::CompressionSettings()
 	) :
 		threadPoolSize(thread_pool_size),
-		acceptor(ioService),
-		newConnection(new http::Connection(ioService, requestHandler)),
+		threadPerCore(thread_per_core),
+		keepAliveTimeout(keep_alive_timeout),
+		maxKeepAliveRequests(max_keep_alive_requests),
+		compressionSettings(compression_settings),
 		requestHandler()
 	{
-		boost::asio::ip::tcp::resolver resolver(ioService);
-		boost::asio::ip::tcp::resolver::query query(address, port);
-		boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(query);
-
-		acceptor.open(endpoint.protocol());
-		acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
-		acceptor.bind(endpoint);
-		acceptor.listen();
-		acceptor.async_accept(
-			newConnection->socket(),
-			boost::bind(
-				&Server::handleAccept,
-				this,
-				boost::asio::placeholders::error
-			)
-		);
+#ifndef SO_REUSEPORT
+		if(threadPerCore) {
+			WARN("SO_REUSEPORT not supported by this platform, falling back to a shared acceptor");
+			threadPerCore = false;
+		}
+#endif
+		const unsigned numberOfListeners = (threadPerCore ? threadPoolSize : 1);
+		for(unsigned i = 0; i < numberOfListeners; ++i) {
+			listeners.push_back(boost::shared_ptr<Listener>(new Listener(*this)));
+			listeners.back()->Listen(address, port, threadPerCore);
+		}
 	}
 
 	void Run() {
 		std::vector<boost::shared_ptr<boost::thread> > threads;
 		for (unsigned i = 0; i < threadPoolSize; ++i) {
-			boost::shared_ptr<boost::thread> thread(new boost::thread(boost::bind(&boost::asio::io_service::run, &ioService)));
+			boost::shared_ptr<boost::thread> thread;
+			if(threadPerCore) {
+				thread.reset(new boost::thread(boost::bind(&Server::runPinned, listeners[i], i)));
+			} else {
+				thread.reset(new boost::thread(boost::bind(&boost::asio::io_service::run, &listeners[0]->ioService)));
+			}
 			threads.push_back(thread);
 		}
 		for (unsigned i = 0; i < threads.size(); ++i)
@@ -73,7 +99,9 @@ public:
 	}
 
 	void Stop() {
-		ioService.stop();
+		for(unsigned i = 0; i < listeners.size(); ++i) {
+			listeners[i]->ioService.stop();
+		}
 	}
 
 	RequestHandler & GetRequestHandlerPtr() {
@@ -81,28 +109,74 @@ public:
 	}
 
 private:
-	void handleAccept(const boost::system::error_code& e) {
-		if (!e) {
-			newConnection->start();
+	//io_service and acceptor, the connections it accepts run on its io_service
+	struct Listener : private boost::noncopyable {
+		Listener(Server & s) : server(s), acceptor(ioService) { }
+
+		void Listen(const std::string& address, const std::string& port, const bool reusePort) {
+			boost::asio::ip::tcp::resolver resolver(ioService);
+			boost::asio::ip::tcp::resolver::query query(address, port);
+			boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve(query);
+
+			acceptor.open(endpoint.protocol());
+			acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
+#ifdef SO_REUSEPORT
+			if(reusePort) {
+				acceptor.set_option(reuse_port(true));
+			}
+#endif
+			acceptor.bind(endpoint);
+			acceptor.listen();
+			startAccept();
+		}
+
+		void startAccept() {
 			newConnection.reset(
-				new http::Connection(ioService, requestHandler)
+				new http::Connection(ioService, server.requestHandler, server.keepAliveTimeout, server.maxKeepAliveRequests, server.compressionSettings)
 			);
 			acceptor.async_accept(
 				newConnection->socket(),
 				boost::bind(
-					&Server::handleAccept,
+					&Listener::handleAccept,
 					this,
 					boost::asio::placeholders::error
 				)
 			);
 		}
+
+		void handleAccept(const boost::system::error_code& e) {
+			if (!e) {
+				newConnection->start();
+				startAccept();
+			}
+		}
+
+		Server & server;
+		boost::asio::io_service ioService;
+		boost::asio::ip::tcp::acceptor acceptor;
+		boost::shared_ptr<http::Connection> newConnection;
+	};
+
+	static void runPinned(boost::shared_ptr<Listener> listener, const unsigned threadIndex) {
+#ifdef __linux__
+		const unsigned numberOfCores = std::max(1u, boost::thread::hardware_concurrency());
+		cpu_set_t cpuSet;
+		CPU_ZERO(&cpuSet);
+		CPU_SET(threadIndex % numberOfCores, &cpuSet);
+		if(0 != pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuSet)) {
+			WARN("could not pin server thread " << threadIndex << " to a core");
+		}
+#endif
+		listener->ioService.run();
 	}
 
 	unsigned threadPoolSize;
-	boost::asio::io_service ioService;
-	boost::asio::ip::tcp::acceptor acceptor;
-	boost::shared_ptr<http::Connection> newConnection;
+	bool threadPerCore;
+	unsigned keepAliveTimeout;
+	unsigned maxKeepAliveRequests;
+	http::CompressionSettings compressionSettings;
 	RequestHandler requestHandler;
+	std::vector<boost::shared_ptr<Listener> > listeners;
 };
 
 #endif // SERVER_H
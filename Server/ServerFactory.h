@@ -36,6 +36,8 @@ or see http://www.gnu.org/licenses/agpl.txt.
 
 #include <zlib.h>
 
+#include <algorithm>
+
 struct ServerFactory {
 	static Server * CreateServer(BaseConfiguration& serverConfig) {
 
@@ -68,8 +70,40 @@ struct ServerFactory {
 		if(stringToInt(serverConfig.GetParameter("Threads")) != 0 && stringToInt(serverConfig.GetParameter("Threads")) <= threads)
 			threads = stringToInt( serverConfig.GetParameter("Threads") );
 
+		//idle seconds before a persistent connection is closed
+		int keepAliveTimeout = 5;
+		if(stringToInt(serverConfig.GetParameter("KeepAliveTimeout")) > 0)
+			keepAliveTimeout = stringToInt(serverConfig.GetParameter("KeepAliveTimeout"));
+
+		//requests per connection, 1 disables persistent connections
+		int keepAliveRequests = 100;
+		if(stringToInt(serverConfig.GetParameter("KeepAliveRequests")) > 0)
+			keepAliveRequests = stringToInt(serverConfig.GetParameter("KeepAliveRequests"));
+
+		//one pinned thread with its own acceptor per core instead of a shared pool
+		const bool threadPerCore = ("yes" == serverConfig.GetParameter("ThreadPerCore"));
+
+		//zlib level of compressed replies and the size below which replies stay uncompressed
+		http::CompressionSettings compressionSettings;
+		if("" != serverConfig.GetParameter("CompressionLevel"))
+			compressionSettings.level = std::min(9, std::max(0, stringToInt(serverConfig.GetParameter("CompressionLevel"))));
+		compressionSettings.minimumSize = std::max(0, stringToInt(serverConfig.GetParameter("CompressionMinimumSize")));
+
 		std::cout << "[server] http 1.1 compression handled by zlib version " << zlibVersion() << std::endl;
-		Server * server = new Server(serverConfig.GetParameter("IP"), serverConfig.GetParameter("Port"), threads);
+		Server * server = new Server(serverConfig.GetParameter("IP"), serverConfig.GetParameter("Port"), threads, keepAliveTimeout, keepAliveRequests, threadPerCore, compressionSettings);
+
+		//access log, stdout if no file is given
+		const int accessLogSampleRate = std::max(1, stringToInt(serverConfig.GetParameter("AccessLogSampleRate")));
+		const int accessLogMaxSize = std::max(0, stringToInt(serverConfig.GetParameter("AccessLogMaxSize")));
+		const int accessLogRotations = std::max(0, stringToInt(serverConfig.GetParameter("AccessLogRotations")));
+		server->GetRequestHandlerPtr().RegisterAccessLog(
+			new AccessLog(
+				serverConfig.GetParameter("AccessLog"),
+				accessLogSampleRate,
+				uint64_t(accessLogMaxSize)*1024*1024,
+				accessLogRotations
+			)
+		);
 		return server;
 	}
 
@@ -0,0 +1,212 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+*/
+
+#include "../DataStructures/PhaseTimings.h"
+#include "../Library/OSRM.h"
+#include "../Server/APIGrammar.h"
+#include "../Util/StringUtil.h"
+#include "../typedefs.h"
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Replays a workload against an in-process routing machine. Each line of the
+ * workload is either a request URI as sent to osrm-routed, e.g.
+ *   /viaroute?loc=52.5,13.4&loc=52.6,13.5
+ * or a pair of coordinates "lat1 lon1 lat2 lon2" that is routed with the
+ * default parameters of viaroute. Lines starting with '#' are skipped.
+ */
+
+typedef APIGrammar<std::string::iterator, RouteParameters> APIGrammarParser;
+
+//per query: time spent in each phase plus the total latency
+struct QuerySample {
+    double seconds[PhaseTimings::numberOfPhases+1];
+};
+
+static const unsigned TOTAL = PhaseTimings::numberOfPhases;
+
+bool ParseWorkloadLine(std::string line, RouteParameters & route_parameters) {
+    if('/' == line[0]) {
+        APIGrammarParser api_parser(&route_parameters);
+        std::string::iterator it = line.begin();
+        const bool result = boost::spirit::qi::parse(it, line.end(), api_parser);
+        return result && (it == line.end());
+    }
+
+    std::replace(line.begin(), line.end(), ',', ' ');
+    std::istringstream line_stream(line);
+    double lat1, lon1, lat2, lon2;
+    if(!(line_stream >> lat1 >> lon1 >> lat2 >> lon2)) {
+        return false;
+    }
+    route_parameters.service = "viaroute";
+    route_parameters.outputFormat = "json";
+    route_parameters.coordinates.push_back(_Coordinate(lat1*100000, lon1*100000));
+    route_parameters.coordinates.push_back(_Coordinate(lat2*100000, lon2*100000));
+    return true;
+}
+
+void RunQueries(
+    OSRM & routing_machine,
+    const std::vector<RouteParameters> & workload,
+    const unsigned first_query,
+    const unsigned stride,
+    std::vector<QuerySample> & samples,
+    unsigned & failed_queries
+) {
+    http::Reply reply;
+    PhaseTimings & phase_timings = GetPhaseTimingsOfThread();
+    for(unsigned i = first_query; i < workload.size(); i += stride) {
+        RouteParameters route_parameters = workload[i];
+        reply.status = http::Reply::ok;
+        reply.headers.clear();
+        reply.content.clear();
+        phase_timings.Clear();
+
+        const double start = get_timestamp();
+        routing_machine.RunQuery(route_parameters, reply);
+        const double end = get_timestamp();
+
+        if(http::Reply::ok != reply.status) {
+            ++failed_queries;
+        }
+        QuerySample sample;
+        std::copy(phase_timings.seconds, phase_timings.seconds+PhaseTimings::numberOfPhases, sample.seconds);
+        sample.seconds[TOTAL] = end - start;
+        samples.push_back(sample);
+    }
+}
+
+//nearest-rank percentile of a sorted vector
+double Percentile(const std::vector<double> & sorted_values, const double percent) {
+    const unsigned rank = std::max(1., std::ceil(percent/100.*sorted_values.size()));
+    return sorted_values[rank-1];
+}
+
+int main (int argc, char * argv[]) {
+    if(argc < 2) {
+        ERR("usage: \n" << argv[0] << " <requests file> [<number of threads>] [<server.ini>]");
+    }
+    unsigned number_of_threads = 1;
+    if(argc > 2 && 0 < stringToInt(argv[2])) {
+        number_of_threads = stringToInt(argv[2]);
+    }
+    const char * server_ini_path = (argc > 3 ? argv[3] : "server.ini");
+
+    INFO("reading workload from " << argv[1]);
+    std::ifstream workload_stream(argv[1]);
+    if(!workload_stream) {
+        ERR(argv[1] << " not found");
+    }
+    std::vector<RouteParameters> workload;
+    std::string line;
+    unsigned line_number = 0;
+    while(std::getline(workload_stream, line)) {
+        ++line_number;
+        if(line.empty() || '#' == line[0]) {
+            continue;
+        }
+        RouteParameters route_parameters;
+        if(!ParseWorkloadLine(line, route_parameters)) {
+            WARN("skipping malformed line " << line_number << ": " << line);
+            continue;
+        }
+        workload.push_back(route_parameters);
+    }
+    workload_stream.close();
+    if(workload.empty()) {
+        ERR("workload contains no queries");
+    }
+
+    OSRM routing_machine(server_ini_path);
+
+    INFO("replaying " << workload.size() << " queries on " << number_of_threads << " threads");
+    std::vector<std::vector<QuerySample> > samples_of_thread(number_of_threads);
+    std::vector<unsigned> failed_queries_of_thread(number_of_threads, 0);
+    const double start = get_timestamp();
+    boost::thread_group threads;
+    for(unsigned i = 0; i < number_of_threads; ++i) {
+        threads.create_thread(
+            boost::bind(
+                RunQueries,
+                boost::ref(routing_machine),
+                boost::cref(workload),
+                i,
+                number_of_threads,
+                boost::ref(samples_of_thread[i]),
+                boost::ref(failed_queries_of_thread[i])
+            )
+        );
+    }
+    threads.join_all();
+    const double wall_time = get_timestamp() - start;
+
+    //collect the latencies of each phase over all threads
+    std::vector<std::vector<double> > latencies(TOTAL+1);
+    unsigned failed_queries = 0;
+    for(unsigned i = 0; i < number_of_threads; ++i) {
+        failed_queries += failed_queries_of_thread[i];
+        BOOST_FOREACH(const QuerySample & sample, samples_of_thread[i]) {
+            for(unsigned phase = 0; phase <= TOTAL; ++phase) {
+                latencies[phase].push_back(sample.seconds[phase]);
+            }
+        }
+    }
+
+    std::cout << "queries:    " << workload.size() << " (" << failed_queries << " failed)" << std::endl;
+    std::cout << "threads:    " << number_of_threads << std::endl;
+    std::cout << "wall time:  " << std::fixed << std::setprecision(3) << wall_time << " s" << std::endl;
+    std::cout << "throughput: " << std::fixed << std::setprecision(1) << (workload.size()/wall_time) << " queries/s" << std::endl;
+    std::cout << std::endl;
+
+    const char * phase_names[] = { "parsing", "phantom lookup", "search", "unpacking", "description", "total" };
+    std::cout << std::setw(16) << std::left << "latency [ms]" << std::right;
+    std::cout << std::setw(10) << "mean" << std::setw(10) << "p50" << std::setw(10) << "p90" << std::setw(10) << "p99" << std::setw(10) << "p99.9" << std::endl;
+    for(unsigned phase = 0; phase <= TOTAL; ++phase) {
+        std::vector<double> & values = latencies[phase];
+        std::sort(values.begin(), values.end());
+        double sum = 0.;
+        BOOST_FOREACH(const double value, values) {
+            sum += value;
+        }
+        std::cout << std::setw(16) << std::left << phase_names[phase] << std::right << std::fixed << std::setprecision(3);
+        std::cout << std::setw(10) << 1000.*sum/values.size();
+        std::cout << std::setw(10) << 1000.*Percentile(values, 50.);
+        std::cout << std::setw(10) << 1000.*Percentile(values, 90.);
+        std::cout << std::setw(10) << 1000.*Percentile(values, 99.);
+        std::cout << std::setw(10) << 1000.*Percentile(values, 99.9);
+        std::cout << std::endl;
+    }
+    return 0;
+}
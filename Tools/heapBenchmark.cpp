@@ -0,0 +1,192 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+*/
+
+#include "../DataStructures/BinaryHeap.h"
+#include "../DataStructures/RadixHeap.h"
+#include "../DataStructures/TimingUtil.h"
+#include "../DataStructures/XORFastHashStorage.h"
+#include "../Util/StringUtil.h"
+#include "../typedefs.h"
+
+#include <climits>
+#include <cstdlib>
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+/*
+ * Compares the heaps available to the witness searches of the contractor. The searches
+ * run on a grid with random edge weights and are bounded like those of the contractor:
+ * from one neighbour of a node to its other neighbours, avoiding the node itself and
+ * settling at most a fixed number of nodes.
+ */
+
+struct HeapData {
+    short hop;
+    bool target;
+    HeapData() : hop(0), target(false) {}
+    HeapData( short h, bool t ) : hop(h), target(t) {}
+};
+
+typedef BinaryHeap< NodeID, NodeID, int, HeapData, XORFastHashStorage<NodeID, NodeID> > WitnessBinaryHeap;
+typedef RadixHeap< NodeID, NodeID, int, HeapData, XORFastHashStorage<NodeID, NodeID> > WitnessRadixHeap;
+
+struct Graph {
+    std::vector<unsigned> firstEdge;
+    std::vector<NodeID> target;
+    std::vector<int> weight;
+};
+
+struct WitnessSearch {
+    NodeID middle;
+    NodeID source;
+    int sourceWeight;
+    std::vector<NodeID> targets;
+    std::vector<int> targetWeights;
+};
+
+void BuildGrid(const unsigned side, Graph & graph) {
+    graph.firstEdge.push_back(0);
+    for(unsigned row = 0; row < side; ++row) {
+        for(unsigned column = 0; column < side; ++column) {
+            const NodeID node = row*side + column;
+            if(0 < row)        { graph.target.push_back(node - side); }
+            if(row+1 < side)   { graph.target.push_back(node + side); }
+            if(0 < column)     { graph.target.push_back(node - 1); }
+            if(column+1 < side){ graph.target.push_back(node + 1); }
+            graph.firstEdge.push_back(graph.target.size());
+        }
+    }
+    //road segments of a few meters up to some kilometers, in deciseconds
+    for(unsigned i = 0; i < graph.target.size(); ++i) {
+        graph.weight.push_back(10 + rand()%2000);
+    }
+}
+
+template<class HeapT>
+void Search(const Graph & graph, const WitnessSearch & search, const int maxNodes, HeapT & heap, std::vector<int> & distances) {
+    heap.Clear();
+    heap.Insert(search.source, 0, HeapData());
+    int maxDistance = 0;
+    unsigned numTargets = 0;
+    for(unsigned i = 0; i < search.targets.size(); ++i) {
+        maxDistance = std::max(maxDistance, search.sourceWeight + search.targetWeights[i]);
+        if(!heap.WasInserted(search.targets[i])) {
+            heap.Insert(search.targets[i], INT_MAX, HeapData(0, true));
+            ++numTargets;
+        }
+    }
+
+    int nodes = 0;
+    unsigned targetsFound = 0;
+    while(heap.Size() > 0) {
+        const NodeID node = heap.DeleteMin();
+        const int distance = heap.GetKey(node);
+        const short currentHop = heap.GetData(node).hop+1;
+        if(++nodes > maxNodes || distance > maxDistance) {
+            break;
+        }
+        if(heap.GetData(node).target && ++targetsFound >= numTargets) {
+            break;
+        }
+        for(unsigned edge = graph.firstEdge[node]; edge < graph.firstEdge[node+1]; ++edge) {
+            const NodeID to = graph.target[edge];
+            if(search.middle == to) {
+                continue;
+            }
+            const int toDistance = distance + graph.weight[edge];
+            if(!heap.WasInserted(to)) {
+                heap.Insert(to, toDistance, HeapData(currentHop, false));
+            } else if(toDistance < heap.GetKey(to)) {
+                heap.DecreaseKey(to, toDistance);
+                heap.GetData(to).hop = currentHop;
+            }
+        }
+    }
+
+    for(unsigned i = 0; i < search.targets.size(); ++i) {
+        distances.push_back(heap.GetKey(search.targets[i]));
+    }
+}
+
+template<class HeapT>
+double Run(const Graph & graph, const std::vector<WitnessSearch> & searches, const int maxNodes, std::vector<int> & distances) {
+    HeapT heap(graph.firstEdge.size()-1);
+    distances.clear();
+    const double startTime = get_timestamp();
+    for(unsigned i = 0; i < searches.size(); ++i) {
+        Search(graph, searches[i], maxNodes, heap, distances);
+    }
+    return get_timestamp() - startTime;
+}
+
+int main (int argc, char * argv[]) {
+    const unsigned side = (argc > 1 && 0 < stringToInt(argv[1])) ? stringToInt(argv[1]) : 1000;
+    const unsigned numberOfSearches = (argc > 2 && 0 < stringToInt(argv[2])) ? stringToInt(argv[2]) : 200000;
+    if(side < 3) {
+        ERR("usage: \n" << argv[0] << " [<grid side length>] [<number of searches>]");
+    }
+
+    srand(1337);
+    Graph graph;
+    BuildGrid(side, graph);
+    INFO("grid with " << (graph.firstEdge.size()-1) << " nodes and " << graph.target.size() << " edges");
+
+    std::vector<WitnessSearch> searches(numberOfSearches);
+    for(unsigned i = 0; i < numberOfSearches; ++i) {
+        WitnessSearch & search = searches[i];
+        search.middle = rand()%(graph.firstEdge.size()-1);
+        const unsigned begin = graph.firstEdge[search.middle];
+        const unsigned end = graph.firstEdge[search.middle+1];
+        const unsigned sourceEdge = begin + rand()%(end-begin);
+        search.source = graph.target[sourceEdge];
+        search.sourceWeight = graph.weight[sourceEdge];
+        for(unsigned edge = begin; edge < end; ++edge) {
+            if(edge != sourceEdge) {
+                search.targets.push_back(graph.target[edge]);
+                search.targetWeights.push_back(graph.weight[edge]);
+            }
+        }
+    }
+
+    //the contractor settles at most 1000 nodes while simulating a contraction and 2000 while contracting
+    const int maxNodes[] = { 1000, 2000 };
+    std::cout << std::setw(12) << std::left << "max nodes" << std::right;
+    std::cout << std::setw(14) << "binary [s]" << std::setw(14) << "radix [s]" << std::setw(10) << "speedup" << std::endl;
+    for(unsigned i = 0; i < sizeof(maxNodes)/sizeof(int); ++i) {
+        std::vector<int> binaryDistances, radixDistances;
+        const double binaryTime = Run<WitnessBinaryHeap>(graph, searches, maxNodes[i], binaryDistances);
+        const double radixTime = Run<WitnessRadixHeap>(graph, searches, maxNodes[i], radixDistances);
+        //ties at the node limit may be broken differently, which can only leave a witness unfound
+        unsigned differentDistances = 0;
+        for(unsigned j = 0; j < binaryDistances.size(); ++j) {
+            differentDistances += (binaryDistances[j] != radixDistances[j]);
+        }
+        if(0 < differentDistances) {
+            WARN(differentDistances << " of " << binaryDistances.size() << " witness distances differ for at most " << maxNodes[i] << " settled nodes");
+        }
+        std::cout << std::setw(12) << std::left << maxNodes[i] << std::right << std::fixed << std::setprecision(3);
+        std::cout << std::setw(14) << binaryTime << std::setw(14) << radixTime;
+        std::cout << std::setw(9) << std::setprecision(2) << (binaryTime/radixTime) << "x" << std::endl;
+    }
+    return 0;
+}
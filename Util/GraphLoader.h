@@ -25,6 +25,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "../DataStructures/ImportEdge.h"
 #include "../DataStructures/NodeCoords.h"
 #include "../DataStructures/Restriction.h"
+#include "../Util/OSRMException.h"
 #include "../Util/UUID.h"
 #include "../typedefs.h"
 
@@ -382,6 +383,37 @@ NodeID readDDSGGraphFromStream(std::istream &in, std::vector<EdgeT>& edgeList, s
     return numberOfNodes;
 }
 
+/*
+ * Layout of an .hsgr file:
+ *  UUID | checksum | number of nodes n | number of edges m | padding
+ *  n+2 node entries, the last two repeat m | padding
+ *  m edge entries
+ * The node and the edge array start at page boundaries s.t. the file can be
+ * memory mapped and used in place.
+ */
+static const unsigned HSGR_PAGE_SIZE = 4096;
+
+inline std::size_t alignToHSGRPage(const std::size_t offset) {
+    return ((offset + HSGR_PAGE_SIZE - 1) / HSGR_PAGE_SIZE) * HSGR_PAGE_SIZE;
+}
+
+inline std::size_t getHSGRNodeArrayOffset() {
+    return alignToHSGRPage(sizeof(UUID) + 3*sizeof(unsigned));
+}
+
+template<typename NodeT>
+inline std::size_t getHSGREdgeArrayOffset(const unsigned number_of_nodes) {
+    return alignToHSGRPage(getHSGRNodeArrayOffset() + (number_of_nodes+2)*sizeof(NodeT));
+}
+
+inline void padHSGRStreamToPage(std::ostream &hsgr_output_stream) {
+    const std::size_t offset = hsgr_output_stream.tellp();
+    const std::vector<char> padding(alignToHSGRPage(offset) - offset, 0);
+    if(!padding.empty()) {
+        hsgr_output_stream.write(&padding[0], padding.size());
+    }
+}
+
 template<typename NodeT, typename EdgeT>
 unsigned readHSGRFromStream(
     std::istream &hsgr_input_stream,
@@ -399,21 +431,21 @@ unsigned readHSGRFromStream(
     }
 
     unsigned number_of_nodes = 0;
+    unsigned number_of_edges = 0;
     hsgr_input_stream.read((char*) check_sum, sizeof(unsigned));
     hsgr_input_stream.read((char*) & number_of_nodes, sizeof(unsigned));
+    hsgr_input_stream.read((char*) & number_of_edges, sizeof(unsigned));
+
+    //the second sentinel entry is not read, StaticGraph appends it itself
     node_list.resize(number_of_nodes + 1);
+    hsgr_input_stream.seekg(getHSGRNodeArrayOffset());
     hsgr_input_stream.read(
         (char*) &(node_list[0]),
-        number_of_nodes*sizeof(NodeT)
-    );
-
-    unsigned number_of_edges = 0;
-    hsgr_input_stream.read(
-        (char*) &number_of_edges,
-        sizeof(unsigned)
+        (number_of_nodes+1)*sizeof(NodeT)
     );
 
     edge_list.resize(number_of_edges);
+    hsgr_input_stream.seekg(getHSGREdgeArrayOffset<NodeT>(number_of_nodes));
     hsgr_input_stream.read(
         (char*) &(edge_list[0]),
         number_of_edges*sizeof(EdgeT)
@@ -422,4 +454,41 @@ unsigned readHSGRFromStream(
     return number_of_nodes;
 }
 
+//Points node and edge arrays into a memory mapped .hsgr without copying.
+//Throws OSRMException if the data is truncated.
+template<typename NodeT, typename EdgeT>
+unsigned mapHSGRFromMemory(
+    const char * hsgr_data,
+    const std::size_t hsgr_size,
+    const NodeT ** node_array,
+    const EdgeT ** edge_array,
+    unsigned * number_of_edges,
+    unsigned * check_sum
+) {
+    if(getHSGRNodeArrayOffset() > hsgr_size) {
+        throw OSRMException(".hsgr data is truncated");
+    }
+    UUID uuid_orig;
+    if( !reinterpret_cast<const UUID *>(hsgr_data)->TestGraphUtil(uuid_orig) ) {
+        WARN(
+            ".hsgr was prepared with different build.\n"
+            "Reprocess to get rid of this warning."
+            )
+    }
+
+    const unsigned * header = reinterpret_cast<const unsigned *>(hsgr_data + sizeof(UUID));
+    *check_sum = header[0];
+    const unsigned number_of_nodes = header[1];
+    *number_of_edges = header[2];
+
+    const std::size_t edge_array_offset = getHSGREdgeArrayOffset<NodeT>(number_of_nodes);
+    if(edge_array_offset + (*number_of_edges)*sizeof(EdgeT) > hsgr_size) {
+        throw OSRMException(".hsgr data is truncated");
+    }
+    *node_array = reinterpret_cast<const NodeT *>(hsgr_data + getHSGRNodeArrayOffset());
+    *edge_array = reinterpret_cast<const EdgeT *>(hsgr_data + edge_array_offset);
+
+    return number_of_nodes;
+}
+
 #endif // GRAPHLOADER_H
@@ -0,0 +1,83 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef MEMORYMAPPEDFILE_H_
+#define MEMORYMAPPEDFILE_H_
+
+#include "../typedefs.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+//Maps a whole file read-only into the address space. The pages are shared
+//with all other processes that map the same file.
+class MemoryMappedFile : boost::noncopyable {
+public:
+    MemoryMappedFile(const std::string & filename) : address(MAP_FAILED), length(0) {
+        const int fileDescriptor = open(filename.c_str(), O_RDONLY);
+        if(-1 == fileDescriptor) {
+            ERR(filename << " not found");
+        }
+        struct stat fileStatus;
+        if(-1 == fstat(fileDescriptor, &fileStatus)) {
+            close(fileDescriptor);
+            ERR("could not determine size of " << filename);
+        }
+        length = fileStatus.st_size;
+        if(0 < length) {
+            address = mmap(NULL, length, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+        }
+        close(fileDescriptor);
+        if(MAP_FAILED == address) {
+            ERR("could not map " << filename << " into memory");
+        }
+    }
+
+    ~MemoryMappedFile() {
+        if(MAP_FAILED != address) {
+            munmap(address, length);
+        }
+    }
+
+    inline const char * GetData() const {
+        return static_cast<const char *>(address);
+    }
+
+    inline std::size_t GetSize() const {
+        return length;
+    }
+
+    //hint the kernel that accesses do not benefit from read-ahead
+    inline void AdviseRandomAccess() const {
+        madvise(address, length, MADV_RANDOM);
+    }
+
+private:
+    void * address;
+    std::size_t length;
+};
+
+#endif /* MEMORYMAPPEDFILE_H_ */
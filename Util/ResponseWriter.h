@@ -0,0 +1,78 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef RESPONSEWRITER_H_
+#define RESPONSEWRITER_H_
+
+#include "StringUtil.h"
+
+#include <string>
+
+/*
+ * Appends the parts of a response to its content. Numbers are formatted on
+ * the stack instead of going through temporary strings. The content of a
+ * reply keeps its capacity over the requests of a connection, so a response
+ * of similar size is written without reallocating.
+ */
+class ResponseWriter {
+public:
+    explicit ResponseWriter(std::string & o) : output(o) { }
+
+    inline void Write(const char * text) {
+        output.append(text);
+    }
+
+    inline void Write(const std::string & text) {
+        output.append(text);
+    }
+
+    inline void Write(const char character) {
+        output.push_back(character);
+    }
+
+    inline void WriteInt(const int value) {
+        char buffer[12];
+        char * end = buffer+sizeof(buffer);
+        char * begin = end;
+        //negate as unsigned, so INT_MIN does not overflow
+        unsigned magnitude = (value < 0 ? 0u - static_cast<unsigned>(value) : static_cast<unsigned>(value));
+        do {
+            *(--begin) = '0' + (magnitude % 10);
+            magnitude /= 10;
+        } while(0 != magnitude);
+        if(value < 0) {
+            *(--begin) = '-';
+        }
+        output.append(begin, end);
+    }
+
+    //fixed point coordinate with five decimals, e.g. 5252345 -> 52.52345
+    inline void WriteLatLon(const int value) {
+        char buffer[11];
+        buffer[10] = 0;
+        char * begin = printInt< 10, 5 >( buffer, value );
+        output.append(begin, buffer+10);
+    }
+
+private:
+    std::string & output;
+};
+
+#endif /* RESPONSEWRITER_H_ */
@@ -0,0 +1,122 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#ifndef SHAREDMEMORY_H_
+#define SHAREDMEMORY_H_
+
+#include "OSRMException.h"
+#include "../typedefs.h"
+
+#include <boost/noncopyable.hpp>
+
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <string>
+
+//Named POSIX shared memory region that is mapped as a whole. A region
+//outlives the process that created it until it is removed by name, and
+//stays valid for every process that has it mapped even after removal.
+class SharedMemoryRegion : boost::noncopyable {
+public:
+    //Creates a new, zero-filled region. Fails if the name is already taken.
+    static SharedMemoryRegion * Create(const std::string & name, const std::size_t size) {
+        const int fileDescriptor = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+        if(-1 == fileDescriptor) {
+            ERR("could not create shared memory region " << name);
+        }
+        if(-1 == ftruncate(fileDescriptor, size)) {
+            close(fileDescriptor);
+            shm_unlink(name.c_str());
+            ERR("could not allocate " << size << " bytes of shared memory for " << name);
+        }
+        return new SharedMemoryRegion(name, fileDescriptor, size, true);
+    }
+
+    //Attaches to an existing region, returns NULL if there is none of that name.
+    //Throws OSRMException on any other failure, s.t. a running server keeps its data.
+    static SharedMemoryRegion * Attach(const std::string & name, const bool writable = false) {
+        const int fileDescriptor = shm_open(name.c_str(), (writable ? O_RDWR : O_RDONLY), 0);
+        if(-1 == fileDescriptor) {
+            if(ENOENT == errno) {
+                return NULL;
+            }
+            throw OSRMException("could not open shared memory region " + name);
+        }
+        struct stat regionStatus;
+        if(-1 == fstat(fileDescriptor, &regionStatus)) {
+            close(fileDescriptor);
+            throw OSRMException("could not determine size of shared memory region " + name);
+        }
+        return new SharedMemoryRegion(name, fileDescriptor, regionStatus.st_size, writable);
+    }
+
+    //Removes the name, the memory is freed once the last process unmaps it
+    static void Remove(const std::string & name) {
+        shm_unlink(name.c_str());
+    }
+
+    ~SharedMemoryRegion() {
+        if(MAP_FAILED != address) {
+            munmap(address, length);
+        }
+    }
+
+    inline char * GetData() {
+        return static_cast<char *>(address);
+    }
+
+    inline const char * GetData() const {
+        return static_cast<const char *>(address);
+    }
+
+    inline std::size_t GetSize() const {
+        return length;
+    }
+
+    inline const std::string & GetName() const {
+        return name;
+    }
+
+private:
+    SharedMemoryRegion(
+        const std::string & n,
+        const int fileDescriptor,
+        const std::size_t size,
+        const bool writable
+    ) : name(n), address(MAP_FAILED), length(size) {
+        if(0 < length) {
+            address = mmap(NULL, length, (writable ? PROT_READ | PROT_WRITE : PROT_READ), MAP_SHARED, fileDescriptor, 0);
+        }
+        close(fileDescriptor);
+        if(MAP_FAILED == address) {
+            throw OSRMException("could not map shared memory region " + name);
+        }
+    }
+
+    const std::string name;
+    void * address;
+    std::size_t length;
+};
+
+#endif /* SHAREDMEMORY_H_ */
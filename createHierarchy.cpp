@@ -21,11 +21,13 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "Algorithms/IteratorBasedCRC32.h"
 #include "Contractor/Contractor.h"
 #include "Contractor/EdgeBasedGraphFactory.h"
+#include "Contractor/NodeRenumbering.h"
 #include "DataStructures/BinaryHeap.h"
 #include "DataStructures/DeallocatingVector.h"
 #include "DataStructures/QueryEdge.h"
 #include "DataStructures/StaticGraph.h"
 #include "DataStructures/StaticRTree.h"
+#include "DataStructures/StaticRTreeBuilder.h"
 #include "Util/BaseConfiguration.h"
 #include "Util/GraphLoader.h"
 #include "Util/InputFileUtil.h"
@@ -34,6 +36,8 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include "Util/StringUtil.h"
 #include "typedefs.h"
 
+#include <boost/crc.hpp>
+#include <boost/filesystem.hpp>
 #include <boost/foreach.hpp>
 
 #include <luabind/luabind.hpp>
@@ -42,6 +46,7 @@ or see http://www.gnu.org/licenses/agpl.txt.
 #include <istream>
 #include <iostream>
 #include <cstring>
+#include <ctime>
 #include <string>
 #include <vector>
 
@@ -56,19 +61,113 @@ std::vector<NodeID> bollardNodes;
 std::vector<NodeID> trafficLightNodes;
 std::vector<ImportEdge> edgeList;
 
+//checksum of the edge-based graph without its weights. A contraction order can be reused as long as it matches.
+unsigned computeTopologyChecksum(const NodeID numberOfNodes, DeallocatingVector<EdgeBasedEdge> & edges) {
+    boost::crc_32_type crc32;
+    crc32.process_bytes(&numberOfNodes, sizeof(NodeID));
+    for(unsigned i = 0; i < edges.size(); ++i) {
+        const EdgeBasedEdge & edge = edges[i];
+        const unsigned topology[3] = { edge.source(), edge.target(), (edge.isForward() ? 1u : 0u) | (edge.isBackward() ? 2u : 0u) };
+        crc32.process_bytes(topology, sizeof(topology));
+    }
+    return crc32.checksum();
+}
+
+//stamp of the input files. --resume only continues from checkpoints with the same stamp.
+unsigned computeInputStamp(const std::vector<std::string> & inputFiles) {
+    boost::crc_32_type crc32;
+    BOOST_FOREACH(const std::string & inputFile, inputFiles) {
+        crc32.process_bytes(inputFile.c_str(), inputFile.size());
+        if(boost::filesystem::exists(inputFile)) {
+            const uint64_t fileSize = boost::filesystem::file_size(inputFile);
+            const std::time_t lastWriteTime = boost::filesystem::last_write_time(inputFile);
+            crc32.process_bytes(&fileSize, sizeof(uint64_t));
+            crc32.process_bytes(&lastWriteTime, sizeof(std::time_t));
+        }
+    }
+    return crc32.checksum();
+}
+
+//checkpoints are written under a temporary name and only renamed once they are complete
+bool openCheckpoint(const std::string & path, const unsigned inputStamp, std::ifstream & in) {
+    in.open(path.c_str(), std::ios::binary);
+    unsigned stamp = 0;
+    in.read((char*)&stamp, sizeof(unsigned));
+    return in.good() && inputStamp == stamp;
+}
+
+void createCheckpoint(const std::string & path, const unsigned inputStamp, std::ofstream & out) {
+    const std::string incompletePath = path + ".tmp";
+    out.open(incompletePath.c_str(), std::ios::binary);
+    out.write((char*)&inputStamp, sizeof(unsigned));
+}
+
+void commitCheckpoint(const std::string & path, std::ofstream & out) {
+    out.close();
+    if(out.fail()) {
+        WARN("could not write checkpoint " << path);
+        return;
+    }
+    boost::filesystem::rename(path + ".tmp", path);
+}
+
+template<class VectorT>
+void writeCheckpointVector(std::ofstream & out, VectorT & vector) {
+    unsigned size = vector.size();
+    out.write((char*)&size, sizeof(unsigned));
+    for(unsigned i = 0; i < size; ++i) {
+        out.write((char*)&vector[i], sizeof(typename VectorT::value_type));
+    }
+}
+
+template<class VectorT>
+void readCheckpointVector(std::ifstream & in, VectorT & vector) {
+    unsigned size = 0;
+    in.read((char*)&size, sizeof(unsigned));
+    vector.resize(size);
+    for(unsigned i = 0; i < size; ++i) {
+        in.read((char*)&vector[i], sizeof(typename VectorT::value_type));
+    }
+}
+
 int main (int argc, char *argv[]) {
     try {
+        //--reuse-order contracts in the order of the previous run, e.g. after changing speeds or penalties.
+        //--resume continues after the last checkpoint of an interrupted run.
+        bool reuseContractionOrder = false;
+        bool resume = false;
+        while(argc > 1 && 0 == strncmp(argv[1], "--", 2)) {
+            if(0 == strcmp(argv[1], "--reuse-order")) {
+                reuseContractionOrder = true;
+            } else if(0 == strcmp(argv[1], "--resume")) {
+                resume = true;
+            } else {
+                ERR("unknown option " << argv[1]);
+            }
+            argv[1] = argv[0];
+            --argc;
+            ++argv;
+        }
         if(argc < 3) {
-            ERR("usage: " << std::endl << argv[0] << " <osrm-data> <osrm-restrictions> [<profile>]");
+            ERR("usage: " << std::endl << argv[0] << " [--reuse-order] [--resume] <osrm-data> <osrm-restrictions> [<profile>]");
         }
 
         double startupTime = get_timestamp();
         unsigned number_of_threads = omp_get_num_procs();
+        //GB of RAM for the external r-tree construction, 0 builds it in RAM
+        unsigned amountOfRAM = 0;
+        //GB of RAM for the contractor's graph, 0 flushes contracted nodes to disk only once
+        unsigned contractionMemory = 0;
+        //minutes between checkpoints of the contraction, 0 writes no checkpoints at all
+        unsigned checkpointInterval = 0;
         if(testDataFile("contractor.ini")) {
             ContractorConfiguration contractorConfig("contractor.ini");
             unsigned rawNumber = stringToInt(contractorConfig.GetParameter("Threads"));
             if(rawNumber != 0 && rawNumber <= number_of_threads)
                 number_of_threads = rawNumber;
+            amountOfRAM = stringToInt(contractorConfig.GetParameter("Memory"));
+            contractionMemory = stringToInt(contractorConfig.GetParameter("ContractionMemory"));
+            checkpointInterval = stringToInt(contractorConfig.GetParameter("CheckpointInterval"));
         }
         omp_set_num_threads(number_of_threads);
 
@@ -93,123 +192,279 @@ int main (int argc, char *argv[]) {
         restrictionsInstream.read((char *)&(inputRestrictions[0]), usableRestrictionsCounter*sizeof(_Restriction));
         restrictionsInstream.close();
 
-        std::ifstream in;
-        in.open (argv[1], std::ifstream::in | std::ifstream::binary);
-        if (!in.is_open()) {
-            ERR("Cannot open " << argv[1]);
-        }
-
         std::string nodeOut(argv[1]);		nodeOut += ".nodes";
         std::string edgeOut(argv[1]);		edgeOut += ".edges";
         std::string graphOut(argv[1]);		graphOut += ".hsgr";
+        std::string levelOut(argv[1]);		levelOut += ".level";
+        std::string orderOut(argv[1]);		orderOut += ".order";
         std::string rtree_nodes_path(argv[1]);  rtree_nodes_path += ".ramIndex";
         std::string rtree_leafs_path(argv[1]);  rtree_leafs_path += ".fileIndex";
 
-        /*** Setup Scripting Environment ***/
-        if(!testDataFile( (argc > 3 ? argv[3] : "profile.lua") )) {
-            ERR("Need profile.lua to apply traffic signal penalty");
-        }
+        std::string expandedCheckpointPath(argv[1]);		expandedCheckpointPath += ".expanded.checkpoint";
+        std::string contractionCheckpointPath(argv[1]);		contractionCheckpointPath += ".contraction.checkpoint";
+        std::string contractedCheckpointPath(argv[1]);		contractedCheckpointPath += ".contracted.checkpoint";
+        std::string indexedCheckpointPath(argv[1]);		indexedCheckpointPath += ".indexed.checkpoint";
 
-        // Create a new lua state
-        lua_State *myLuaState = luaL_newstate();
+        std::vector<std::string> inputFiles;
+        inputFiles.push_back(argv[1]);
+        inputFiles.push_back(argv[2]);
+        inputFiles.push_back(argc > 3 ? argv[3] : "profile.lua");
+        const unsigned inputStamp = computeInputStamp(inputFiles);
 
-        // Connect LuaBind to this lua state
-        luabind::open(myLuaState);
+        std::ifstream contractedCheckpoint;
+        const bool resumeAfterContraction = resume && openCheckpoint(contractedCheckpointPath, inputStamp, contractedCheckpoint);
 
-        //open utility libraries string library;
-        luaL_openlibs(myLuaState);
+        NodeID nodeBasedNodeNumber = 0;
+        NodeID edgeBasedNodeNumber = 0;
+        DeallocatingVector<EdgeBasedEdge> edgeBasedEdgeList;
+        std::vector<EdgeBasedGraphFactory::EdgeBasedNode> nodeBasedEdgeList;
+        std::ifstream expandedCheckpoint;
+        if(resume && openCheckpoint(expandedCheckpointPath, inputStamp, expandedCheckpoint)) {
+            INFO("resuming after the expansion from " << expandedCheckpointPath);
+            expandedCheckpoint.read((char*)&nodeBasedNodeNumber, sizeof(NodeID));
+            expandedCheckpoint.read((char*)&edgeBasedNodeNumber, sizeof(NodeID));
+            readCheckpointVector(expandedCheckpoint, nodeBasedEdgeList);
+            if(!resumeAfterContraction) {
+                readCheckpointVector(expandedCheckpoint, edgeBasedEdgeList);
+            }
+            expandedCheckpoint.close();
+        } else {
+            std::ifstream in;
+            in.open (argv[1], std::ifstream::in | std::ifstream::binary);
+            if (!in.is_open()) {
+                ERR("Cannot open " << argv[1]);
+            }
 
-        //adjust lua load path
-        luaAddScriptFolderToLoadPath( myLuaState, (argc > 3 ? argv[3] : "profile.lua") );
+            /*** Setup Scripting Environment ***/
+            if(!testDataFile( (argc > 3 ? argv[3] : "profile.lua") )) {
+                ERR("Need profile.lua to apply traffic signal penalty");
+            }
 
-        // Now call our function in a lua script
-        INFO("Parsing speedprofile from " << (argc > 3 ? argv[3] : "profile.lua") );
-        if(0 != luaL_dofile(myLuaState, (argc > 3 ? argv[3] : "profile.lua") )) {
-            ERR(lua_tostring(myLuaState,-1)<< " occured in scripting block");
-        }
+            // Create a new lua state
+            lua_State *myLuaState = luaL_newstate();
 
-        EdgeBasedGraphFactory::SpeedProfileProperties speedProfile;
+            // Connect LuaBind to this lua state
+            luabind::open(myLuaState);
 
-        if(0 != luaL_dostring( myLuaState, "return traffic_signal_penalty\n")) {
-            ERR(lua_tostring(myLuaState,-1)<< " occured in scripting block");
-        }
-        speedProfile.trafficSignalPenalty = 10*lua_tointeger(myLuaState, -1);
+            //open utility libraries string library;
+            luaL_openlibs(myLuaState);
 
-        if(0 != luaL_dostring( myLuaState, "return u_turn_penalty\n")) {
-            ERR(lua_tostring(myLuaState,-1)<< " occured in scripting block");
-        }
-        speedProfile.uTurnPenalty = 10*lua_tointeger(myLuaState, -1);
+            //adjust lua load path
+            luaAddScriptFolderToLoadPath( myLuaState, (argc > 3 ? argv[3] : "profile.lua") );
+
+            // Now call our function in a lua script
+            INFO("Parsing speedprofile from " << (argc > 3 ? argv[3] : "profile.lua") );
+            if(0 != luaL_dofile(myLuaState, (argc > 3 ? argv[3] : "profile.lua") )) {
+                ERR(lua_tostring(myLuaState,-1)<< " occured in scripting block");
+            }
+
+            EdgeBasedGraphFactory::SpeedProfileProperties speedProfile;
 
-        speedProfile.has_turn_penalty_function = lua_function_exists( myLuaState, "turn_function" );
+            if(0 != luaL_dostring( myLuaState, "return traffic_signal_penalty\n")) {
+                ERR(lua_tostring(myLuaState,-1)<< " occured in scripting block");
+            }
+            speedProfile.trafficSignalPenalty = 10*lua_tointeger(myLuaState, -1);
 
-        std::vector<ImportEdge> edgeList;
-        NodeID nodeBasedNodeNumber = readBinaryOSRMGraphFromStream(in, edgeList, bollardNodes, trafficLightNodes, &internalToExternalNodeMapping, inputRestrictions);
-        in.close();
-        INFO(inputRestrictions.size() << " restrictions, " << bollardNodes.size() << " bollard nodes, " << trafficLightNodes.size() << " traffic lights");
-        if(0 == edgeList.size())
-            ERR("The input data is broken. It is impossible to do any turns in this graph");
+            if(0 != luaL_dostring( myLuaState, "return u_turn_penalty\n")) {
+                ERR(lua_tostring(myLuaState,-1)<< " occured in scripting block");
+            }
+            speedProfile.uTurnPenalty = 10*lua_tointeger(myLuaState, -1);
+
+            speedProfile.has_turn_penalty_function = lua_function_exists( myLuaState, "turn_function" );
+
+            std::vector<ImportEdge> edgeList;
+            nodeBasedNodeNumber = readBinaryOSRMGraphFromStream(in, edgeList, bollardNodes, trafficLightNodes, &internalToExternalNodeMapping, inputRestrictions);
+            in.close();
+            INFO(inputRestrictions.size() << " restrictions, " << bollardNodes.size() << " bollard nodes, " << trafficLightNodes.size() << " traffic lights");
+            if(0 == edgeList.size())
+                ERR("The input data is broken. It is impossible to do any turns in this graph");
+
+
+            /***
+             * Building an edge-expanded graph from node-based input an turn restrictions
+             */
+
+            INFO("Generating edge-expanded graph representation");
+            EdgeBasedGraphFactory * edgeBasedGraphFactory = new EdgeBasedGraphFactory (nodeBasedNodeNumber, edgeList, bollardNodes, trafficLightNodes, inputRestrictions, internalToExternalNodeMapping, speedProfile);
+            std::vector<ImportEdge>().swap(edgeList);
+            edgeBasedGraphFactory->Run(edgeOut.c_str(), myLuaState);
+            std::vector<_Restriction>().swap(inputRestrictions);
+            std::vector<NodeID>().swap(bollardNodes);
+            std::vector<NodeID>().swap(trafficLightNodes);
+            edgeBasedNodeNumber = edgeBasedGraphFactory->GetNumberOfNodes();
+            edgeBasedGraphFactory->GetEdgeBasedEdges(edgeBasedEdgeList);
+            edgeBasedGraphFactory->GetEdgeBasedNodes(nodeBasedEdgeList);
+            delete edgeBasedGraphFactory;
+
+            /***
+             * Writing info on original (node-based) nodes
+             */
+
+            INFO("writing node map ...");
+            std::ofstream mapOutFile(nodeOut.c_str(), std::ios::binary);
+            mapOutFile.write((char *)&(internalToExternalNodeMapping[0]), internalToExternalNodeMapping.size()*sizeof(NodeInfo));
+            mapOutFile.close();
+            std::vector<NodeInfo>().swap(internalToExternalNodeMapping);
+
+            if(0 < checkpointInterval) {
+                INFO("writing checkpoint " << expandedCheckpointPath);
+                std::ofstream checkpoint;
+                createCheckpoint(expandedCheckpointPath, inputStamp, checkpoint);
+                checkpoint.write((char*)&nodeBasedNodeNumber, sizeof(NodeID));
+                checkpoint.write((char*)&edgeBasedNodeNumber, sizeof(NodeID));
+                writeCheckpointVector(checkpoint, nodeBasedEdgeList);
+                writeCheckpointVector(checkpoint, edgeBasedEdgeList);
+                commitCheckpoint(expandedCheckpointPath, checkpoint);
+            }
+        }
 
+        double expansionHasFinishedTime = get_timestamp() - startupTime;
 
         /***
-         * Building an edge-expanded graph from node-based input an turn restrictions
+         * Contracting the edge-expanded graph
          */
 
-        INFO("Generating edge-expanded graph representation");
-        EdgeBasedGraphFactory * edgeBasedGraphFactory = new EdgeBasedGraphFactory (nodeBasedNodeNumber, edgeList, bollardNodes, trafficLightNodes, inputRestrictions, internalToExternalNodeMapping, speedProfile);
-        std::vector<ImportEdge>().swap(edgeList);
-        edgeBasedGraphFactory->Run(edgeOut.c_str(), myLuaState);
-        std::vector<_Restriction>().swap(inputRestrictions);
-        std::vector<NodeID>().swap(bollardNodes);
-        std::vector<NodeID>().swap(trafficLightNodes);
-        NodeID edgeBasedNodeNumber = edgeBasedGraphFactory->GetNumberOfNodes();
-        DeallocatingVector<EdgeBasedEdge> edgeBasedEdgeList;
-        edgeBasedGraphFactory->GetEdgeBasedEdges(edgeBasedEdgeList);
-        std::vector<EdgeBasedGraphFactory::EdgeBasedNode> nodeBasedEdgeList;
-        edgeBasedGraphFactory->GetEdgeBasedNodes(nodeBasedEdgeList);
-        delete edgeBasedGraphFactory;
+        std::vector<unsigned> nodeRanks;
+        DeallocatingVector< QueryEdge > contractedEdgeList;
+        if(resumeAfterContraction) {
+            INFO("resuming after the contraction from " << contractedCheckpointPath);
+            readCheckpointVector(contractedCheckpoint, nodeRanks);
+            readCheckpointVector(contractedCheckpoint, contractedEdgeList);
+            contractedCheckpoint.close();
+        } else {
+            unsigned topologyChecksum = computeTopologyChecksum(edgeBasedNodeNumber, edgeBasedEdgeList);
+            std::vector<unsigned> fixedContractionRounds;
+            if(reuseContractionOrder) {
+                std::ifstream orderInFile(orderOut.c_str(), std::ios::binary);
+                unsigned checksumOfOrder = 0;
+                unsigned numberOfOrderedNodes = 0;
+                orderInFile.read((char*) &checksumOfOrder, sizeof(unsigned));
+                orderInFile.read((char*) &numberOfOrderedNodes, sizeof(unsigned));
+                if(orderInFile.good() && topologyChecksum == checksumOfOrder && edgeBasedNodeNumber == numberOfOrderedNodes) {
+                    fixedContractionRounds.resize(numberOfOrderedNodes);
+                    orderInFile.read((char*) &fixedContractionRounds[0], numberOfOrderedNodes*sizeof(unsigned));
+                    if(!orderInFile.good()) {
+                        std::vector<unsigned>().swap(fixedContractionRounds);
+                    }
+                }
+                orderInFile.close();
+                if(fixedContractionRounds.empty()) {
+                    WARN(orderOut << " is missing or was built for a different graph, computing a new contraction order");
+                } else {
+                    INFO("reusing contraction order from " << orderOut);
+                }
+            }
+
+            INFO("initializing contractor");
+            Contractor* contractor = new Contractor( edgeBasedNodeNumber, edgeBasedEdgeList, static_cast<uint64_t>(contractionMemory) * 1024 * 1024 * 1024 );
+            if(0 < checkpointInterval || resume) {
+                contractor->SetCheckpoint( contractionCheckpointPath, inputStamp, 60.*checkpointInterval, resume );
+            }
+            double contractionStartedTimestamp(get_timestamp());
+            contractor->Run( fixedContractionRounds );
+            INFO("Contraction took " << get_timestamp() - contractionStartedTimestamp << " sec");
+            std::vector<unsigned>().swap(fixedContractionRounds);
+
+            /***
+             * Writing the contraction order in edge-based node IDs for later runs with --reuse-order
+             */
+
+            INFO("writing contraction order ...");
+            std::vector<unsigned> contractionRounds;
+            contractor->GetContractionRounds( contractionRounds );
+            unsigned numberOfOrderedNodes = contractionRounds.size();
+            std::ofstream orderOutFile(orderOut.c_str(), std::ios::binary);
+            orderOutFile.write((char*) &topologyChecksum, sizeof(unsigned));
+            orderOutFile.write((char*) &numberOfOrderedNodes, sizeof(unsigned));
+            orderOutFile.write((char*) &contractionRounds[0], numberOfOrderedNodes*sizeof(unsigned));
+            orderOutFile.close();
+            std::vector<unsigned>().swap(contractionRounds);
+
+            contractor->GetNodeRanks( nodeRanks );
+            contractor->GetEdges( contractedEdgeList );
+            delete contractor;
+
+            if(0 < checkpointInterval) {
+                INFO("writing checkpoint " << contractedCheckpointPath);
+                std::ofstream checkpoint;
+                createCheckpoint(contractedCheckpointPath, inputStamp, checkpoint);
+                writeCheckpointVector(checkpoint, nodeRanks);
+                writeCheckpointVector(checkpoint, contractedEdgeList);
+                commitCheckpoint(contractedCheckpointPath, checkpoint);
+            }
+            boost::filesystem::remove(contractionCheckpointPath);
+            boost::filesystem::remove(contractionCheckpointPath + ".edges");
+        }
 
         /***
-         * Writing info on original (node-based) nodes
+         * Renumbering nodes by level and location, everything below uses the new IDs
          */
 
-        INFO("writing node map ...");
-        std::ofstream mapOutFile(nodeOut.c_str(), std::ios::binary);
-        mapOutFile.write((char *)&(internalToExternalNodeMapping[0]), internalToExternalNodeMapping.size()*sizeof(NodeInfo));
-        mapOutFile.close();
-        std::vector<NodeInfo>().swap(internalToExternalNodeMapping);
-
-        double expansionHasFinishedTime = get_timestamp() - startupTime;
+        INFO("renumbering nodes ...");
+        NodeRenumbering nodeRenumbering( nodeBasedEdgeList, nodeRanks );
+        nodeRenumbering.RenumberEdgeBasedNodes( nodeBasedEdgeList );
+        nodeRenumbering.RenumberNodeRanks( nodeRanks );
+        nodeRenumbering.RenumberEdges( contractedEdgeList );
 
         /***
          * Building grid-like nearest-neighbor data structure
          */
 
-        INFO("building r-tree ...");
-        StaticRTree<EdgeBasedGraphFactory::EdgeBasedNode> * rtree =
-                new StaticRTree<EdgeBasedGraphFactory::EdgeBasedNode>(
-                        nodeBasedEdgeList,
-                        rtree_nodes_path.c_str(),
-                        rtree_leafs_path.c_str()
-                );
-        delete rtree;
         IteratorbasedCRC32<std::vector<EdgeBasedGraphFactory::EdgeBasedNode> > crc32;
         unsigned crc32OfNodeBasedEdgeList = crc32(nodeBasedEdgeList.begin(), nodeBasedEdgeList.end() );
-        nodeBasedEdgeList.clear();
         INFO("CRC32 based checksum is " << crc32OfNodeBasedEdgeList);
 
+        std::ifstream indexedCheckpoint;
+        if(resume && openCheckpoint(indexedCheckpointPath, inputStamp, indexedCheckpoint) && testDataFile(rtree_nodes_path) && testDataFile(rtree_leafs_path)) {
+            INFO("reusing r-tree from " << rtree_nodes_path << " and " << rtree_leafs_path);
+            indexedCheckpoint.close();
+            std::vector<EdgeBasedGraphFactory::EdgeBasedNode>().swap(nodeBasedEdgeList);
+        } else {
+            INFO("building r-tree ...");
+            StaticRTree<EdgeBasedGraphFactory::EdgeBasedNode> * rtree;
+            if(0 < amountOfRAM) {
+                //move the nodes to external memory, s.t. they do not add to the peak memory usage
+                stxxl::vector<EdgeBasedGraphFactory::EdgeBasedNode> externalNodeBasedEdgeList;
+                externalNodeBasedEdgeList.reserve(nodeBasedEdgeList.size());
+                BOOST_FOREACH(const EdgeBasedGraphFactory::EdgeBasedNode & node, nodeBasedEdgeList) {
+                    externalNodeBasedEdgeList.push_back(node);
+                }
+                std::vector<EdgeBasedGraphFactory::EdgeBasedNode>().swap(nodeBasedEdgeList);
+                rtree = StaticRTreeBuilder<EdgeBasedGraphFactory::EdgeBasedNode>::BuildInExternalMemory(
+                            externalNodeBasedEdgeList,
+                            rtree_nodes_path.c_str(),
+                            rtree_leafs_path.c_str(),
+                            static_cast<uint64_t>(amountOfRAM) * 1024 * 1024 * 1024
+                    );
+            } else {
+                rtree = new StaticRTree<EdgeBasedGraphFactory::EdgeBasedNode>(
+                            nodeBasedEdgeList,
+                            rtree_nodes_path.c_str(),
+                            rtree_leafs_path.c_str()
+                    );
+                std::vector<EdgeBasedGraphFactory::EdgeBasedNode>().swap(nodeBasedEdgeList);
+            }
+            delete rtree;
+
+            if(0 < checkpointInterval) {
+                std::ofstream checkpoint;
+                createCheckpoint(indexedCheckpointPath, inputStamp, checkpoint);
+                commitCheckpoint(indexedCheckpointPath, checkpoint);
+            }
+        }
+
         /***
-         * Contracting the edge-expanded graph
+         * Writing the contraction order, i.e. the rank of each node in the hierarchy
          */
 
-        INFO("initializing contractor");
-        Contractor* contractor = new Contractor( edgeBasedNodeNumber, edgeBasedEdgeList );
-        double contractionStartedTimestamp(get_timestamp());
-        contractor->Run();
-        INFO("Contraction took " << get_timestamp() - contractionStartedTimestamp << " sec");
-
-        DeallocatingVector< QueryEdge > contractedEdgeList;
-        contractor->GetEdges( contractedEdgeList );
-        delete contractor;
+        INFO("writing node ranks ...");
+        unsigned numberOfRankedNodes = nodeRanks.size();
+        std::ofstream levelOutFile(levelOut.c_str(), std::ios::binary);
+        levelOutFile.write((char*) &crc32OfNodeBasedEdgeList, sizeof(unsigned));
+        levelOutFile.write((char*) &numberOfRankedNodes, sizeof(unsigned));
+        levelOutFile.write((char*) &nodeRanks[0], numberOfRankedNodes*sizeof(unsigned));
+        levelOutFile.close();
+        std::vector<unsigned>().swap(nodeRanks);
 
         /***
          * Sorting contracted edges in a way that the static query graph can read some in in-place.
@@ -217,7 +472,8 @@ int main (int argc, char *argv[]) {
 
         INFO("Building Node Array");
         std::sort(contractedEdgeList.begin(), contractedEdgeList.end());
-        unsigned numberOfNodes = 0;
+        //renumbered nodes without any edge may have any ID, the graph covers them all
+        unsigned numberOfNodes = (0 < edgeBasedNodeNumber ? edgeBasedNodeNumber - 1 : 0);
         unsigned numberOfEdges = contractedEdgeList.size();
         INFO("Serializing compacted graph of " << numberOfEdges << " edges");
         std::ofstream hsgr_output_stream(graphOut.c_str(), std::ios::binary);
@@ -245,12 +501,16 @@ int main (int argc, char *argv[]) {
             position += edge - lastEdge; //remove
         }
         ++numberOfNodes;
-        //Serialize numberOfNodes, nodes
+        //Serialize numberOfNodes, numberOfEdges
         hsgr_output_stream.write((char*) &crc32OfNodeBasedEdgeList, sizeof(unsigned));
         hsgr_output_stream.write((char*) &numberOfNodes, sizeof(unsigned));
-        hsgr_output_stream.write((char*) &_nodes[0], sizeof(StaticGraph<EdgeData>::_StrNode)*(numberOfNodes));
-        //Serialize number of Edges
         hsgr_output_stream.write((char*) &position, sizeof(unsigned));
+        //Serialize nodes plus two sentinels on their own pages, cf. GraphLoader.h
+        _nodes.push_back(_nodes.back());
+        _nodes.push_back(_nodes.back());
+        padHSGRStreamToPage(hsgr_output_stream);
+        hsgr_output_stream.write((char*) &_nodes[0], sizeof(StaticGraph<EdgeData>::_StrNode)*(numberOfNodes+2));
+        padHSGRStreamToPage(hsgr_output_stream);
         --numberOfNodes;
         edge = 0;
         int usedEdgeCounter = 0;
@@ -275,6 +535,11 @@ int main (int argc, char *argv[]) {
         INFO("Contraction: " << (edgeBasedNodeNumber/expansionHasFinishedTime) << " nodes/sec and "<< usedEdgeCounter/endTime << " edges/sec");
 
         hsgr_output_stream.close();
+
+        //the output is complete, checkpoints of this run are not needed anymore
+        boost::filesystem::remove(expandedCheckpointPath);
+        boost::filesystem::remove(contractedCheckpointPath);
+        boost::filesystem::remove(indexedCheckpointPath);
         //cleanedEdgeList.clear();
         _nodes.clear();
         INFO("finished preprocessing");
@@ -0,0 +1,185 @@
+/*
+    open source routing machine
+    Copyright (C) Dennis Luxen, others 2010
+
+This program is free software; you can redistribute it and/or modify
+it under the terms of the GNU AFFERO General Public License as published by
+the Free Software Foundation; either version 3 of the License, or
+any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU Affero General Public License
+along with this program; if not, write to the Free Software
+Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+or see http://www.gnu.org/licenses/agpl.txt.
+ */
+
+#include "DataStructures/NodeInformationHelpDesk.h"
+#include "DataStructures/QueryEdge.h"
+#include "DataStructures/SharedDataLayout.h"
+#include "DataStructures/StaticGraph.h"
+#include "DataStructures/TimingUtil.h"
+#include "Util/BaseConfiguration.h"
+#include "Util/GraphLoader.h"
+#include "Util/InputFileUtil.h"
+#include "Util/SharedMemory.h"
+#include "typedefs.h"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/*
+ * Loads a dataset into shared memory and makes it the live dataset of all
+ * osrm-routed processes that run with sharedMemory=yes. The previous dataset
+ * is removed by name and freed by the OS once the last server detached.
+ */
+
+typedef StaticGraph<QueryEdge::EdgeData> QueryGraph;
+
+//size of a file, 0 if an optional file is not given or missing
+static uint64_t getSizeOfFile(const std::string & filename, const bool required) {
+    std::ifstream input_stream(filename.c_str(), std::ios::binary);
+    if(filename.empty() || !input_stream) {
+        if(required) {
+            ERR(filename << " not found");
+        }
+        if(!filename.empty()) {
+            WARN(filename << " not found");
+        }
+        return 0;
+    }
+    input_stream.seekg(0, std::ios::end);
+    return input_stream.tellg();
+}
+
+static void copyFileIntoMemory(const std::string & filename, char * destination, const uint64_t size) {
+    if(0 == size) {
+        return;
+    }
+    std::ifstream input_stream(filename.c_str(), std::ios::binary);
+    input_stream.read(destination, size);
+    if(static_cast<uint64_t>(input_stream.gcount()) != size) {
+        ERR("could not read " << filename);
+    }
+}
+
+template<typename T>
+static void copyVectorIntoMemory(const std::vector<T> & input_vector, char * destination) {
+    if(!input_vector.empty()) {
+        memcpy(destination, &input_vector[0], input_vector.size()*sizeof(T));
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        const char * server_ini_path = (argc > 1 ? argv[1] : "server.ini");
+        if(!testDataFile(server_ini_path)) {
+            ERR("usage: " << std::endl << argv[0] << " [<server.ini>]");
+        }
+        double startupTime = get_timestamp();
+        BaseConfiguration serverConfig(server_ini_path);
+        const std::string hsgr_path = serverConfig.GetParameter("hsgrData");
+        const std::string ram_index_path = serverConfig.GetParameter("ramIndex");
+        const std::string file_index_path = serverConfig.GetParameter("fileIndex");
+        const std::string names_path = serverConfig.GetParameter("namesData");
+        const std::string level_path = serverConfig.GetParameter("levelData");
+        const std::string timestamp_path = serverConfig.GetParameter("timestamp");
+
+        //node and edge data are stored the way NodeInformationHelpDesk uses them
+        INFO("loading node and edge data");
+        std::vector<_Coordinate> coordinate_vector;
+        std::vector<NodeID> via_node_vector;
+        std::vector<unsigned> name_id_vector;
+        std::vector<TurnInstruction> turn_instruction_vector;
+        NodeInformationHelpDesk::LoadNodesAndEdges(
+            serverConfig.GetParameter("nodesData"),
+            serverConfig.GetParameter("edgesData"),
+            coordinate_vector,
+            via_node_vector,
+            name_id_vector,
+            turn_instruction_vector
+        );
+
+        SharedDataLayout layout;
+        layout.blockSize[SharedDataLayout::HSGR_DATA] = getSizeOfFile(hsgr_path, true);
+        layout.blockSize[SharedDataLayout::RAM_INDEX] = getSizeOfFile(ram_index_path, true);
+        layout.blockSize[SharedDataLayout::FILE_INDEX] = getSizeOfFile(file_index_path, true);
+        layout.blockSize[SharedDataLayout::COORDINATES] = coordinate_vector.size()*sizeof(_Coordinate);
+        layout.blockSize[SharedDataLayout::VIA_NODES] = via_node_vector.size()*sizeof(NodeID);
+        layout.blockSize[SharedDataLayout::NAME_IDS] = name_id_vector.size()*sizeof(unsigned);
+        layout.blockSize[SharedDataLayout::TURN_INSTRUCTIONS] = turn_instruction_vector.size()*sizeof(TurnInstruction);
+        layout.blockSize[SharedDataLayout::NAMES_DATA] = getSizeOfFile(names_path, true);
+        layout.blockSize[SharedDataLayout::LEVEL_DATA] = getSizeOfFile(level_path, false);
+        layout.blockSize[SharedDataLayout::TIMESTAMP] = getSizeOfFile(timestamp_path, false);
+        layout.ComputeBlockOffsets();
+
+        //the control region is created by the very first run
+        SharedMemoryRegion * control_region = SharedMemoryRegion::Attach(getSharedDataControlName(), true);
+        if(NULL == control_region) {
+            control_region = SharedMemoryRegion::Create(getSharedDataControlName(), sizeof(SharedDataControl));
+        }
+        if(sizeof(SharedDataControl) > control_region->GetSize()) {
+            ERR("shared memory region " << control_region->GetName() << " is corrupt");
+        }
+        SharedDataControl * control = reinterpret_cast<SharedDataControl *>(control_region->GetData());
+        const unsigned old_generation = readSharedDataGeneration(control);
+        const unsigned new_generation = old_generation + 1;
+
+        INFO("writing " << layout.GetTotalSize() << " bytes of generation " << new_generation << " to shared memory");
+        //left over by a run that failed before publishing
+        SharedMemoryRegion::Remove(getSharedDataRegionName(new_generation));
+        SharedMemoryRegion * data_region = SharedMemoryRegion::Create(
+            getSharedDataRegionName(new_generation),
+            layout.GetTotalSize()
+        );
+        char * shared_data = data_region->GetData();
+        memcpy(shared_data, &layout, sizeof(SharedDataLayout));
+        copyFileIntoMemory(hsgr_path, layout.GetBlock<char>(shared_data, SharedDataLayout::HSGR_DATA), layout.blockSize[SharedDataLayout::HSGR_DATA]);
+        copyFileIntoMemory(ram_index_path, layout.GetBlock<char>(shared_data, SharedDataLayout::RAM_INDEX), layout.blockSize[SharedDataLayout::RAM_INDEX]);
+        copyFileIntoMemory(file_index_path, layout.GetBlock<char>(shared_data, SharedDataLayout::FILE_INDEX), layout.blockSize[SharedDataLayout::FILE_INDEX]);
+        copyVectorIntoMemory(coordinate_vector, layout.GetBlock<char>(shared_data, SharedDataLayout::COORDINATES));
+        copyVectorIntoMemory(via_node_vector, layout.GetBlock<char>(shared_data, SharedDataLayout::VIA_NODES));
+        copyVectorIntoMemory(name_id_vector, layout.GetBlock<char>(shared_data, SharedDataLayout::NAME_IDS));
+        copyVectorIntoMemory(turn_instruction_vector, layout.GetBlock<char>(shared_data, SharedDataLayout::TURN_INSTRUCTIONS));
+        copyFileIntoMemory(names_path, layout.GetBlock<char>(shared_data, SharedDataLayout::NAMES_DATA), layout.blockSize[SharedDataLayout::NAMES_DATA]);
+        copyFileIntoMemory(level_path, layout.GetBlock<char>(shared_data, SharedDataLayout::LEVEL_DATA), layout.blockSize[SharedDataLayout::LEVEL_DATA]);
+        copyFileIntoMemory(timestamp_path, layout.GetBlock<char>(shared_data, SharedDataLayout::TIMESTAMP), layout.blockSize[SharedDataLayout::TIMESTAMP]);
+
+        //fail before publishing anything the servers could not attach to
+        const QueryGraph::_StrNode * node_array = NULL;
+        const QueryGraph::_StrEdge * edge_array = NULL;
+        unsigned number_of_edges = 0;
+        unsigned check_sum = 0;
+        const unsigned number_of_nodes = mapHSGRFromMemory(
+            layout.GetBlock<char>(shared_data, SharedDataLayout::HSGR_DATA),
+            layout.blockSize[SharedDataLayout::HSGR_DATA],
+            &node_array,
+            &edge_array,
+            &number_of_edges,
+            &check_sum
+        );
+        INFO("graph has " << number_of_nodes << " nodes and " << number_of_edges << " edges, checksum is " << check_sum);
+
+        //publish, all writes to the region happen before the swap
+        if(old_generation != __sync_val_compare_and_swap(&control->generation, old_generation, new_generation)) {
+            SharedMemoryRegion::Remove(data_region->GetName());
+            ERR("another osrm-datastore published a dataset concurrently");
+        }
+        if(0 != old_generation) {
+            SharedMemoryRegion::Remove(getSharedDataRegionName(old_generation));
+        }
+        delete data_region;
+        delete control_region;
+        INFO("generation " << new_generation << " is live after " << (get_timestamp() - startupTime) << " seconds");
+    } catch (std::exception &e) {
+        ERR("Exception occured: " << e.what());
+    }
+    return 0;
+}
@@ -0,0 +1,15 @@
+@metrics
+Feature: Metrics
+
+	Scenario: Request metrics
+		Given the node map
+		 | a | b |
+		And the ways
+		 | nodes |
+		 | ab    |
+		When I request /metrics after routing from a to b and looking up the nearest node of a
+		Then I should get a response
+		And I should get latency histograms for "viaroute"
+		And I should get latency histograms for "nearest"
+		And the latency histogram for "viaroute" should count requests
+		And the latency histogram for "nearest" should count requests
@@ -0,0 +1,41 @@
+@nearest
+Feature: Locating Nearest node on a Way - several candidates
+
+	Background:
+		Given the profile "testbot"
+
+	Scenario: Nearest - candidates ordered by distance
+		Given the node map
+		 | a | x | b |
+		 |   | 0 |   |
+		 |   |   |   |
+		 | c | y | d |
+		 |   | 1 |   |
+		 |   |   |   |
+		 |   |   |   |
+		 | e | z | f |
+
+		And the ways
+		 | nodes |
+		 | ab    |
+		 | cd    |
+		 | ef    |
+
+		When I request 3 nearest I should get
+		 | in | out   |
+		 | 0  | x,y,z |
+		 | 1  | y,z,x |
+		 | y  | y,x,z |
+
+	Scenario: Nearest - number of candidates is limited by the network
+		Given the node map
+		 | a | x | b |
+		 |   | 0 |   |
+
+		And the ways
+		 | nodes |
+		 | ab    |
+
+		When I request 3 nearest I should get
+		 | in | out |
+		 | 0  | x   |
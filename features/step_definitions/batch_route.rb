@@ -0,0 +1,33 @@
+When /^I request batch routes I should get$/ do |table|
+  reprocess
+  actual = []
+  OSRMLauncher.new do
+    waypoints = []
+    table.hashes.each do |row|
+      [row['from'],row['to']].each do |name|
+        node = find_node_by_name(name)
+        raise "*** unknown node '#{name}" unless node
+        waypoints << node
+      end
+    end
+
+    response = request_batch waypoints
+    if response.code == "200" && response.body.empty? == false
+      json = JSON.parse response.body
+      result = json['route_summaries']
+    end
+
+    table.hashes.each_with_index do |row,ri|
+      got = {'from' => row['from'], 'to' => row['to']}
+      if result && result[ri]
+        ['time','distance'].each_with_index do |key,i|
+          next unless table.headers.include? key
+          value = result[ri][i].to_s
+          got[key] = FuzzyMatch.match(value, row[key]) ? row[key] : value
+        end
+      end
+      actual << got
+    end
+  end
+  table.routing_diff! actual
+end
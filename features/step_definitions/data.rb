@@ -6,6 +6,10 @@ Given /^a grid size of (\d+) meters$/ do |meters|
   set_grid_size meters
 end
 
+Given /^the extract stores dense nodes in groups of (\d+)$/ do |size|
+  @dense_group_size = size.to_i
+end
+
 Given /^the shortcuts$/ do |table|
   table.hashes.each do |row|
     shortcuts_hash[ row['key'] ] = row['value']
@@ -0,0 +1,27 @@
+When /^I request a travel time matrix I should get$/ do |table|
+  reprocess
+  actual = []
+  actual << table.headers
+  OSRMLauncher.new do
+    waypoints = table.headers[1..-1].map do |name|
+      node = find_node_by_name(name)
+      raise "*** unknown node '#{name}" unless node
+      node
+    end
+
+    response = request_table waypoints
+    if response.code == "200" && response.body.empty? == false
+      json = JSON.parse response.body
+      result = json['distance_table']
+    end
+
+    table.rows.each_with_index do |row,ri|
+      got = [row[0]]
+      row[1..-1].each_with_index do |cell,ci|
+        got << (result ? result[ri][ci].to_s : '')
+      end
+      actual << got
+    end
+  end
+  table.diff! actual
+end
@@ -0,0 +1,23 @@
+When /^I request an isochrone of (\d+) seconds from "([^"]*)" I should get$/ do |seconds,origin,table|
+  reprocess
+  actual = []
+  OSRMLauncher.new do
+    origin_node = find_node_by_name origin
+    raise "*** unknown origin node '#{origin}" unless origin_node
+
+    response = request_isochrone origin_node, seconds
+    if response.code == "200" && response.body.empty? == false
+      json = JSON.parse response.body
+      result = json['isochrone'] if json['status'] == 0
+    end
+
+    table.hashes.each do |row|
+      node = find_node_by_name row['node']
+      raise "*** unknown node '#{row['node']}" unless node
+
+      times = (result || []).select { |entry| FuzzyMatch.match_location entry, node }.map { |entry| entry[2] }
+      actual << { 'node' => row['node'], 'time' => (times.empty? ? '' : times.min.to_s) }
+    end
+  end
+  table.routing_diff! actual
+end
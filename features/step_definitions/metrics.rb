@@ -0,0 +1,27 @@
+When /^I request \/metrics after routing from (\w+) to (\w+) and looking up the nearest node of (\w+)$/ do |from, to, nearest|
+  reprocess
+  OSRMLauncher.new do
+    from_node = find_node_by_name from
+    raise "*** unknown from-node '#{from}" unless from_node
+    to_node = find_node_by_name to
+    raise "*** unknown to-node '#{to}" unless to_node
+    nearest_node = find_node_by_name nearest
+    raise "*** unknown nearest-node '#{nearest}" unless nearest_node
+
+    request_route([from_node, to_node]).code.should == "200"
+    request_nearest("#{nearest_node.lat},#{nearest_node.lon}").code.should == "200"
+    @response = request_path 'metrics'
+  end
+end
+
+Then /^I should get latency histograms for "([^"]*)"$/ do |plugin|
+  @response.body.should include "osrm_request_duration_seconds_bucket{plugin=\"#{plugin}\",le=\"+Inf\"}"
+  @response.body.should include "osrm_request_duration_seconds_count{plugin=\"#{plugin}\"}"
+  @response.body.should include "osrm_phase_duration_seconds_count{plugin=\"#{plugin}\",phase=\"search\"}"
+end
+
+Then /^the latency histogram for "([^"]*)" should count requests$/ do |plugin|
+  count = @response.body[/^osrm_request_duration_seconds_count\{plugin="#{plugin}"\} (\d+)$/, 1]
+  count.should_not == nil
+  count.to_i.should > 0
+end
@@ -48,4 +48,45 @@ When /^I request nearest (\d+) times I should get$/ do |n,table|
     ok = false unless step "I request nearest I should get", table
   end
   ok
-end
\ No newline at end of file
+end
+When /^I request (\d+) nearest I should get$/ do |number,table|
+  reprocess
+  actual = []
+  OSRMLauncher.new do
+    table.hashes.each_with_index do |row,ri|
+      in_node = find_node_by_name row['in']
+      raise "*** unknown in-node '#{row['in']}" unless in_node
+
+      out_nodes = row['out'].split(',').map do |name|
+        out_node = find_node_by_name name
+        raise "*** unknown out-node '#{name}" unless out_node
+        out_node
+      end
+
+      response = request_nearest("#{in_node.lat},#{in_node.lon}", number)
+      coords = []
+      if response.code == "200" && response.body.empty? == false
+        json = JSON.parse response.body
+        if json['status'] == 0
+          coords = json['results'].map { |result| result['mapped_coordinate'] }
+        end
+      end
+
+      got = {'in' => row['in'], 'out' => coords }
+
+      ok = coords.size == out_nodes.size
+      out_nodes.each_with_index do |out_node,i|
+        ok = false unless coords[i] && FuzzyMatch.match_location(coords[i], out_node)
+      end
+      if ok
+        got['out'] = row['out']
+      else
+        failed = { :attempt => 'nearest', :query => @query, :response => response }
+        log_fail row,got,[failed]
+      end
+
+      actual << got
+    end
+  end
+  table.routing_diff! actual
+end
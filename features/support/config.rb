@@ -18,6 +18,7 @@ IP = 0.0.0.0
 Port = #{OSRM_PORT}
 
 hsgrData=#{@osm_file}.osrm.hsgr
+levelData=#{@osm_file}.osrm.level
 nodesData=#{@osm_file}.osrm.nodes
 edgesData=#{@osm_file}.osrm.edges
 ramIndex=#{@osm_file}.osrm.ramIndex
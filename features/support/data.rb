@@ -157,6 +157,7 @@ def reset_data
   end
   reset_profile
   reset_osm
+  @dense_group_size = nil
   @fingerprint = nil
 end
 
@@ -223,6 +224,7 @@ def convert_osm_to_pbf
     unless system "osmosis --read-xml #{@osm_file}.osm --write-pbf #{@osm_file}.osm.pbf omitmetadata=true 1>>#{PREPROCESS_LOG_FILE} 2>>#{PREPROCESS_LOG_FILE}"
       raise OsmosisError.new $?, "osmosis exited with code #{$?.exitstatus}"
     end
+    split_pbf_dense_groups "#{@osm_file}.osm.pbf", @dense_group_size if @dense_group_size
     log '', :preprocess
   end
 end
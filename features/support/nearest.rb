@@ -12,6 +12,10 @@ rescue Timeout::Error
   raise "*** osrm-routed did not respond."
 end
 
-def request_nearest a
-  request_nearest_url "nearest?loc=#{a}"
+def request_nearest a, number=nil
+  if number
+    request_nearest_url "nearest?loc=#{a}&number=#{number}"
+  else
+    request_nearest_url "nearest?loc=#{a}"
+  end
 end
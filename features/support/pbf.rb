@@ -0,0 +1,167 @@
+require 'zlib'
+
+#rewrites a .pbf file such that the dense nodes of each block are spread over several
+#primitive groups, like some writers other than osmosis produce them. only the fields
+#read by osrm-extract are kept, dense node metadata is dropped.
+
+def pbf_read_varint data, pos
+  value = 0
+  shift = 0
+  loop do
+    byte = data.getbyte pos
+    pos += 1
+    value |= (byte & 0x7f) << shift
+    shift += 7
+    break if byte < 0x80
+  end
+  [value, pos]
+end
+
+def pbf_varint value
+  bytes = ''.force_encoding('BINARY')
+  while value >= 0x80
+    bytes << ((value & 0x7f) | 0x80).chr
+    value >>= 7
+  end
+  bytes << value.chr
+end
+
+def pbf_zigzag value
+  value >= 0 ? 2*value : -2*value-1
+end
+
+def pbf_unzigzag value
+  (value & 1) == 0 ? value >> 1 : -((value+1) >> 1)
+end
+
+#returns [field number, wire type, value] for each field of a message
+def pbf_fields data
+  fields = []
+  pos = 0
+  while pos < data.bytesize
+    key, pos = pbf_read_varint data, pos
+    number, type = key >> 3, key & 7
+    case type
+    when 0
+      value, pos = pbf_read_varint data, pos
+    when 1
+      value, pos = data.byteslice(pos,8), pos+8
+    when 2
+      length, pos = pbf_read_varint data, pos
+      value, pos = data.byteslice(pos,length), pos+length
+    when 5
+      value, pos = data.byteslice(pos,4), pos+4
+    else
+      raise "*** unsupported protobuf wire type #{type}"
+    end
+    fields << [number, type, value]
+  end
+  fields
+end
+
+def pbf_encode fields
+  data = ''.force_encoding('BINARY')
+  fields.each do |number, type, value|
+    data << pbf_varint((number << 3) | type)
+    case type
+    when 0
+      data << pbf_varint(value)
+    when 2
+      data << pbf_varint(value.bytesize) << value
+    else
+      data << value
+    end
+  end
+  data
+end
+
+#values of a repeated integer field, packed or not
+def pbf_repeated fields, number
+  values = []
+  fields.each do |n, type, value|
+    next unless n == number
+    if type == 2
+      pos = 0
+      while pos < value.bytesize
+        v, pos = pbf_read_varint value, pos
+        values << v
+      end
+    else
+      values << value
+    end
+  end
+  values
+end
+
+def pbf_packed values
+  values.map { |v| pbf_varint v }.join.force_encoding('BINARY')
+end
+
+def pbf_split_dense dense, nodes_per_group
+  fields = pbf_fields dense
+  ids, lats, lons = [1,8,9].map do |number|
+    absolute = 0
+    pbf_repeated(fields, number).map { |delta| absolute += pbf_unzigzag(delta) }
+  end
+  #keys_vals holds the tags of all nodes, each list terminated by a 0
+  tags = []
+  current = []
+  pbf_repeated(fields, 10).each do |v|
+    current << v
+    if v == 0
+      tags << current
+      current = []
+    end
+  end
+
+  groups = []
+  (0...ids.size).step(nodes_per_group) do |first|
+    range = first...[first+nodes_per_group, ids.size].min
+    group = []
+    [[1,ids],[8,lats],[9,lons]].each do |number, values|
+      last = 0
+      deltas = values[range].map { |v| d = v-last; last = v; pbf_zigzag(d) }
+      group << [number, 2, pbf_packed(deltas)]
+    end
+    group << [10, 2, pbf_packed(tags[range].flatten)] unless tags.empty?
+    groups << pbf_encode([[2, 2, pbf_encode(group)]])
+  end
+  groups
+end
+
+def pbf_split_block block, nodes_per_group
+  fields = pbf_fields(block).map do |number, type, value|
+    next [[number, type, value]] unless number == 2
+    dense = pbf_fields(value).find { |n,t,v| n == 2 }
+    next [[number, type, value]] unless dense
+    pbf_split_dense(dense[2], nodes_per_group).map { |group| [2, 2, group] }
+  end
+  pbf_encode fields.flatten(1)
+end
+
+def split_pbf_dense_groups file, nodes_per_group
+  input = File.binread file
+  output = ''.force_encoding('BINARY')
+  pos = 0
+  while pos < input.bytesize
+    header_size = input.byteslice(pos,4).unpack('N').first
+    header = pbf_fields input.byteslice(pos+4, header_size)
+    pos += 4+header_size
+    type = header.find { |n,t,v| n == 1 }[2]
+    blob_size = header.find { |n,t,v| n == 3 }[2]
+    blob = input.byteslice(pos, blob_size)
+    pos += blob_size
+
+    if type == 'OSMData'
+      blob_fields = pbf_fields blob
+      raw = blob_fields.find { |n,t,v| n == 1 }
+      block = raw ? raw[2] : Zlib::Inflate.inflate(blob_fields.find { |n,t,v| n == 3 }[2])
+      block = pbf_split_block block, nodes_per_group
+      blob = pbf_encode [[2, 0, block.bytesize], [3, 2, Zlib::Deflate.deflate(block)]]
+      header = header.map { |n,t,v| n == 3 ? [n, t, blob.bytesize] : [n, t, v] }
+    end
+    header = pbf_encode header
+    output << [header.bytesize].pack('N') << header << blob
+  end
+  File.binwrite file, output
+end
@@ -136,4 +136,15 @@ def mode_list instructions
   map { |r| r[8] }.
   map { |r| (r=="" || r==nil) ? '""' : r }.
   join(',')
-end
\ No newline at end of file
+end
+def request_table waypoints, params={}
+  request_path "table", waypoints, params
+end
+
+def request_batch waypoints, params={}
+  request_path "batchroute", waypoints, params
+end
+
+def request_isochrone waypoint, seconds, params={}
+  request_path "isochrone", [waypoint], params.merge('time' => seconds)
+end
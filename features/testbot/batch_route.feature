@@ -0,0 +1,40 @@
+@batch @testbot
+Feature: Batch routing of origin/destination pairs
+# time is given in 1/10th of seconds, distance in meters.
+# unreachable destinations are reported as 2147483647 (INT_MAX)
+
+	Background:
+		Given the profile "testbot"
+
+	Scenario: Testbot - Batch of pairs on a minimal network
+		Given a grid size of 100 meters
+		Given the node map
+		 | a | b | c |
+
+		And the ways
+		 | nodes |
+		 | abc   |
+
+		When I request batch routes I should get
+		 | from | to | time | distance  |
+		 | a    | b  | 100  | 100 +- 2  |
+		 | b    | a  | 100  | 100 +- 2  |
+		 | a    | c  | 200  | 200 +- 2  |
+		 | c    | b  | 100  | 100 +- 2  |
+
+	Scenario: Testbot - Batch of pairs on a network with oneways
+		Given the node map
+		 | x | a | b | y |
+		 |   | d | c |   |
+
+		And the ways
+		 | nodes | oneway |
+		 | abcda | yes    |
+		 | xa    |        |
+		 | by    |        |
+
+		When I request batch routes I should get
+		 | from | to | time |
+		 | x    | y  | 300  |
+		 | y    | x  | 500  |
+		 | d    | y  | 300  |
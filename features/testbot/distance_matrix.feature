@@ -0,0 +1,55 @@
+@matrix @testbot
+Feature: Basic Distance Matrix
+# note that results are travel time, specified in 1/10th of seconds
+# since testbot uses a default speed of 100m/10s, the result matches
+# the number of meters as long as the way type is the default 'primary'
+
+	Background:
+		Given the profile "testbot"
+
+	Scenario: Testbot - Travel time matrix of minimal network
+		Given the node map
+		 | a | b |
+
+		And the ways
+		 | nodes |
+		 | ab    |
+
+		When I request a travel time matrix I should get
+		 |   | a   | b   |
+		 | a | 0   | 100 |
+		 | b | 100 | 0   |
+
+	Scenario: Testbot - Travel time matrix with different way speeds
+		Given the node map
+		 | a | b | c | d |
+
+		And the ways
+		 | nodes | highway   |
+		 | ab    | primary   |
+		 | bc    | secondary |
+		 | cd    | tertiary  |
+
+		When I request a travel time matrix I should get
+		 |   | a   | b   | c   | d   |
+		 | a | 0   | 100 | 300 | 600 |
+		 | b | 100 | 0   | 200 | 500 |
+		 | c | 300 | 200 | 0   | 300 |
+		 | d | 600 | 500 | 300 | 0   |
+
+	Scenario: Testbot - Travel time matrix of network with oneways
+		Given the node map
+		 | x | a | b | y |
+		 |   | d | c |   |
+
+		And the ways
+		 | nodes | oneway |
+		 | abcda | yes    |
+		 | xa    |        |
+		 | by    |        |
+
+		When I request a travel time matrix I should get
+		 |   | x   | y   | d   |
+		 | x | 0   | 300 | 400 |
+		 | y | 500 | 0   | 300 |
+		 | d | 200 | 300 | 0   |
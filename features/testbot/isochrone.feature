@@ -0,0 +1,39 @@
+@isochrone @testbot
+Feature: Isochrones
+# time is given in 1/10th of seconds and denotes when a location is reached.
+# locations that cannot be reached within the time limit are left empty.
+
+	Background:
+		Given the profile "testbot"
+
+	Scenario: Testbot - Isochrone along a single way
+		Given the node map
+		 | a | b | c | d | e |
+
+		And the ways
+		 | nodes |
+		 | abcde |
+
+		When I request an isochrone of 25 seconds from "a" I should get
+		 | node | time |
+		 | a    | 0    |
+		 | b    | 100  |
+		 | c    | 200  |
+		 | d    |      |
+
+	Scenario: Testbot - Isochrone with different way speeds
+		Given the node map
+		 | a | b | c | d | e |
+
+		And the ways
+		 | nodes | highway   |
+		 | ab    | primary   |
+		 | bc    | secondary |
+		 | cde   | tertiary  |
+
+		When I request an isochrone of 35 seconds from "a" I should get
+		 | node | time |
+		 | a    | 0    |
+		 | b    | 100  |
+		 | c    | 300  |
+		 | d    |      |
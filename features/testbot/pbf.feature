@@ -0,0 +1,25 @@
+@routing @pbf
+Feature: Protobuffer input
+	
+	Background:
+		Given the profile "testbot"
+	
+	Scenario: Blocks with several groups of dense nodes
+		Given a grid size of 100 meters
+		And the extract stores dense nodes in groups of 2
+		And the node map
+		 | a | b | c |
+		 | f | e | d |
+
+		And the ways
+		 | nodes |
+		 | abc   |
+		 | cd    |
+		 | def   |
+
+		When I route I should get
+		 | from | to | route      | distance  |
+		 | a    | c  | abc        | 200m +- 2 |
+		 | a    | f  | abc,cd,def | 500m +- 2 |
+		 | f    | a  | def,cd,abc | 500m +- 2 |
+		 | e    | b  | def,cd,abc | 300m +- 2 |